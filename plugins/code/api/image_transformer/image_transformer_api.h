@@ -35,7 +35,7 @@
 
 #include "plugins_common.h"
 #include <cstdint>
-#define IMG_TRANSFORMER_API_VERSION 1
+#define IMG_TRANSFORMER_API_VERSION 2
 
 #ifdef __cplusplus
 extern "C" {
@@ -136,8 +136,9 @@ typedef struct {
 
 typedef struct {
     uint8_t* buffer;
-    // int64_t bufferSize;
     int64_t size;
+    int64_t bufferSize; /**< Capacity of buffer in bytes, added in API version 2. Process may grow 'size' up to
+                             this value, 0 means capacity is equal to 'size'. */
 } ImgTransformerData;
 
 typedef struct {
@@ -183,6 +184,30 @@ typedef Status (*ImgTransformerProcess) (ImgTransformerHandle handle, ImgTransfo
 
 typedef const char* (*ImgTransformerGetMessage)(ImgTransformerHandle handle);
 
+/** @brief Get metadata and buffer size of frame produced from input with given metadata. Added in API version 2.
+ *  May be NULL if plugin keeps metadata and size of frames unchanged.
+ *  @return status code, STATUS_ERROR if input is not supported
+ */
+typedef Status (*ImgTransformerGetOutputSize)(ImgTransformerHandle handle,
+                                              const ImgTransformerMetadata* inMetadata, /**< [in] Input metadata */
+                                              ImgTransformerMetadata* outMetadata, /**< [out] Output metadata */
+                                              int64_t* outSize); /**< [out] Bytes of buffer needed for output */
+
+/** @brief Process frame into buffer allocated by plugin. Added in API version 2, may be NULL.
+ *  Input frame is not modified. Output buffer stays valid until it is passed to ImgTransformerRelease,
+ *  several output frames may be held at the same time.
+ *  @return status code
+ */
+typedef Status (*ImgTransformerProcessTo)(ImgTransformerHandle handle,
+                                          const ImgTransformerFrame* inFrame, /**< [in] Input frame */
+                                          ImgTransformerFrame* outFrame);     /**< [out] Frame owned by plugin */
+
+/** @brief Give frame returned by ImgTransformerProcessTo back to plugin. Added in API version 2.
+ *  Must be set if ImgTransformerProcessTo is set.
+ *  @return status code
+ */
+typedef Status (*ImgTransformerRelease)(ImgTransformerHandle handle, ImgTransformerFrame* outFrame);
+
 typedef struct {
     const char* pluginName;
     ImgTransformerGetInfo getInfo;
@@ -191,6 +216,9 @@ typedef struct {
     ImgTransformerClose close;
     ImgTransformerProcess process;
     ImgTransformerGetMessage getMessage;
+    ImgTransformerGetOutputSize getOutputSize; /**< API version 2 */
+    ImgTransformerProcessTo processTo;         /**< API version 2 */
+    ImgTransformerRelease release;             /**< API version 2 */
 } ImgTransformerApi;
 
 DLB_EXPORT
@@ -207,4 +235,4 @@ typedef int (*ImgTransformerGetApiVersion)(void);
 }
 #endif
 
-#endif // __DLB_PLUGINS_MP4_MUX_API_H__
\ No newline at end of file
+#endif // __DEE_PLUGINS_IMG_TRANSFORMER_API_H__
\ No newline at end of file
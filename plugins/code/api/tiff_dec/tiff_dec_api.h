@@ -35,7 +35,7 @@
 
 #include "plugins_common.h"
 
-#define TIFF_DEC_API_VERSION 1
+#define TIFF_DEC_API_VERSION 3
 
 #ifdef __cplusplus
 extern "C" {
@@ -79,6 +79,8 @@ typedef struct {
     uint64_t height;      /**< Height of decoded picture */
     void* buffer[3];      /**< Pointers to RGB or YUV components. */
     TiffFormat format;    /**< Format of output picture. */
+    void* alpha;          /**< Alpha plane of 4-sample pictures, NULL if there is none. Set only when
+                               requested by the decoder, added in API version 3. */
 } TiffDecOutput;
 
 /** @brief Handle to decoder instance
@@ -115,6 +117,21 @@ typedef Status (*TiffDecProcess)(TiffDecHandle handle,   /**< [in/out] Decoder i
                                  const TiffDecInput* in, /**< [in] Encoded input */
                                  TiffDecOutput* out);    /**< [out] Decoded output */
 
+/** @brief Queue tiff picture for decoding. Added in API version 2.
+ *  Input is copied, so caller may release it when function returns. Queued pictures
+ *  are decoded concurrently and returned by TiffDecCollect in submission order.
+ *  @return status code, STATUS_ERROR if queue is full and oldest picture has to be collected first
+ */
+typedef Status (*TiffDecSubmit)(TiffDecHandle handle,    /**< [in/out] Decoder instance handle */
+                                const TiffDecInput* in); /**< [in] Encoded input */
+
+/** @brief Get oldest submitted picture, waits until it is decoded. Added in API version 2.
+ *  Output stays valid until next call to TiffDecCollect.
+ *  @return status code, STATUS_ERROR if decoding failed or no picture was submitted
+ */
+typedef Status (*TiffDecCollect)(TiffDecHandle handle, /**< [in/out] Decoder instance handle */
+                                 TiffDecOutput* out);  /**< [out] Decoded output */
+
 /** @brief Property setter
  *  @return status code
  */
@@ -143,6 +160,8 @@ typedef struct {
     TiffDecSetProperty setProperty;
     TiffDecGetProperty getProperty;
     TiffDecGetMessage getMessage;
+    TiffDecSubmit submit;   /**< API version 2 */
+    TiffDecCollect collect; /**< API version 2 */
 } TiffDecApi;
 
 /** @brief Export symbol to access implementation of TIFF Decoder plugin
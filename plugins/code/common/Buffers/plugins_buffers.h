@@ -0,0 +1,120 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_BUFFERS_H__
+#define __DEE_PLUGINS_BUFFERS_H__
+
+/* Frame buffers owned by plugins that return output frames to the caller */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/** @brief Set of reusable buffers handed out until they are given back
+ *  Released buffers are kept and reused by later requests, so steady streams of
+ *  same-sized frames allocate only once per buffer held at the same time. Buffers
+ *  start at a multiple of 64 bytes, as needed by aligned and streaming SIMD stores.
+ */
+class plugins_buffer_pool {
+  public:
+    plugins_buffer_pool() {}
+    ~plugins_buffer_pool() { clear(); }
+
+    /** @brief Returns buffer of at least 'size' bytes, its capacity is stored in 'capacity' */
+    uint8_t* acquire(size_t size, size_t& capacity) {
+        buffer_t* buffer = NULL;
+        for (size_t i = 0; i < buffers.size(); i++) {
+            if (buffers[i]->used)
+                continue;
+            /* Prefer buffer which is already large enough */
+            if (!buffer || (buffer->capacity() < size && buffers[i]->capacity() > buffer->capacity()))
+                buffer = buffers[i];
+        }
+        if (!buffer) {
+            buffer = new buffer_t;
+            buffers.push_back(buffer);
+        }
+        if (buffer->capacity() < size) {
+            buffer->storage.resize(size + alignment - 1);
+            buffer->offset = (alignment - (size_t)((uintptr_t)buffer->storage.data() % alignment)) % alignment;
+        }
+        buffer->used = true;
+        capacity = buffer->capacity();
+        return buffer->data();
+    }
+
+    /** @brief Gives buffer back, returns false if it was not handed out by this pool */
+    bool release(const uint8_t* data) {
+        for (size_t i = 0; i < buffers.size(); i++) {
+            if (buffers[i]->used && buffers[i]->data() == data) {
+                buffers[i]->used = false;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** @brief Number of buffers handed out and not released yet */
+    size_t used() const {
+        size_t count = 0;
+        for (size_t i = 0; i < buffers.size(); i++)
+            count += buffers[i]->used ? 1 : 0;
+        return count;
+    }
+
+    /** @brief Frees all buffers, including those which were not released */
+    void clear() {
+        for (size_t i = 0; i < buffers.size(); i++)
+            delete buffers[i];
+        buffers.clear();
+    }
+
+  private:
+    static const size_t alignment = 64;
+
+    struct buffer_t {
+        buffer_t() : offset(0), used(false) {}
+        uint8_t* data() { return storage.data() + offset; }
+        size_t capacity() const { return storage.empty() ? 0 : storage.size() - offset; }
+        std::vector<uint8_t> storage;
+        size_t offset;
+        bool used;
+    };
+
+    plugins_buffer_pool(const plugins_buffer_pool&);
+    plugins_buffer_pool& operator=(const plugins_buffer_pool&);
+
+    std::vector<buffer_t*> buffers;
+};
+
+#endif // __DEE_PLUGINS_BUFFERS_H__
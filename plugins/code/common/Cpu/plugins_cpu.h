@@ -0,0 +1,199 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_CPU_H__
+#define __DEE_PLUGINS_CPU_H__
+
+/* Runtime CPU feature detection used by plugins to dispatch SIMD kernels.
+ * Kernels are compiled with DLB_TARGET() function attribute, so no special
+ * compiler flags are needed and the plugin still runs on older CPUs.
+ */
+
+#include <stddef.h>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DLB_X86 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DLB_TARGET(arch) __attribute__((target(arch)))
+#else
+#define DLB_TARGET(arch)
+#endif
+
+#define DLB_TARGET_SSE41 DLB_TARGET("sse4.1")
+#define DLB_TARGET_AVX2 DLB_TARGET("avx2,fma")
+#define DLB_TARGET_AVX512 DLB_TARGET("avx512f,avx512bw,avx512vl")
+
+/** @brief Instruction set levels, ordered from the least to the most capable */
+typedef enum {
+    CPU_LEVEL_SCALAR = 0,
+    CPU_LEVEL_SSE41,
+    CPU_LEVEL_AVX2,
+    CPU_LEVEL_AVX512, /**< AVX-512 F + BW + VL */
+} CpuLevel;
+
+static inline CpuLevel detect_cpu_level() {
+#if defined(DLB_X86)
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"))
+        return CPU_LEVEL_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return CPU_LEVEL_AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return CPU_LEVEL_SSE41;
+#elif defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    int maxLeaf = regs[0];
+    __cpuid(regs, 1);
+    bool sse41 = (regs[2] & (1 << 19)) != 0;
+    bool fma = (regs[2] & (1 << 12)) != 0;
+    bool osxsave = (regs[2] & (1 << 27)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool osYmm = (xcr0 & 0x6) == 0x6;
+    bool osZmm = (xcr0 & 0xe6) == 0xe6;
+    bool avx2 = false, avx512 = false;
+    if (maxLeaf >= 7) {
+        __cpuidex(regs, 7, 0);
+        avx2 = (regs[1] & (1 << 5)) != 0;
+        avx512 = (regs[1] & (1 << 16)) && (regs[1] & (1 << 30)) && (regs[1] & (1u << 31));
+    }
+    if (avx512 && avx2 && fma && osZmm)
+        return CPU_LEVEL_AVX512;
+    if (avx2 && fma && osYmm)
+        return CPU_LEVEL_AVX2;
+    if (sse41)
+        return CPU_LEVEL_SSE41;
+#endif
+#endif
+    return CPU_LEVEL_SCALAR;
+}
+
+/** @brief Highest instruction set level supported by CPU and OS, detected once */
+static inline CpuLevel cpu_level() {
+    static const CpuLevel level = detect_cpu_level();
+    return level;
+}
+
+static inline const char* cpu_level_name(CpuLevel level) {
+    switch (level) {
+    case CPU_LEVEL_SSE41:
+        return "sse4.1";
+    case CPU_LEVEL_AVX2:
+        return "avx2";
+    case CPU_LEVEL_AVX512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+/** @brief Parses "auto", "scalar", "sse4.1", "avx2" or "avx512"
+ *  Requested level is limited to what the CPU supports.
+ *  @return false if value is not recognized
+ */
+static inline bool parse_cpu_level(const std::string& value, CpuLevel& level) {
+    CpuLevel requested;
+    if ("auto" == value)
+        requested = CPU_LEVEL_AVX512;
+    else if ("scalar" == value)
+        requested = CPU_LEVEL_SCALAR;
+    else if ("sse4.1" == value)
+        requested = CPU_LEVEL_SSE41;
+    else if ("avx2" == value)
+        requested = CPU_LEVEL_AVX2;
+    else if ("avx512" == value)
+        requested = CPU_LEVEL_AVX512;
+    else
+        return false;
+    level = requested < cpu_level() ? requested : cpu_level();
+    return true;
+}
+
+#if defined(DLB_X86)
+static inline void cpuid_count(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    __cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* Walks deterministic cache parameters of 'leaf' (4 on Intel, 0x8000001D on AMD) */
+static inline size_t largest_cache(unsigned leaf) {
+    size_t largest = 0;
+    for (unsigned i = 0; i < 16; i++) {
+        unsigned regs[4];
+        cpuid_count(leaf, i, regs);
+        if (0 == (regs[0] & 0x1f))
+            break;
+        size_t ways = ((regs[1] >> 22) & 0x3ff) + 1;
+        size_t partitions = ((regs[1] >> 12) & 0x3ff) + 1;
+        size_t line = (regs[1] & 0xfff) + 1;
+        size_t sets = (size_t)regs[2] + 1;
+        if (ways * partitions * line * sets > largest)
+            largest = ways * partitions * line * sets;
+    }
+    return largest;
+}
+#endif
+
+static inline size_t detect_cache_size() {
+    size_t size = 0;
+#if defined(DLB_X86)
+    unsigned regs[4];
+    cpuid_count(0, 0, regs);
+    if (regs[0] >= 4)
+        size = largest_cache(4);
+    cpuid_count(0x80000000u, 0, regs);
+    if (0 == size && regs[0] >= 0x8000001Du)
+        size = largest_cache(0x8000001Du);
+#endif
+    return size;
+}
+
+/** @brief Size of the last level cache in bytes, detected once. 0 if it is not known. */
+static inline size_t cpu_cache_size() {
+    static const size_t size = detect_cache_size();
+    return size;
+}
+
+#endif // __DEE_PLUGINS_CPU_H__
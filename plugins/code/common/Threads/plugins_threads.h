@@ -0,0 +1,128 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_THREADS_H__
+#define __DEE_PLUGINS_THREADS_H__
+
+/* Worker threads shared by plugins that split frames into independent parts */
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** @brief Fixed set of worker threads running one job at a time
+ *  The calling thread takes part in every job as worker 0, so a pool of size 1
+ *  runs jobs inline without any thread.
+ */
+class plugins_worker_pool {
+  public:
+    plugins_worker_pool() : job(NULL), generation(0), pending(0), stopping(false) {}
+    ~plugins_worker_pool() { stop(); }
+
+    /** @brief Starts 'size' - 1 threads, previous threads are stopped first */
+    void start(unsigned size) {
+        stop();
+        for (unsigned i = 1; i < size; i++)
+            threads.push_back(std::thread(&plugins_worker_pool::worker_loop, this, i, generation));
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+        threads.clear();
+        stopping = false;
+    }
+
+    unsigned size() const { return (unsigned)threads.size() + 1; }
+
+    /** @brief Calls job(worker) once for each worker index and waits until all calls return */
+    void run(const std::function<void(unsigned)>& fn) {
+        if (threads.empty()) {
+            fn(0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            pending = (unsigned)threads.size();
+            generation++;
+        }
+        wake.notify_all();
+        fn(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return 0 == pending; });
+        job = NULL;
+    }
+
+  private:
+    void worker_loop(unsigned worker, unsigned long long seen) {
+        for (;;) {
+            const std::function<void(unsigned)>* fn;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                fn = job;
+            }
+            (*fn)(worker);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+            }
+            done.notify_one();
+        }
+    }
+
+    plugins_worker_pool(const plugins_worker_pool&);
+    plugins_worker_pool& operator=(const plugins_worker_pool&);
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(unsigned)>* job;
+    unsigned long long generation;
+    unsigned pending;
+    bool stopping;
+};
+
+#endif // __DEE_PLUGINS_THREADS_H__
@@ -0,0 +1,173 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Measures arrangement kernels in GB/s per core, counting bytes read and written.
+ * Every thread converts its own contiguous part of the frame, as the transformer does.
+ * Usage: image_transformer_arrangement_kernels_bench [repetitions] [threads]
+ */
+
+#include "image_transformer_arrangement_kernels.h"
+#include "plugins_threads.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct frame_size_t {
+    const char* name;
+    size_t width;
+    size_t height;
+};
+
+static const frame_size_t frame_sizes[] = {
+    {"HD", 1920, 1080},
+    {"4K", 3840, 2160},
+    {"8K", 7680, 4320},
+};
+
+/* Parts start at multiples of this many pixels, so streaming stores stay aligned in every plane */
+static const size_t part_align = 128;
+
+/* 64-byte aligned buffer, as frame buffers of the transformer are */
+class aligned_buffer_t {
+  public:
+    explicit aligned_buffer_t(size_t size) : storage(size + 63) {
+        data = storage.data() + ((64 - ((uintptr_t)storage.data() & 63)) & 63);
+    }
+
+    std::vector<uint8_t> storage;
+    uint8_t* data;
+};
+
+struct bench_case_t {
+    bool interleave;
+    int bytes;
+    bool subsampled;
+    size_t pixels;
+    const uint8_t* src;
+    uint8_t* dst;
+};
+
+static void convert_part(const bench_case_t& c, CpuLevel level, bool stream, size_t first, size_t count) {
+    const size_t lumaSize = c.pixels * c.bytes;
+    const size_t chromaSize = c.subsampled ? lumaSize / 2 : lumaSize;
+    const size_t planeOffset[3] = {0, lumaSize, lumaSize + chromaSize};
+    const size_t pixelBytes = (c.subsampled ? 2 : 3) * c.bytes;
+    size_t offset[3];
+    for (int s = 0; s < 3; s++)
+        offset[s] = planeOffset[s] + (s && c.subsampled ? first / 2 : first) * c.bytes;
+    if (c.interleave) {
+        const uint8_t* part[3] = {c.src + offset[0], c.src + offset[1], c.src + offset[2]};
+        arrangement_interleave(level, c.bytes, c.subsampled, part, count, c.dst + first * pixelBytes, stream);
+    }
+    else {
+        uint8_t* part[3] = {c.dst + offset[0], c.dst + offset[1], c.dst + offset[2]};
+        arrangement_deinterleave(level, c.bytes, c.subsampled, c.src + first * pixelBytes, count, part, stream);
+    }
+}
+
+/* Returns fastest of 'reps' conversions in milliseconds */
+static double fastest_ms(plugins_worker_pool& pool, int reps, const bench_case_t& c, CpuLevel level, bool stream) {
+    const size_t threads = pool.size();
+    double best = 0;
+    for (int r = 0; r < reps; r++) {
+        bench_clock::time_point start = bench_clock::now();
+        pool.run([&](unsigned worker) {
+            const size_t first = c.pixels * worker / threads / part_align * part_align;
+            const size_t last =
+                worker + 1 == threads ? c.pixels : c.pixels * (worker + 1) / threads / part_align * part_align;
+            convert_part(c, level, stream, first, last - first);
+        });
+        double ms = std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+        if (0 == r || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int reps = argc > 1 ? std::atoi(argv[1]) : 10;
+    int threads = argc > 2 ? std::atoi(argv[2]) : 1;
+    if (reps < 1 || threads < 1 || threads > 255) {
+        fprintf(stderr, "Usage: %s [repetitions] [threads]\n", argv[0]);
+        return 1;
+    }
+    plugins_worker_pool pool;
+    pool.start((unsigned)threads);
+
+    int failures = 0;
+    printf("GB/s per core with %d thread(s), fastest of %d runs\n", threads, reps);
+    printf("%-4s %-12s %-5s %-4s", "size", "direction", "bits", "sub");
+    for (int level = CPU_LEVEL_SCALAR; level <= cpu_level(); level++)
+        printf(" %8s", cpu_level_name((CpuLevel)level));
+    printf(" %8s\n", "stream");
+    for (const frame_size_t& size : frame_sizes) {
+        for (int interleave = 1; interleave >= 0; interleave--) {
+            for (int bytes = 1; bytes <= 2; bytes++) {
+                for (int subsampled = 0; subsampled <= 1; subsampled++) {
+                    const size_t pixels = size.width * size.height;
+                    const size_t frameSize = pixels * bytes * (subsampled ? 2 : 3);
+                    aligned_buffer_t src(frameSize);
+                    aligned_buffer_t dst(frameSize);
+                    std::vector<uint8_t> expected(frameSize);
+                    for (size_t i = 0; i < frameSize; i++)
+                        src.data[i] = (uint8_t)(i * 2654435761u >> 24);
+                    bench_case_t c = {0 != interleave, bytes, 0 != subsampled, pixels, src.data, dst.data};
+                    convert_part(c, CPU_LEVEL_SCALAR, false, 0, pixels);
+                    memcpy(expected.data(), dst.data, frameSize);
+
+                    printf("%-4s %-12s %-5d %-4s", size.name, interleave ? "interleave" : "deinterleave", 8 * bytes,
+                           subsampled ? "422" : "444");
+                    const double gigabytes = 2.0 * (double)frameSize / 1e9;
+                    for (int level = CPU_LEVEL_SCALAR; level <= cpu_level() + 1; level++) {
+                        const bool stream = level > cpu_level();
+                        const CpuLevel kernel = stream ? cpu_level() : (CpuLevel)level;
+                        memset(dst.data, 0, frameSize);
+                        const double ms = fastest_ms(pool, reps, c, kernel, stream);
+                        const bool same = 0 == memcmp(expected.data(), dst.data, frameSize);
+                        printf(" %8.2f%s", gigabytes / (ms / 1000.0) / threads, same ? "" : "!");
+                        if (!same)
+                            failures++;
+                    }
+                    printf("\n");
+                }
+            }
+        }
+    }
+    if (failures)
+        printf("%d kernel(s) differ from scalar result, marked with '!'\n", failures);
+    return failures ? 1 : 0;
+}
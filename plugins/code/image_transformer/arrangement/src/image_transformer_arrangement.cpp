@@ -0,0 +1,329 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_api.h"
+#include "image_transformer_arrangement_kernels.h"
+#include "plugins_buffers.h"
+#include "plugins_threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static const PropertyInfo img_transformer_info[] = {
+    {"arrangement", PROPERTY_TYPE_STRING,
+     "Arrangement of output samples. Interleaved 4:4:4 stores three samples per pixel, interleaved 4:2:2 stores "
+     "pixel pairs as Y Cb Y Cr. 4:2:0 has no interleaved arrangement.",
+     "planar", "planar:interleaved", 0, 1, ACCESS_TYPE_USER},
+    {"streaming", PROPERTY_TYPE_STRING,
+     "Non-temporal stores, which bypass the cache. 'auto' uses them when input and output frames together do not fit "
+     "the last level cache.",
+     "auto", "auto:on:off", 0, 1, ACCESS_TYPE_USER},
+    {"simd", PROPERTY_TYPE_STRING, "Instruction set used by conversion kernels, limited to what the CPU supports.",
+     "auto", "auto:scalar:sse4.1:avx2:avx512", 0, 1, ACCESS_TYPE_USER},
+    {"thread_num", PROPERTY_TYPE_INTEGER, "Number of threads converting parts of frame (0 = number of logical CPUs).",
+     "0", "0:255", 0, 1, ACCESS_TYPE_USER},
+};
+
+static size_t img_transformer_arrangement_get_info(const PropertyInfo** info) {
+    *info = img_transformer_info;
+    return sizeof(img_transformer_info) / sizeof(PropertyInfo);
+}
+
+/* Pixels converted by one job. Multiple of 128 keeps parts of 64-byte aligned planes aligned. */
+static const size_t job_pixels = 1 << 16;
+
+struct img_transformer_arrangement_data_t {
+    std::string msg;
+    ImgTransformerArrangement arrangement{PLANAR};
+    std::string streaming{"auto"};
+    CpuLevel cpuLevel{cpu_level()};
+    int threadNum{0};
+    plugins_worker_pool pool;
+    plugins_buffer_pool frames; /* Outputs of processTo and copy of input of process */
+};
+
+/* This structure can contain only pointers and simple types */
+struct img_transformer_arrangement_t {
+    img_transformer_arrangement_data_t* data;
+};
+
+static size_t img_transformer_arrangement_get_size() {
+    return sizeof(img_transformer_arrangement_t);
+}
+
+static Status img_transformer_arrangement_init(ImgTransformerHandle handle,
+                                               const ImgTransformerInitParams* init_params) {
+    img_transformer_arrangement_t* state = (img_transformer_arrangement_t*)handle;
+    state->data = new img_transformer_arrangement_data_t;
+    auto invalidValue = [&](const std::string& option, const std::string& value, const std::string& expectedValues) {
+        return "Invalid '" + option + "' option value: '" + value + "'. Expected value: " + expectedValues + ".";
+    };
+    for (int i = 0; i < (int)init_params->count; i++) {
+        std::string name(init_params->properties[i].name);
+        std::string value(init_params->properties[i].value);
+        if (name == "arrangement") {
+            if (value == "planar")
+                state->data->arrangement = PLANAR;
+            else if (value == "interleaved")
+                state->data->arrangement = INTERLEAVED;
+            else {
+                state->data->msg = invalidValue(name, value, "planar:interleaved");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "streaming") {
+            if (value != "auto" && value != "on" && value != "off") {
+                state->data->msg = invalidValue(name, value, "auto:on:off");
+                return STATUS_ERROR;
+            }
+            state->data->streaming = value;
+        }
+        else if (name == "simd") {
+            if (!parse_cpu_level(value, state->data->cpuLevel)) {
+                state->data->msg = invalidValue(name, value, "auto:scalar:sse4.1:avx2:avx512");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "thread_num") {
+            state->data->threadNum = std::atoi(value.c_str());
+            if (state->data->threadNum < 0 || state->data->threadNum > 255) {
+                state->data->msg = invalidValue(name, value, "0:255");
+                return STATUS_ERROR;
+            }
+        }
+        else {
+            state->data->msg = "Could not recognise option '" + name + "'.";
+            return STATUS_ERROR;
+        }
+    }
+
+    if (0 == state->data->threadNum)
+        state->data->threadNum = std::max(1, (int)std::thread::hardware_concurrency());
+    state->data->pool.start(state->data->threadNum);
+
+    state->data->msg = "SIMD: " + std::string(cpu_level_name(state->data->cpuLevel));
+    state->data->msg += "\nThreads: " + std::to_string(state->data->threadNum);
+    if (state->data->streaming == "auto")
+        state->data->msg += "\nLast level cache: " + std::to_string(cpu_cache_size() >> 10) + " KiB";
+    return STATUS_OK;
+}
+
+static Status img_transformer_arrangement_close(ImgTransformerHandle handle) {
+    img_transformer_arrangement_t* state = (img_transformer_arrangement_t*)handle;
+    if (state && state->data) {
+        delete state->data;
+        state->data = nullptr;
+    }
+    return STATUS_OK;
+}
+
+/* Bytes per sample, 0 if bit depth is not known */
+static int sample_bytes(ImgTransformerBitdepth bitdepth) {
+    switch (bitdepth) {
+    case BIT_DEPTH_UINT8:
+        return 1;
+    case BIT_DEPTH_UINT10_LSB:
+    case BIT_DEPTH_UINT12_LSB:
+    case BIT_DEPTH_UINT14_LSB:
+    case BIT_DEPTH_UINT16:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+/* Size of frame in bytes, the same in both arrangements */
+static int64_t frame_size(const ImgTransformerMetadata& metadata) {
+    const size_t samples = SUBSAMPLING_S422 == metadata.subsampling ? 2 : 3;
+    return (int64_t)(samples * (size_t)metadata.width * (size_t)metadata.height *
+                     (size_t)sample_bytes(metadata.bitdepth));
+}
+
+static bool check_input(img_transformer_arrangement_data_t* data, const ImgTransformerMetadata& metadata,
+                        const int64_t* size) {
+    if (0 == sample_bytes(metadata.bitdepth)) {
+        data->msg = "Input must have 8 to 16 bits per sample.";
+        return false;
+    }
+    if (SUBSAMPLING_S444 != metadata.subsampling && SUBSAMPLING_S422 != metadata.subsampling) {
+        data->msg = "Only 4:4:4 and 4:2:2 frames can be interleaved.";
+        return false;
+    }
+    if (SUBSAMPLING_S422 == metadata.subsampling && metadata.width % 2) {
+        data->msg = "Width of 4:2:2 frame must be even.";
+        return false;
+    }
+    if (metadata.width <= 0 || metadata.height <= 0 || (size && *size < frame_size(metadata))) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return false;
+    }
+    return true;
+}
+
+/* Converts checked frame from 'src' to 'dst', which must not overlap */
+static void convert(img_transformer_arrangement_data_t* data, const ImgTransformerMetadata& metadata,
+                    const uint8_t* src, uint8_t* dst) {
+    const int bytes = sample_bytes(metadata.bitdepth);
+    const bool subsampled = SUBSAMPLING_S422 == metadata.subsampling;
+    const size_t pixels = (size_t)metadata.width * (size_t)metadata.height;
+    const size_t lumaSize = pixels * bytes;
+    const size_t chromaSize = subsampled ? lumaSize / 2 : lumaSize;
+    const bool interleave = INTERLEAVED == data->arrangement;
+    bool stream = data->streaming == "on";
+    if (data->streaming == "auto")
+        stream = cpu_cache_size() && 2 * (size_t)frame_size(metadata) > cpu_cache_size();
+
+    const size_t planeOffset[3] = {0, lumaSize, lumaSize + chromaSize};
+    const size_t pixelBytes = (subsampled ? 2 : 3) * bytes;
+    const CpuLevel level = data->cpuLevel;
+    const size_t jobs = (pixels + job_pixels - 1) / job_pixels;
+    std::atomic<size_t> next(0);
+    data->pool.run([&](unsigned) {
+        for (size_t job = next++; job < jobs; job = next++) {
+            const size_t first = job * job_pixels;
+            const size_t count = std::min(pixels - first, job_pixels);
+            size_t offset[3];
+            for (int s = 0; s < 3; s++)
+                offset[s] = planeOffset[s] + (s && subsampled ? first / 2 : first) * bytes;
+            if (interleave) {
+                const uint8_t* part[3] = {src + offset[0], src + offset[1], src + offset[2]};
+                arrangement_interleave(level, bytes, subsampled, part, count, dst + first * pixelBytes, stream);
+            }
+            else {
+                uint8_t* part[3] = {dst + offset[0], dst + offset[1], dst + offset[2]};
+                arrangement_deinterleave(level, bytes, subsampled, src + first * pixelBytes, count, part, stream);
+            }
+        }
+    });
+}
+
+/* Frame is copied to a buffer of the plugin and converted back to its place */
+static Status img_transformer_arrangement_process(ImgTransformerHandle handle, ImgTransformerFrame* frame) {
+    img_transformer_arrangement_t* state = (img_transformer_arrangement_t*)handle;
+    img_transformer_arrangement_data_t* data = state->data;
+    data->msg.clear();
+
+    if (!check_input(data, frame->metadata, &frame->data.size))
+        return STATUS_ERROR;
+    if (frame->metadata.arrangement == data->arrangement)
+        return STATUS_OK;
+
+    const size_t size = (size_t)frame_size(frame->metadata);
+    size_t capacity = 0;
+    uint8_t* copy = data->frames.acquire(size, capacity);
+    memcpy(copy, frame->data.buffer, size);
+    convert(data, frame->metadata, copy, frame->data.buffer);
+    data->frames.release(copy);
+
+    frame->metadata.arrangement = data->arrangement;
+    return STATUS_OK;
+}
+
+/* Converts into a buffer of the plugin without an intermediate copy */
+static Status img_transformer_arrangement_process_to(ImgTransformerHandle handle, const ImgTransformerFrame* inFrame,
+                                                     ImgTransformerFrame* outFrame) {
+    img_transformer_arrangement_t* state = (img_transformer_arrangement_t*)handle;
+    img_transformer_arrangement_data_t* data = state->data;
+    data->msg.clear();
+
+    if (!check_input(data, inFrame->metadata, &inFrame->data.size))
+        return STATUS_ERROR;
+    const int64_t size = frame_size(inFrame->metadata);
+    size_t capacity = 0;
+    uint8_t* buffer = data->frames.acquire((size_t)size, capacity);
+    if (inFrame->metadata.arrangement == data->arrangement)
+        memcpy(buffer, inFrame->data.buffer, (size_t)size);
+    else
+        convert(data, inFrame->metadata, inFrame->data.buffer, buffer);
+
+    outFrame->metadata = inFrame->metadata;
+    outFrame->metadata.arrangement = data->arrangement;
+    outFrame->data.buffer = buffer;
+    outFrame->data.size = size;
+    outFrame->data.bufferSize = (int64_t)capacity;
+    return STATUS_OK;
+}
+
+static Status img_transformer_arrangement_release(ImgTransformerHandle handle, ImgTransformerFrame* outFrame) {
+    img_transformer_arrangement_t* state = (img_transformer_arrangement_t*)handle;
+    if (!state->data->frames.release(outFrame->data.buffer)) {
+        state->data->msg = "Frame was not returned by this plugin or was already released.";
+        return STATUS_ERROR;
+    }
+    outFrame->data.buffer = NULL;
+    return STATUS_OK;
+}
+
+static Status img_transformer_arrangement_get_output_size(ImgTransformerHandle handle,
+                                                          const ImgTransformerMetadata* inMetadata,
+                                                          ImgTransformerMetadata* outMetadata, int64_t* outSize) {
+    img_transformer_arrangement_t* state = (img_transformer_arrangement_t*)handle;
+    state->data->msg.clear();
+    if (!check_input(state->data, *inMetadata, NULL))
+        return STATUS_ERROR;
+    *outMetadata = *inMetadata;
+    outMetadata->arrangement = state->data->arrangement;
+    *outSize = frame_size(*inMetadata);
+    return STATUS_OK;
+}
+
+static const char* img_transformer_arrangement_get_message(ImgTransformerHandle handle) {
+    img_transformer_arrangement_t* state = (img_transformer_arrangement_t*)handle;
+    if (state && state->data)
+        return state->data->msg.empty() ? NULL : state->data->msg.c_str();
+    else
+        return NULL;
+}
+
+static ImgTransformerApi img_transformer_arrangement_plugin_api = {"arrangement",
+                                                                   img_transformer_arrangement_get_info,
+                                                                   img_transformer_arrangement_get_size,
+                                                                   img_transformer_arrangement_init,
+                                                                   img_transformer_arrangement_close,
+                                                                   img_transformer_arrangement_process,
+                                                                   img_transformer_arrangement_get_message,
+                                                                   img_transformer_arrangement_get_output_size,
+                                                                   img_transformer_arrangement_process_to,
+                                                                   img_transformer_arrangement_release};
+
+DLB_EXPORT
+ImgTransformerApi* imgTransformerGetApi() {
+    return &img_transformer_arrangement_plugin_api;
+}
+
+DLB_EXPORT
+int imgTransformerGetApiVersion(void) {
+    return IMG_TRANSFORMER_API_VERSION;
+}
@@ -0,0 +1,457 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_arrangement_kernels.h"
+
+#include <string.h>
+
+/* SIMD kernels work on blocks of 16 byte vectors. A block holds 3 vectors of
+ * 4:4:4 planes (one of each plane) or 4 vectors of 4:2:2 planes (two of luma),
+ * and the same number of interleaved vectors. Every interleaved vector is made
+ * by shuffling bytes of the planar vectors and vice versa, so one table driven
+ * kernel serves both sample sizes. Wider instruction sets work on several
+ * blocks at once, one in each 128-bit lane. */
+static inline int block_vectors(bool subsampled) {
+    return subsampled ? 4 : 3;
+}
+
+/* Planar vector 'v' is 16 bytes of vector_plane() at vector_offset() within the block */
+static inline int vector_plane(bool subsampled, int v) {
+    return subsampled ? (v < 2 ? 0 : v - 1) : v;
+}
+
+static inline size_t vector_offset(bool subsampled, int v) {
+    return (subsampled && 1 == v) ? 16 : 0;
+}
+
+/* Bytes of a plane in a block */
+static inline size_t plane_bytes(bool subsampled, int plane) {
+    return (subsampled && 0 == plane) ? 32 : 16;
+}
+
+/* Whether output vector 'o' takes bytes of input vector 'i'. Interleaved 4:2:2
+ * vectors take one luma vector and both chroma vectors, 4:4:4 vectors take all. */
+static inline bool vector_used(bool subsampled, bool interleave, int o, int i) {
+    if (!subsampled)
+        return true;
+    return interleave ? (i >= 2 || i == o / 2) : (o >= 2 || i / 2 == o);
+}
+
+struct arrangement_program_t {
+    size_t pixels;         /* Pixels of a block */
+    int8_t mask[4][4][16]; /* [out][in] shuffle control, -1 clears the byte */
+};
+
+static void make_program(int bytes, bool subsampled, bool interleave, arrangement_program_t& program) {
+    memset(program.mask, -1, sizeof(program.mask));
+    program.pixels = (subsampled ? 32 : 16) / bytes;
+    for (int p = 0; p < 16 * block_vectors(subsampled); p++) {
+        int sample = p / bytes;
+        int plane, index;
+        if (subsampled) {
+            /* Y Cb Y Cr */
+            static const int planes[4] = {0, 1, 0, 2};
+            int pair = sample / 4;
+            plane = planes[sample % 4];
+            index = 0 == plane ? 2 * pair + (sample % 4) / 2 : pair;
+        }
+        else {
+            plane = sample % 3;
+            index = sample / 3;
+        }
+        size_t q = (size_t)(index * bytes + p % bytes);
+        int v = 0;
+        while (vector_plane(subsampled, v) != plane || q < vector_offset(subsampled, v) ||
+               q >= vector_offset(subsampled, v) + 16)
+            v++;
+        q -= vector_offset(subsampled, v);
+        if (interleave)
+            program.mask[p / 16][v][p % 16] = (int8_t)q;
+        else
+            program.mask[v][p / 16][q] = (int8_t)(p % 16);
+    }
+}
+
+static const arrangement_program_t& get_program(int bytes, bool subsampled, bool interleave) {
+    struct programs_t {
+        arrangement_program_t program[2][2][2];
+        programs_t() {
+            for (int b = 0; b < 2; b++)
+                for (int s = 0; s < 2; s++)
+                    for (int i = 0; i < 2; i++)
+                        make_program(b + 1, 0 != s, 0 != i, program[b][s][i]);
+        }
+    };
+    static const programs_t programs;
+    return programs.program[bytes - 1][subsampled ? 1 : 0][interleave ? 1 : 0];
+}
+
+template <typename T>
+static void interleave_scalar(bool subsampled, const T* const src[3], size_t first, size_t pixels, T* dst) {
+    if (subsampled) {
+        for (size_t i = first / 2; i < pixels / 2; i++) {
+            dst[4 * i] = src[0][2 * i];
+            dst[4 * i + 1] = src[1][i];
+            dst[4 * i + 2] = src[0][2 * i + 1];
+            dst[4 * i + 3] = src[2][i];
+        }
+    }
+    else {
+        for (size_t i = first; i < pixels; i++) {
+            dst[3 * i] = src[0][i];
+            dst[3 * i + 1] = src[1][i];
+            dst[3 * i + 2] = src[2][i];
+        }
+    }
+}
+
+template <typename T>
+static void deinterleave_scalar(bool subsampled, const T* src, size_t first, size_t pixels, T* const dst[3]) {
+    if (subsampled) {
+        for (size_t i = first / 2; i < pixels / 2; i++) {
+            dst[0][2 * i] = src[4 * i];
+            dst[1][i] = src[4 * i + 1];
+            dst[0][2 * i + 1] = src[4 * i + 2];
+            dst[2][i] = src[4 * i + 3];
+        }
+    }
+    else {
+        for (size_t i = first; i < pixels; i++) {
+            dst[0][i] = src[3 * i];
+            dst[1][i] = src[3 * i + 1];
+            dst[2][i] = src[3 * i + 2];
+        }
+    }
+}
+
+static bool aligned(const void* p) {
+    return 0 == ((uintptr_t)p & 63);
+}
+
+#if defined(DLB_X86)
+
+/* Lane 'l' of a vector is 16 bytes at p + l * stride, contiguous lanes are accessed at once */
+DLB_TARGET_SSE41
+static inline void store_lane(uint8_t* p, __m128i v, bool stream) {
+    if (stream)
+        _mm_stream_si128((__m128i*)p, v);
+    else
+        _mm_storeu_si128((__m128i*)p, v);
+}
+
+DLB_TARGET_SSE41
+static inline __m128i load_sse41(const uint8_t* p, size_t) {
+    return _mm_loadu_si128((const __m128i*)p);
+}
+
+DLB_TARGET_SSE41
+static inline void store_sse41(uint8_t* p, size_t, __m128i v, bool stream) {
+    store_lane(p, v, stream);
+}
+
+DLB_TARGET_AVX2
+static inline __m256i load_avx2(const uint8_t* p, size_t stride) {
+    if (16 == stride)
+        return _mm256_loadu_si256((const __m256i*)p);
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+                                   _mm_loadu_si128((const __m128i*)(p + stride)), 1);
+}
+
+DLB_TARGET_AVX2
+static inline void store_avx2(uint8_t* p, size_t stride, __m256i v, bool stream) {
+    if (16 != stride) {
+        store_lane(p, _mm256_castsi256_si128(v), stream);
+        store_lane(p + stride, _mm256_extracti128_si256(v, 1), stream);
+    }
+    else if (stream)
+        _mm256_stream_si256((__m256i*)p, v);
+    else
+        _mm256_storeu_si256((__m256i*)p, v);
+}
+
+DLB_TARGET_AVX512
+static inline __m512i load_avx512(const uint8_t* p, size_t stride) {
+    if (16 == stride)
+        return _mm512_loadu_si512(p);
+    __m512i v = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)p));
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(p + stride)), 1);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(p + 2 * stride)), 2);
+    return _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(p + 3 * stride)), 3);
+}
+
+DLB_TARGET_AVX512
+static inline void store_avx512(uint8_t* p, size_t stride, __m512i v, bool stream) {
+    if (16 != stride) {
+        store_lane(p, _mm512_castsi512_si128(v), stream);
+        store_lane(p + stride, _mm512_extracti32x4_epi32(v, 1), stream);
+        store_lane(p + 2 * stride, _mm512_extracti32x4_epi32(v, 2), stream);
+        store_lane(p + 3 * stride, _mm512_extracti32x4_epi32(v, 3), stream);
+    }
+    else if (stream)
+        _mm512_stream_si512((__m512i*)p, v);
+    else
+        _mm512_storeu_si512(p, v);
+}
+
+/* Kernels convert several blocks per iteration, one in each 128-bit lane. Planar
+ * vectors of consecutive blocks are plane_bytes() apart in their plane, interleaved
+ * vectors 16 * block_vectors() bytes apart. */
+template <bool subsampled>
+DLB_TARGET_SSE41
+static size_t interleave_sse41(const arrangement_program_t& program, const uint8_t* const src[3], size_t pixels,
+                               uint8_t* dst, bool stream) {
+    const int n = block_vectors(subsampled);
+    const size_t ilBytes = 16 * (size_t)n;
+    __m128i mask[4][4];
+    for (int o = 0; o < n; o++)
+        for (int i = 0; i < n; i++)
+            mask[o][i] = (_mm_loadu_si128((const __m128i*)program.mask[o][i]));
+    const size_t blocks = pixels / program.pixels;
+    for (size_t k = 0; k < blocks; k++) {
+        __m128i in[4];
+        for (int v = 0; v < n; v++) {
+            const int plane = vector_plane(subsampled, v);
+            const size_t stride = plane_bytes(subsampled, plane);
+            in[v] = load_sse41(src[plane] + k * stride + vector_offset(subsampled, v), stride);
+        }
+        for (int o = 0; o < n; o++) {
+            __m128i out = _mm_setzero_si128();
+            for (int i = 0; i < n; i++)
+                if (vector_used(subsampled, true, o, i))
+                    out = _mm_or_si128(out, _mm_shuffle_epi8(in[i], mask[o][i]));
+            store_sse41(dst + k * ilBytes + 16 * o, ilBytes, out, stream);
+        }
+    }
+    return blocks * program.pixels;
+}
+
+template <bool subsampled>
+DLB_TARGET_SSE41
+static size_t deinterleave_sse41(const arrangement_program_t& program, const uint8_t* src, size_t pixels,
+                                 uint8_t* const dst[3], bool stream) {
+    const int n = block_vectors(subsampled);
+    const size_t ilBytes = 16 * (size_t)n;
+    __m128i mask[4][4];
+    for (int o = 0; o < n; o++)
+        for (int i = 0; i < n; i++)
+            mask[o][i] = (_mm_loadu_si128((const __m128i*)program.mask[o][i]));
+    const size_t blocks = pixels / program.pixels;
+    for (size_t k = 0; k < blocks; k++) {
+        __m128i in[4];
+        for (int i = 0; i < n; i++)
+            in[i] = load_sse41(src + k * ilBytes + 16 * i, ilBytes);
+        for (int o = 0; o < n; o++) {
+            __m128i out = _mm_setzero_si128();
+            for (int i = 0; i < n; i++)
+                if (vector_used(subsampled, false, o, i))
+                    out = _mm_or_si128(out, _mm_shuffle_epi8(in[i], mask[o][i]));
+            const int plane = vector_plane(subsampled, o);
+            const size_t stride = plane_bytes(subsampled, plane);
+            store_sse41(dst[plane] + k * stride + vector_offset(subsampled, o), stride, out, stream);
+        }
+    }
+    return blocks * program.pixels;
+}
+
+template <bool subsampled>
+DLB_TARGET_AVX2
+static size_t interleave_avx2(const arrangement_program_t& program, const uint8_t* const src[3], size_t pixels,
+                              uint8_t* dst, bool stream) {
+    const int n = block_vectors(subsampled);
+    const size_t ilBytes = 16 * (size_t)n;
+    __m256i mask[4][4];
+    for (int o = 0; o < n; o++)
+        for (int i = 0; i < n; i++)
+            mask[o][i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)program.mask[o][i]));
+    const size_t blocks = pixels / program.pixels / 2 * 2;
+    for (size_t k = 0; k < blocks; k += 2) {
+        __m256i in[4];
+        for (int v = 0; v < n; v++) {
+            const int plane = vector_plane(subsampled, v);
+            const size_t stride = plane_bytes(subsampled, plane);
+            in[v] = load_avx2(src[plane] + k * stride + vector_offset(subsampled, v), stride);
+        }
+        for (int o = 0; o < n; o++) {
+            __m256i out = _mm256_setzero_si256();
+            for (int i = 0; i < n; i++)
+                if (vector_used(subsampled, true, o, i))
+                    out = _mm256_or_si256(out, _mm256_shuffle_epi8(in[i], mask[o][i]));
+            store_avx2(dst + k * ilBytes + 16 * o, ilBytes, out, stream);
+        }
+    }
+    return blocks * program.pixels;
+}
+
+template <bool subsampled>
+DLB_TARGET_AVX2
+static size_t deinterleave_avx2(const arrangement_program_t& program, const uint8_t* src, size_t pixels,
+                                uint8_t* const dst[3], bool stream) {
+    const int n = block_vectors(subsampled);
+    const size_t ilBytes = 16 * (size_t)n;
+    __m256i mask[4][4];
+    for (int o = 0; o < n; o++)
+        for (int i = 0; i < n; i++)
+            mask[o][i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)program.mask[o][i]));
+    const size_t blocks = pixels / program.pixels / 2 * 2;
+    for (size_t k = 0; k < blocks; k += 2) {
+        __m256i in[4];
+        for (int i = 0; i < n; i++)
+            in[i] = load_avx2(src + k * ilBytes + 16 * i, ilBytes);
+        for (int o = 0; o < n; o++) {
+            __m256i out = _mm256_setzero_si256();
+            for (int i = 0; i < n; i++)
+                if (vector_used(subsampled, false, o, i))
+                    out = _mm256_or_si256(out, _mm256_shuffle_epi8(in[i], mask[o][i]));
+            const int plane = vector_plane(subsampled, o);
+            const size_t stride = plane_bytes(subsampled, plane);
+            store_avx2(dst[plane] + k * stride + vector_offset(subsampled, o), stride, out, stream);
+        }
+    }
+    return blocks * program.pixels;
+}
+
+template <bool subsampled>
+DLB_TARGET_AVX512
+static size_t interleave_avx512(const arrangement_program_t& program, const uint8_t* const src[3], size_t pixels,
+                                uint8_t* dst, bool stream) {
+    const int n = block_vectors(subsampled);
+    const size_t ilBytes = 16 * (size_t)n;
+    __m512i mask[4][4];
+    for (int o = 0; o < n; o++)
+        for (int i = 0; i < n; i++)
+            mask[o][i] = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)program.mask[o][i]));
+    const size_t blocks = pixels / program.pixels / 4 * 4;
+    for (size_t k = 0; k < blocks; k += 4) {
+        __m512i in[4];
+        for (int v = 0; v < n; v++) {
+            const int plane = vector_plane(subsampled, v);
+            const size_t stride = plane_bytes(subsampled, plane);
+            in[v] = load_avx512(src[plane] + k * stride + vector_offset(subsampled, v), stride);
+        }
+        for (int o = 0; o < n; o++) {
+            __m512i out = _mm512_setzero_si512();
+            for (int i = 0; i < n; i++)
+                if (vector_used(subsampled, true, o, i))
+                    out = _mm512_or_si512(out, _mm512_shuffle_epi8(in[i], mask[o][i]));
+            store_avx512(dst + k * ilBytes + 16 * o, ilBytes, out, stream);
+        }
+    }
+    return blocks * program.pixels;
+}
+
+template <bool subsampled>
+DLB_TARGET_AVX512
+static size_t deinterleave_avx512(const arrangement_program_t& program, const uint8_t* src, size_t pixels,
+                                  uint8_t* const dst[3], bool stream) {
+    const int n = block_vectors(subsampled);
+    const size_t ilBytes = 16 * (size_t)n;
+    __m512i mask[4][4];
+    for (int o = 0; o < n; o++)
+        for (int i = 0; i < n; i++)
+            mask[o][i] = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)program.mask[o][i]));
+    const size_t blocks = pixels / program.pixels / 4 * 4;
+    for (size_t k = 0; k < blocks; k += 4) {
+        __m512i in[4];
+        for (int i = 0; i < n; i++)
+            in[i] = load_avx512(src + k * ilBytes + 16 * i, ilBytes);
+        for (int o = 0; o < n; o++) {
+            __m512i out = _mm512_setzero_si512();
+            for (int i = 0; i < n; i++)
+                if (vector_used(subsampled, false, o, i))
+                    out = _mm512_or_si512(out, _mm512_shuffle_epi8(in[i], mask[o][i]));
+            const int plane = vector_plane(subsampled, o);
+            const size_t stride = plane_bytes(subsampled, plane);
+            store_avx512(dst[plane] + k * stride + vector_offset(subsampled, o), stride, out, stream);
+        }
+    }
+    return blocks * program.pixels;
+}
+
+#endif
+
+void arrangement_interleave(CpuLevel level, int bytes, bool subsampled, const uint8_t* const src[3], size_t pixels,
+                            uint8_t* dst, bool stream) {
+    const arrangement_program_t& program = get_program(bytes, subsampled, true);
+    stream = stream && aligned(dst);
+    size_t done = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        done = subsampled ? interleave_avx512<true>(program, src, pixels, dst, stream)
+                          : interleave_avx512<false>(program, src, pixels, dst, stream);
+    else if (level >= CPU_LEVEL_AVX2)
+        done = subsampled ? interleave_avx2<true>(program, src, pixels, dst, stream)
+                          : interleave_avx2<false>(program, src, pixels, dst, stream);
+    else if (level >= CPU_LEVEL_SSE41)
+        done = subsampled ? interleave_sse41<true>(program, src, pixels, dst, stream)
+                          : interleave_sse41<false>(program, src, pixels, dst, stream);
+    if (stream)
+        _mm_sfence();
+#else
+    (void)level;
+    (void)program;
+#endif
+    if (1 == bytes)
+        interleave_scalar<uint8_t>(subsampled, src, done, pixels, dst);
+    else {
+        const uint16_t* const src16[3] = {(const uint16_t*)src[0], (const uint16_t*)src[1], (const uint16_t*)src[2]};
+        interleave_scalar<uint16_t>(subsampled, src16, done, pixels, (uint16_t*)dst);
+    }
+}
+
+void arrangement_deinterleave(CpuLevel level, int bytes, bool subsampled, const uint8_t* src, size_t pixels,
+                              uint8_t* const dst[3], bool stream) {
+    const arrangement_program_t& program = get_program(bytes, subsampled, false);
+    stream = stream && aligned(dst[0]) && aligned(dst[1]) && aligned(dst[2]);
+    size_t done = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        done = subsampled ? deinterleave_avx512<true>(program, src, pixels, dst, stream)
+                          : deinterleave_avx512<false>(program, src, pixels, dst, stream);
+    else if (level >= CPU_LEVEL_AVX2)
+        done = subsampled ? deinterleave_avx2<true>(program, src, pixels, dst, stream)
+                          : deinterleave_avx2<false>(program, src, pixels, dst, stream);
+    else if (level >= CPU_LEVEL_SSE41)
+        done = subsampled ? deinterleave_sse41<true>(program, src, pixels, dst, stream)
+                          : deinterleave_sse41<false>(program, src, pixels, dst, stream);
+    if (stream)
+        _mm_sfence();
+#else
+    (void)level;
+    (void)program;
+#endif
+    if (1 == bytes)
+        deinterleave_scalar<uint8_t>(subsampled, src, done, pixels, dst);
+    else {
+        uint16_t* const dst16[3] = {(uint16_t*)dst[0], (uint16_t*)dst[1], (uint16_t*)dst[2]};
+        deinterleave_scalar<uint16_t>(subsampled, (const uint16_t*)src, done, pixels, dst16);
+    }
+}
@@ -0,0 +1,67 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_IMAGE_TRANSFORMER_ARRANGEMENT_KERNELS_H__
+#define __DEE_PLUGINS_IMAGE_TRANSFORMER_ARRANGEMENT_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "plugins_cpu.h"
+
+/** @brief Packs planes into interleaved samples
+ *  4:4:4 pixels are stored as three consecutive samples, 4:2:2 pixel pairs as Y Cb Y Cr.
+ *  Streaming stores bypass the cache and are used only when 'dst' is aligned to 64 bytes.
+ */
+void arrangement_interleave(CpuLevel level,
+                            int bytes,                   /**< [in] Bytes per sample: 1 or 2 */
+                            bool subsampled,             /**< [in] 4:2:2 if true, 4:4:4 otherwise */
+                            const uint8_t* const src[3], /**< [in] Planes, starting at the first pixel */
+                            size_t pixels,               /**< [in] Number of pixels, even for 4:2:2 */
+                            uint8_t* dst,                /**< [out] Interleaved samples */
+                            bool stream                  /**< [in] Use non-temporal stores */
+);
+
+/** @brief Splits interleaved samples into planes
+ *  Inverse of arrangement_interleave(). Streaming stores are used only when all planes
+ *  are aligned to 64 bytes.
+ */
+void arrangement_deinterleave(CpuLevel level,
+                              int bytes,             /**< [in] Bytes per sample: 1 or 2 */
+                              bool subsampled,       /**< [in] 4:2:2 if true, 4:4:4 otherwise */
+                              const uint8_t* src,    /**< [in] Interleaved samples, starting at the first pixel */
+                              size_t pixels,         /**< [in] Number of pixels, even for 4:2:2 */
+                              uint8_t* const dst[3], /**< [out] Planes */
+                              bool stream            /**< [in] Use non-temporal stores */
+);
+
+#endif // __DEE_PLUGINS_IMAGE_TRANSFORMER_ARRANGEMENT_KERNELS_H__
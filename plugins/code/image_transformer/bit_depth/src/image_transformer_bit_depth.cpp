@@ -0,0 +1,412 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_api.h"
+#include "image_transformer_bit_depth_kernels.h"
+#include "plugins_buffers.h"
+#include "plugins_threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const PropertyInfo img_transformer_info[] = {
+    {"bit_depth", PROPERTY_TYPE_STRING, "Bits per sample of output. 8-bit output has one byte per sample.", "10",
+     "8:10:12", 0, 1, ACCESS_TYPE_USER},
+    {"method", PROPERTY_TYPE_STRING,
+     "Reduction method. 'truncate' drops low bits, 'round' rounds to the nearest code, 'ordered' adds 8x8 Bayer "
+     "dither and 'blue_noise' adds 64x64 blue noise dither. Dither patterns do not change between frames, so they "
+     "do not add temporal noise.",
+     "blue_noise", "truncate:round:ordered:blue_noise", 0, 1, ACCESS_TYPE_USER},
+    {"simd", PROPERTY_TYPE_STRING, "Instruction set used by conversion kernels, limited to what the CPU supports.",
+     "auto", "auto:scalar:sse4.1:avx2:avx512", 0, 1, ACCESS_TYPE_USER},
+    {"thread_num", PROPERTY_TYPE_INTEGER, "Number of threads converting bands of rows (0 = number of logical CPUs).",
+     "0", "0:255", 0, 1, ACCESS_TYPE_USER},
+};
+
+static size_t img_transformer_bit_depth_get_info(const PropertyInfo** info) {
+    *info = img_transformer_info;
+    return sizeof(img_transformer_info) / sizeof(PropertyInfo);
+}
+
+/* Rows per job */
+static const size_t band_rows = 16;
+
+static const size_t tile_samples = BIT_DEPTH_TILE * BIT_DEPTH_TILE;
+
+/* Chroma planes read the threshold tile at other positions, so their dither does not line up with luma */
+static const size_t plane_offset[3][2] = {{0, 0}, {19, 41}, {37, 11}};
+
+typedef enum { METHOD_TRUNCATE = 0, METHOD_ROUND, METHOD_ORDERED, METHOD_BLUE_NOISE } bit_depth_method_t;
+
+/* Tiles are made on first use and shared by all instances */
+static const uint16_t* threshold_tile(bool blueNoise) {
+    struct tile_t {
+        explicit tile_t(bool blueNoise) : ranks(tile_samples) { bit_depth_threshold_tile(blueNoise, ranks.data()); }
+        std::vector<uint16_t> ranks;
+    };
+    if (blueNoise) {
+        static const tile_t blue(true);
+        return blue.ranks.data();
+    }
+    static const tile_t ordered(false);
+    return ordered.ranks.data();
+}
+
+struct img_transformer_bit_depth_data_t {
+    std::string msg;
+    int outputBits{10};
+    bit_depth_method_t method{METHOD_BLUE_NOISE};
+    CpuLevel cpuLevel{cpu_level()};
+    int threadNum{0};
+    plugins_worker_pool pool;
+    plugins_buffer_pool frames; /* Outputs of processTo and 8-bit output of process */
+
+    const uint16_t* ranks{NULL}; /* Threshold tile of dither methods */
+    std::vector<uint16_t> noise; /* Values added before shift, a tile for each plane */
+    int noiseShift{-1};          /* Shift 'noise' was made for */
+};
+
+/* This structure can contain only pointers and simple types */
+struct img_transformer_bit_depth_t {
+    img_transformer_bit_depth_data_t* data;
+};
+
+static size_t img_transformer_bit_depth_get_size() {
+    return sizeof(img_transformer_bit_depth_t);
+}
+
+static Status img_transformer_bit_depth_init(ImgTransformerHandle handle,
+                                             const ImgTransformerInitParams* init_params) {
+    img_transformer_bit_depth_t* state = (img_transformer_bit_depth_t*)handle;
+    state->data = new img_transformer_bit_depth_data_t;
+    auto invalidValue = [&](const std::string& option, const std::string& value, const std::string& expectedValues) {
+        return "Invalid '" + option + "' option value: '" + value + "'. Expected value: " + expectedValues + ".";
+    };
+    for (int i = 0; i < (int)init_params->count; i++) {
+        std::string name(init_params->properties[i].name);
+        std::string value(init_params->properties[i].value);
+        if (name == "bit_depth") {
+            if (value != "8" && value != "10" && value != "12") {
+                state->data->msg = invalidValue(name, value, "8:10:12");
+                return STATUS_ERROR;
+            }
+            state->data->outputBits = std::atoi(value.c_str());
+        }
+        else if (name == "method") {
+            if (value == "truncate")
+                state->data->method = METHOD_TRUNCATE;
+            else if (value == "round")
+                state->data->method = METHOD_ROUND;
+            else if (value == "ordered")
+                state->data->method = METHOD_ORDERED;
+            else if (value == "blue_noise")
+                state->data->method = METHOD_BLUE_NOISE;
+            else {
+                state->data->msg = invalidValue(name, value, "truncate:round:ordered:blue_noise");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "simd") {
+            if (!parse_cpu_level(value, state->data->cpuLevel)) {
+                state->data->msg = invalidValue(name, value, "auto:scalar:sse4.1:avx2:avx512");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "thread_num") {
+            state->data->threadNum = std::atoi(value.c_str());
+            if (state->data->threadNum < 0 || state->data->threadNum > 255) {
+                state->data->msg = invalidValue(name, value, "0:255");
+                return STATUS_ERROR;
+            }
+        }
+        else {
+            state->data->msg = "Could not recognise option '" + name + "'.";
+            return STATUS_ERROR;
+        }
+    }
+
+    if (METHOD_ORDERED == state->data->method)
+        state->data->ranks = threshold_tile(false);
+    else if (METHOD_BLUE_NOISE == state->data->method)
+        state->data->ranks = threshold_tile(true);
+
+    if (0 == state->data->threadNum)
+        state->data->threadNum = std::max(1, (int)std::thread::hardware_concurrency());
+    state->data->pool.start(state->data->threadNum);
+
+    state->data->msg = "SIMD: " + std::string(cpu_level_name(state->data->cpuLevel));
+    state->data->msg += "\nThreads: " + std::to_string(state->data->threadNum);
+    return STATUS_OK;
+}
+
+static Status img_transformer_bit_depth_close(ImgTransformerHandle handle) {
+    img_transformer_bit_depth_t* state = (img_transformer_bit_depth_t*)handle;
+    if (state && state->data) {
+        delete state->data;
+        state->data = nullptr;
+    }
+    return STATUS_OK;
+}
+
+static int input_bits(ImgTransformerBitdepth bitdepth) {
+    switch (bitdepth) {
+    case BIT_DEPTH_UINT10_LSB:
+        return 10;
+    case BIT_DEPTH_UINT12_LSB:
+        return 12;
+    case BIT_DEPTH_UINT14_LSB:
+        return 14;
+    case BIT_DEPTH_UINT16:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+static void plane_size(const ImgTransformerMetadata& metadata, int plane, size_t& width, size_t& height) {
+    const size_t hsub = (plane && SUBSAMPLING_S444 != metadata.subsampling) ? 2 : 1;
+    const size_t vsub = (plane && SUBSAMPLING_S420 == metadata.subsampling) ? 2 : 1;
+    width = ((size_t)metadata.width + hsub - 1) / hsub;
+    height = ((size_t)metadata.height + vsub - 1) / vsub;
+}
+
+/* Samples of all planes */
+static size_t frame_samples(const ImgTransformerMetadata& metadata) {
+    size_t samples = 0;
+    for (int s = 0; s < 3; s++) {
+        size_t width, height;
+        plane_size(metadata, s, width, height);
+        samples += width * height;
+    }
+    return samples;
+}
+
+static bool check_input(img_transformer_bit_depth_data_t* data, const ImgTransformerMetadata& metadata,
+                        const int64_t* size) {
+    const int bits = input_bits(metadata.bitdepth);
+    if (PLANAR != metadata.arrangement || 0 == bits) {
+        data->msg = "Input must be planar with 10 to 16 bits per sample.";
+        return false;
+    }
+    if (bits < data->outputBits) {
+        data->msg = "Input has " + std::to_string(bits) + " bits per sample, less than output bit depth.";
+        return false;
+    }
+    if (metadata.width <= 0 || metadata.height <= 0 ||
+        (size && *size < (int64_t)(frame_samples(metadata) * sizeof(uint16_t)))) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return false;
+    }
+    return true;
+}
+
+/* Returns size of output in bytes */
+static int64_t output_metadata(const img_transformer_bit_depth_data_t* data, ImgTransformerMetadata& metadata) {
+    const size_t samples = frame_samples(metadata);
+    switch (data->outputBits) {
+    case 8:
+        metadata.bitdepth = BIT_DEPTH_UINT8;
+        return (int64_t)samples;
+    case 10:
+        metadata.bitdepth = BIT_DEPTH_UINT10_LSB;
+        break;
+    default:
+        metadata.bitdepth = BIT_DEPTH_UINT12_LSB;
+        break;
+    }
+    return (int64_t)(samples * sizeof(uint16_t));
+}
+
+/* Noise tables turn every method into an addition before the shift */
+static void prepare(img_transformer_bit_depth_data_t* data, int shift) {
+    data->noise.resize(3 * tile_samples);
+    for (int s = 0; s < 3; s++) {
+        uint16_t* noise = data->noise.data() + s * tile_samples;
+        for (size_t y = 0; y < BIT_DEPTH_TILE; y++) {
+            for (size_t x = 0; x < BIT_DEPTH_TILE; x++) {
+                uint32_t value = 0;
+                if (METHOD_ROUND == data->method)
+                    value = shift ? 1u << (shift - 1) : 0;
+                else if (METHOD_TRUNCATE != data->method) {
+                    /* Rank r adds (r + 0.5) / tile_samples of the dropped range */
+                    const size_t ty = (y + plane_offset[s][1]) % BIT_DEPTH_TILE;
+                    const size_t tx = (x + plane_offset[s][0]) % BIT_DEPTH_TILE;
+                    value = ((2u * data->ranks[ty * BIT_DEPTH_TILE + tx] + 1) << shift) / (2 * tile_samples);
+                }
+                noise[y * BIT_DEPTH_TILE + x] = (uint16_t)value;
+            }
+        }
+    }
+    data->noiseShift = shift;
+}
+
+/* Converts checked frame, 'dst' may be 'src' unless output is 8-bit */
+static void convert(img_transformer_bit_depth_data_t* data, const ImgTransformerMetadata& metadata,
+                    const uint16_t* src, uint8_t* dst) {
+    const int shift = input_bits(metadata.bitdepth) - data->outputBits;
+    if (shift != data->noiseShift)
+        prepare(data, shift);
+
+    const size_t outBytes = 8 == data->outputBits ? 1 : 2;
+    const uint16_t maxCode = (uint16_t)((1u << data->outputBits) - 1);
+    size_t width[3], height[3], offset[3], bands[4] = {0};
+    for (int s = 0; s < 3; s++) {
+        plane_size(metadata, s, width[s], height[s]);
+        offset[s] = s ? offset[s - 1] + width[s - 1] * height[s - 1] : 0;
+        bands[s + 1] = bands[s] + (height[s] + band_rows - 1) / band_rows;
+    }
+
+    const CpuLevel level = data->cpuLevel;
+    std::atomic<size_t> next(0);
+    data->pool.run([&](unsigned) {
+        for (size_t band = next++; band < bands[3]; band = next++) {
+            int s = 0;
+            while (band >= bands[s + 1])
+                s++;
+            const size_t first = (band - bands[s]) * band_rows;
+            const size_t last = std::min(height[s], first + band_rows);
+            for (size_t y = first; y < last; y++) {
+                const size_t start = offset[s] + y * width[s];
+                const uint16_t* noise = data->noise.data() + s * tile_samples + (y % BIT_DEPTH_TILE) * BIT_DEPTH_TILE;
+                if (1 == outBytes)
+                    bit_depth_row_u8(level, src + start, width[s], noise, shift, dst + start);
+                else
+                    bit_depth_row(level, src + start, width[s], noise, shift, maxCode, (uint16_t*)dst + start);
+            }
+        }
+    });
+}
+
+/* Samples are reduced in place, 8-bit output is packed to the start of the buffer */
+static Status img_transformer_bit_depth_process(ImgTransformerHandle handle, ImgTransformerFrame* frame) {
+    img_transformer_bit_depth_t* state = (img_transformer_bit_depth_t*)handle;
+    img_transformer_bit_depth_data_t* data = state->data;
+    ImgTransformerMetadata& metadata = frame->metadata;
+    data->msg.clear();
+
+    if (!check_input(data, metadata, &frame->data.size))
+        return STATUS_ERROR;
+    const uint16_t* samples = (const uint16_t*)frame->data.buffer;
+    if (8 == data->outputBits) {
+        /* Parallel rows would overwrite input of other rows */
+        const size_t size = frame_samples(metadata);
+        size_t capacity = 0;
+        uint8_t* packed = data->frames.acquire(size, capacity);
+        convert(data, metadata, samples, packed);
+        memcpy(frame->data.buffer, packed, size);
+        data->frames.release(packed);
+    }
+    else if (input_bits(metadata.bitdepth) != data->outputBits)
+        convert(data, metadata, samples, frame->data.buffer);
+
+    frame->data.size = output_metadata(data, metadata);
+    return STATUS_OK;
+}
+
+static Status img_transformer_bit_depth_process_to(ImgTransformerHandle handle, const ImgTransformerFrame* inFrame,
+                                                   ImgTransformerFrame* outFrame) {
+    img_transformer_bit_depth_t* state = (img_transformer_bit_depth_t*)handle;
+    img_transformer_bit_depth_data_t* data = state->data;
+    data->msg.clear();
+
+    if (!check_input(data, inFrame->metadata, &inFrame->data.size))
+        return STATUS_ERROR;
+    ImgTransformerMetadata metadata = inFrame->metadata;
+    const int64_t size = output_metadata(data, metadata);
+    size_t capacity = 0;
+    uint8_t* buffer = data->frames.acquire((size_t)size, capacity);
+    if (input_bits(inFrame->metadata.bitdepth) == data->outputBits)
+        memcpy(buffer, inFrame->data.buffer, (size_t)size);
+    else
+        convert(data, inFrame->metadata, (const uint16_t*)inFrame->data.buffer, buffer);
+
+    outFrame->metadata = metadata;
+    outFrame->data.buffer = buffer;
+    outFrame->data.size = size;
+    outFrame->data.bufferSize = (int64_t)capacity;
+    return STATUS_OK;
+}
+
+static Status img_transformer_bit_depth_release(ImgTransformerHandle handle, ImgTransformerFrame* outFrame) {
+    img_transformer_bit_depth_t* state = (img_transformer_bit_depth_t*)handle;
+    if (!state->data->frames.release(outFrame->data.buffer)) {
+        state->data->msg = "Frame was not returned by this plugin or was already released.";
+        return STATUS_ERROR;
+    }
+    outFrame->data.buffer = NULL;
+    return STATUS_OK;
+}
+
+static Status img_transformer_bit_depth_get_output_size(ImgTransformerHandle handle,
+                                                        const ImgTransformerMetadata* inMetadata,
+                                                        ImgTransformerMetadata* outMetadata, int64_t* outSize) {
+    img_transformer_bit_depth_t* state = (img_transformer_bit_depth_t*)handle;
+    state->data->msg.clear();
+    if (!check_input(state->data, *inMetadata, NULL))
+        return STATUS_ERROR;
+    *outMetadata = *inMetadata;
+    *outSize = output_metadata(state->data, *outMetadata);
+    return STATUS_OK;
+}
+
+static const char* img_transformer_bit_depth_get_message(ImgTransformerHandle handle) {
+    img_transformer_bit_depth_t* state = (img_transformer_bit_depth_t*)handle;
+    if (state && state->data)
+        return state->data->msg.empty() ? NULL : state->data->msg.c_str();
+    else
+        return NULL;
+}
+
+static ImgTransformerApi img_transformer_bit_depth_plugin_api = {"bit_depth",
+                                                                 img_transformer_bit_depth_get_info,
+                                                                 img_transformer_bit_depth_get_size,
+                                                                 img_transformer_bit_depth_init,
+                                                                 img_transformer_bit_depth_close,
+                                                                 img_transformer_bit_depth_process,
+                                                                 img_transformer_bit_depth_get_message,
+                                                                 img_transformer_bit_depth_get_output_size,
+                                                                 img_transformer_bit_depth_process_to,
+                                                                 img_transformer_bit_depth_release};
+
+DLB_EXPORT
+ImgTransformerApi* imgTransformerGetApi() {
+    return &img_transformer_bit_depth_plugin_api;
+}
+
+DLB_EXPORT
+int imgTransformerGetApiVersion(void) {
+    return IMG_TRANSFORMER_API_VERSION;
+}
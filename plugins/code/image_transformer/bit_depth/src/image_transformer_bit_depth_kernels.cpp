@@ -0,0 +1,262 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_bit_depth_kernels.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+static const int tile_samples = BIT_DEPTH_TILE * BIT_DEPTH_TILE;
+
+/* Void-and-cluster, R. Ulichney, 1993. Energy of a sample is the sum of Gaussians
+ * centered at all set samples, with wraparound so that tiles repeat seamlessly.
+ * Gaussians are cut off at 'radius', where they are below 1e-6. */
+static void blue_noise(uint16_t* ranks) {
+    const int n = BIT_DEPTH_TILE;
+    const int radius = 8;
+    const float sigma = 1.5f;
+    float kernel[2 * radius + 1][2 * radius + 1];
+    for (int dy = -radius; dy <= radius; dy++)
+        for (int dx = -radius; dx <= radius; dx++)
+            kernel[dy + radius][dx + radius] = expf(-(float)(dx * dx + dy * dy) / (2 * sigma * sigma));
+    std::vector<float> energy(tile_samples, 0.0f);
+    std::vector<char> set(tile_samples, 0);
+    auto toggle = [&](int p) {
+        const float sign = set[p] ? -1.0f : 1.0f;
+        set[p] = !set[p];
+        for (int dy = -radius; dy <= radius; dy++) {
+            float* row = &energy[((p / n + dy) & (n - 1)) * n];
+            for (int dx = -radius; dx <= radius; dx++)
+                row[(p % n + dx) & (n - 1)] += sign * kernel[dy + radius][dx + radius];
+        }
+    };
+    /* Tightest cluster is the set sample of highest energy, largest void the free one of lowest */
+    auto tightest = [&]() {
+        int best = -1;
+        for (int p = 0; p < tile_samples; p++)
+            if (set[p] && (best < 0 || energy[p] > energy[best]))
+                best = p;
+        return best;
+    };
+    auto largest_void = [&]() {
+        int best = -1;
+        for (int p = 0; p < tile_samples; p++)
+            if (!set[p] && (best < 0 || energy[p] < energy[best]))
+                best = p;
+        return best;
+    };
+
+    /* Initial pattern: a tenth of samples, placed by fixed pseudo random sequence and
+     * then moved from clusters to voids until it is evenly spread */
+    uint32_t seed = 1;
+    int initial = 0;
+    while (initial < tile_samples / 10) {
+        seed = seed * 1664525u + 1013904223u;
+        int p = (int)((seed >> 8) % tile_samples);
+        if (!set[p]) {
+            toggle(p);
+            initial++;
+        }
+    }
+    for (;;) {
+        int cluster = tightest();
+        toggle(cluster);
+        int hole = largest_void();
+        toggle(hole);
+        if (hole == cluster)
+            break;
+    }
+    const std::vector<float> initialEnergy = energy;
+    const std::vector<char> initialSet = set;
+
+    /* Ranks below initial pattern remove tightest clusters, ranks above fill largest voids */
+    for (int rank = initial - 1; rank >= 0; rank--) {
+        int p = tightest();
+        toggle(p);
+        ranks[p] = (uint16_t)rank;
+    }
+    energy = initialEnergy;
+    set = initialSet;
+    for (int rank = initial; rank < tile_samples; rank++) {
+        int p = largest_void();
+        toggle(p);
+        ranks[p] = (uint16_t)rank;
+    }
+}
+
+void bit_depth_threshold_tile(bool blueNoise, uint16_t* ranks) {
+    if (blueNoise) {
+        blue_noise(ranks);
+        return;
+    }
+    /* Bayer matrix of size 2n is 4 * M(n) + M(2) of the position within each 2x2 block */
+    static const int bayer2[2][2] = {{0, 2}, {3, 1}};
+    const int scale = tile_samples / 64;
+    for (int y = 0; y < BIT_DEPTH_TILE; y++) {
+        for (int x = 0; x < BIT_DEPTH_TILE; x++) {
+            int rank = 0;
+            for (int bit = 0; bit < 3; bit++)
+                rank = 4 * rank + bayer2[(y >> bit) & 1][(x >> bit) & 1];
+            ranks[y * BIT_DEPTH_TILE + x] = (uint16_t)(rank * scale + scale / 2);
+        }
+    }
+}
+
+static inline uint32_t reduce(uint16_t sample, uint16_t noise, int shift, uint32_t maxCode) {
+    uint32_t sum = (uint32_t)sample + noise;
+    uint32_t code = (sum > 0xffff ? 0xffff : sum) >> shift;
+    return code < maxCode ? code : maxCode;
+}
+
+#if defined(DLB_X86)
+
+DLB_TARGET_SSE41
+static size_t row_sse41(const uint16_t* src, size_t width, const uint16_t* noise, int shift, uint16_t maxCode,
+                        uint16_t* dst) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m128i max = _mm_set1_epi16((short)maxCode);
+    size_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_adds_epu16(_mm_loadu_si128((const __m128i*)(src + x)),
+                                   _mm_loadu_si128((const __m128i*)(noise + x % BIT_DEPTH_TILE)));
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_min_epu16(_mm_srl_epi16(v, count), max));
+    }
+    return x;
+}
+
+DLB_TARGET_SSE41
+static size_t row_u8_sse41(const uint16_t* src, size_t width, const uint16_t* noise, int shift, uint8_t* dst) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    size_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const uint16_t* n = noise + x % BIT_DEPTH_TILE;
+        __m128i a = _mm_adds_epu16(_mm_loadu_si128((const __m128i*)(src + x)), _mm_loadu_si128((const __m128i*)n));
+        __m128i b = _mm_adds_epu16(_mm_loadu_si128((const __m128i*)(src + x + 8)),
+                                   _mm_loadu_si128((const __m128i*)(n + 8)));
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(_mm_srl_epi16(a, count), _mm_srl_epi16(b, count)));
+    }
+    return x;
+}
+
+DLB_TARGET_AVX2
+static size_t row_avx2(const uint16_t* src, size_t width, const uint16_t* noise, int shift, uint16_t maxCode,
+                       uint16_t* dst) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m256i max = _mm256_set1_epi16((short)maxCode);
+    size_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i v = _mm256_adds_epu16(_mm256_loadu_si256((const __m256i*)(src + x)),
+                                      _mm256_loadu_si256((const __m256i*)(noise + x % BIT_DEPTH_TILE)));
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm256_min_epu16(_mm256_srl_epi16(v, count), max));
+    }
+    return x;
+}
+
+DLB_TARGET_AVX2
+static size_t row_u8_avx2(const uint16_t* src, size_t width, const uint16_t* noise, int shift, uint8_t* dst) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    size_t x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const uint16_t* n = noise + x % BIT_DEPTH_TILE;
+        __m256i a = _mm256_adds_epu16(_mm256_loadu_si256((const __m256i*)(src + x)),
+                                      _mm256_loadu_si256((const __m256i*)n));
+        __m256i b = _mm256_adds_epu16(_mm256_loadu_si256((const __m256i*)(src + x + 16)),
+                                      _mm256_loadu_si256((const __m256i*)(n + 16)));
+        /* Packing works within 128-bit lanes */
+        __m256i v = _mm256_packus_epi16(_mm256_srl_epi16(a, count), _mm256_srl_epi16(b, count));
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm256_permute4x64_epi64(v, 0xd8));
+    }
+    return x;
+}
+
+DLB_TARGET_AVX512
+static size_t row_avx512(const uint16_t* src, size_t width, const uint16_t* noise, int shift, uint16_t maxCode,
+                         uint16_t* dst) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m512i max = _mm512_set1_epi16((short)maxCode);
+    size_t x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m512i v = _mm512_adds_epu16(_mm512_loadu_si512(src + x), _mm512_loadu_si512(noise + x % BIT_DEPTH_TILE));
+        _mm512_storeu_si512(dst + x, _mm512_min_epu16(_mm512_srl_epi16(v, count), max));
+    }
+    return x;
+}
+
+DLB_TARGET_AVX512
+static size_t row_u8_avx512(const uint16_t* src, size_t width, const uint16_t* noise, int shift, uint8_t* dst) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m512i max = _mm512_set1_epi16(255);
+    size_t x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m512i v = _mm512_adds_epu16(_mm512_loadu_si512(src + x), _mm512_loadu_si512(noise + x % BIT_DEPTH_TILE));
+        v = _mm512_min_epu16(_mm512_srl_epi16(v, count), max);
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm512_cvtepi16_epi8(v));
+    }
+    return x;
+}
+
+#endif
+
+void bit_depth_row(CpuLevel level, const uint16_t* src, size_t width, const uint16_t* noise, int shift,
+                   uint16_t maxCode, uint16_t* dst) {
+    size_t x = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        x = row_avx512(src, width, noise, shift, maxCode, dst);
+    else if (level >= CPU_LEVEL_AVX2)
+        x = row_avx2(src, width, noise, shift, maxCode, dst);
+    else if (level >= CPU_LEVEL_SSE41)
+        x = row_sse41(src, width, noise, shift, maxCode, dst);
+#else
+    (void)level;
+#endif
+    for (; x < width; x++)
+        dst[x] = (uint16_t)reduce(src[x], noise[x % BIT_DEPTH_TILE], shift, maxCode);
+}
+
+void bit_depth_row_u8(CpuLevel level, const uint16_t* src, size_t width, const uint16_t* noise, int shift,
+                      uint8_t* dst) {
+    size_t x = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        x = row_u8_avx512(src, width, noise, shift, dst);
+    else if (level >= CPU_LEVEL_AVX2)
+        x = row_u8_avx2(src, width, noise, shift, dst);
+    else if (level >= CPU_LEVEL_SSE41)
+        x = row_u8_sse41(src, width, noise, shift, dst);
+#else
+    (void)level;
+#endif
+    for (; x < width; x++)
+        dst[x] = (uint8_t)reduce(src[x], noise[x % BIT_DEPTH_TILE], shift, 255);
+}
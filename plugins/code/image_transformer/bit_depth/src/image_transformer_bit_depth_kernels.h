@@ -0,0 +1,73 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_IMAGE_TRANSFORMER_BIT_DEPTH_KERNELS_H__
+#define __DEE_PLUGINS_IMAGE_TRANSFORMER_BIT_DEPTH_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "plugins_cpu.h"
+
+/* Threshold tiles are BIT_DEPTH_TILE x BIT_DEPTH_TILE samples */
+#define BIT_DEPTH_TILE 64
+
+/** @brief Fills tile with ranks of a threshold matrix
+ *  Ranks are 0 to BIT_DEPTH_TILE^2 - 1. Blue noise is made by void-and-cluster
+ *  method, ordered dither repeats 8x8 Bayer matrix with 64 distinct ranks.
+ */
+void bit_depth_threshold_tile(bool blueNoise, uint16_t* ranks);
+
+/** @brief Reduces bit depth of a row of samples
+ *  Sample x becomes min((sample + noise[x % BIT_DEPTH_TILE]) >> shift, maxCode), with
+ *  addition saturated to 16 bits. Truncation, rounding and dithering differ only in
+ *  'noise', so all of them cost the same. 'dst' may be 'src'.
+ */
+void bit_depth_row(CpuLevel level,
+                   const uint16_t* src,   /**< [in] Input samples */
+                   size_t width,          /**< [in] Number of samples */
+                   const uint16_t* noise, /**< [in] BIT_DEPTH_TILE values added before shift */
+                   int shift,             /**< [in] Input bits minus output bits */
+                   uint16_t maxCode,      /**< [in] Largest output code */
+                   uint16_t* dst          /**< [out] Output samples */
+);
+
+/** @brief Same as bit_depth_row(), for 8-bit output */
+void bit_depth_row_u8(CpuLevel level,
+                      const uint16_t* src,   /**< [in] Input samples */
+                      size_t width,          /**< [in] Number of samples */
+                      const uint16_t* noise, /**< [in] BIT_DEPTH_TILE values added before shift */
+                      int shift,             /**< [in] Input bits minus 8 */
+                      uint8_t* dst           /**< [out] Output samples, must not overlap 'src' */
+);
+
+#endif // __DEE_PLUGINS_IMAGE_TRANSFORMER_BIT_DEPTH_KERNELS_H__
@@ -0,0 +1,568 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_api.h"
+#include "plugins_threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HMODULE library_t;
+#else
+#include <dlfcn.h>
+typedef void* library_t;
+#endif
+
+static const int max_stage_num = 16;
+
+static const PropertyInfo img_transformer_info[] = {
+    {"stage", PROPERTY_TYPE_STRING,
+     "Transformer run on bands of rows: plugin library path followed by ';name=value' options. Consecutive stages "
+     "run on a band while it is in cache, so they must keep frame layout and only use rows of the band. When the "
+     "chain runs several threads, stages which have 'thread_num' option get 'thread_num=1' unless it is given.",
+     NULL, NULL, 0, max_stage_num, ACCESS_TYPE_USER},
+    {"frame_stage", PROPERTY_TYPE_STRING,
+     "Transformer run on whole frames, same format as 'stage'. Needed for transformers which change frame layout, "
+     "filter across rows or collect frame statistics. Stages run in the order they are given.",
+     NULL, NULL, 0, max_stage_num, ACCESS_TYPE_USER},
+    {"band_rows", PROPERTY_TYPE_INTEGER,
+     "Luma rows per band (0 = as many as fit in 'band_size' kB). Bands of all planes should fit in L2 cache.", "0",
+     "0:4096", 0, 1, ACCESS_TYPE_USER},
+    {"band_size", PROPERTY_TYPE_INTEGER, "Size of band in kB when 'band_rows' is 0.", "512", "16:65536", 0, 1,
+     ACCESS_TYPE_USER},
+    {"thread_num", PROPERTY_TYPE_INTEGER,
+     "Number of threads processing bands (0 = number of logical CPUs). Every thread has its own instance of each "
+     "band stage.",
+     "0", "0:255", 0, 1, ACCESS_TYPE_USER},
+};
+
+static size_t img_transformer_chain_get_info(const PropertyInfo** info) {
+    *info = img_transformer_info;
+    return sizeof(img_transformer_info) / sizeof(PropertyInfo);
+}
+
+struct img_transformer_chain_stage_t {
+    std::string library;
+    std::vector<std::string> names;
+    std::vector<std::string> values;
+    bool banded{true};
+    library_t handle{NULL};
+    int version{0};
+    ImgTransformerApi api{}; /* Copy of plugin API, entries newer than 'version' are NULL */
+    std::vector<std::vector<char> > instances;
+    double time{0}; /* Milliseconds spent in process, summed over threads */
+};
+
+struct img_transformer_chain_worker_t {
+    std::vector<uint8_t> band;
+    std::vector<double> time; /* Per stage, last element is band copying */
+};
+
+struct img_transformer_chain_data_t {
+    std::string msg;
+    size_t bandRows{0};
+    size_t bandSize{512 * 1024};
+    int threadNum{0};
+    plugins_worker_pool pool;
+    std::vector<img_transformer_chain_stage_t> stages;
+    std::vector<img_transformer_chain_worker_t> workers;
+    double copyTime{0};
+    int64_t frames{0};
+};
+
+/* This structure can contain only pointers and simple types */
+struct img_transformer_chain_t {
+    img_transformer_chain_data_t* data;
+};
+
+static size_t img_transformer_chain_get_size() {
+    return sizeof(img_transformer_chain_t);
+}
+
+static library_t open_library(const std::string& path) {
+#ifdef _WIN32
+    return LoadLibraryA(path.c_str());
+#else
+    return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+static void* find_symbol(library_t library, const char* name) {
+#ifdef _WIN32
+    return (void*)GetProcAddress(library, name);
+#else
+    return dlsym(library, name);
+#endif
+}
+
+static void close_library(library_t library) {
+#ifdef _WIN32
+    FreeLibrary(library);
+#else
+    dlclose(library);
+#endif
+}
+
+static std::string stage_name(const img_transformer_chain_data_t* data, size_t s) {
+    const img_transformer_chain_stage_t& stage = data->stages[s];
+    const std::string name = stage.version ? stage.api.pluginName : stage.library;
+    return std::to_string(s + 1) + " (" + name + ")";
+}
+
+/* Parses 'library;name=value;...' */
+static bool parse_stage(const std::string& value, bool banded, img_transformer_chain_stage_t& stage) {
+    size_t end = value.find(';');
+    stage.library = value.substr(0, end);
+    stage.banded = banded;
+    while (std::string::npos != end) {
+        size_t start = end + 1;
+        end = value.find(';', start);
+        std::string option = value.substr(start, std::string::npos == end ? std::string::npos : end - start);
+        size_t sep = option.find('=');
+        if (std::string::npos == sep || 0 == sep)
+            return false;
+        stage.names.push_back(option.substr(0, sep));
+        stage.values.push_back(option.substr(sep + 1));
+    }
+    return !stage.library.empty();
+}
+
+static bool has_option(const ImgTransformerApi& api, const char* name) {
+    const PropertyInfo* info = NULL;
+    const size_t count = api.getInfo ? api.getInfo(&info) : 0;
+    for (size_t i = 0; i < count; i++) {
+        if (info[i].name && 0 == strcmp(info[i].name, name))
+            return true;
+    }
+    return false;
+}
+
+static bool load_stage(img_transformer_chain_data_t* data, size_t s) {
+    img_transformer_chain_stage_t& stage = data->stages[s];
+    stage.handle = open_library(stage.library);
+    if (!stage.handle) {
+        data->msg = "Could not load stage library '" + stage.library + "'.";
+        return false;
+    }
+    ImgTransformerGetApiVersion getVersion =
+        (ImgTransformerGetApiVersion)find_symbol(stage.handle, "imgTransformerGetApiVersion");
+    ImgTransformerGetApi getApi = (ImgTransformerGetApi)find_symbol(stage.handle, "imgTransformerGetApi");
+    const int version = getVersion ? getVersion() : 0;
+    const ImgTransformerApi* api = getApi ? getApi() : NULL;
+    if (!api || version < 1 || version > IMG_TRANSFORMER_API_VERSION) {
+        data->msg = "Library '" + stage.library + "' is not an image transformer plugin of API version 1 to " +
+                    std::to_string(IMG_TRANSFORMER_API_VERSION) + ".";
+        return false;
+    }
+    /* Version 1 structure ends with getMessage */
+    memcpy(&stage.api, api, 1 == version ? offsetof(ImgTransformerApi, getOutputSize) : sizeof(stage.api));
+    stage.version = version;
+
+    /* Band stages already run on every chain thread, threads of their own would multiply the thread count */
+    bool singleThreaded = false;
+    if (stage.banded && data->threadNum > 1 && has_option(stage.api, "thread_num") &&
+        stage.names.end() == std::find(stage.names.begin(), stage.names.end(), "thread_num")) {
+        stage.names.push_back("thread_num");
+        stage.values.push_back("1");
+        singleThreaded = true;
+    }
+
+    std::vector<Property> properties(stage.names.size());
+    for (size_t i = 0; i < properties.size(); i++) {
+        properties[i].name = stage.names[i].c_str();
+        properties[i].value = &stage.values[i][0];
+        properties[i].maxValueSz = stage.values[i].size() + 1;
+    }
+    ImgTransformerInitParams params = {properties.data(), properties.size()};
+    stage.instances.resize(stage.banded ? data->threadNum : 1);
+    for (size_t i = 0; i < stage.instances.size(); i++) {
+        stage.instances[i].assign(stage.api.getSize(), 0);
+        if (STATUS_ERROR == stage.api.init(stage.instances[i].data(), &params)) {
+            const char* message = stage.api.getMessage(stage.instances[i].data());
+            data->msg = "Stage " + stage_name(data, s) + ": " + (message ? message : "initialization failed.");
+            if (singleThreaded)
+                data->msg += " Band stage was given 'thread_num=1' by the chain, set 'thread_num' of the stage "
+                             "explicitly if it needs another value.";
+            stage.api.close(stage.instances[i].data());
+            stage.instances.resize(i);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void unload_stages(img_transformer_chain_data_t* data) {
+    for (size_t s = 0; s < data->stages.size(); s++) {
+        img_transformer_chain_stage_t& stage = data->stages[s];
+        for (size_t i = 0; i < stage.instances.size(); i++)
+            stage.api.close(stage.instances[i].data());
+        stage.instances.clear();
+        if (stage.handle)
+            close_library(stage.handle);
+        stage.handle = NULL;
+    }
+}
+
+static Status img_transformer_chain_init(ImgTransformerHandle handle, const ImgTransformerInitParams* init_params) {
+    img_transformer_chain_t* state = (img_transformer_chain_t*)handle;
+    state->data = new img_transformer_chain_data_t;
+    auto invalidValue = [&](const std::string& option, const std::string& value, const std::string& expectedValues) {
+        return "Invalid '" + option + "' option value: '" + value + "'. Expected value: " + expectedValues + ".";
+    };
+    for (int i = 0; i < (int)init_params->count; i++) {
+        std::string name(init_params->properties[i].name);
+        std::string value(init_params->properties[i].value);
+        if (name == "stage" || name == "frame_stage") {
+            img_transformer_chain_stage_t stage;
+            if (!parse_stage(value, name == "stage", stage)) {
+                state->data->msg = invalidValue(name, value, "library;name=value;...");
+                return STATUS_ERROR;
+            }
+            if ((int)state->data->stages.size() == max_stage_num) {
+                state->data->msg = "Too many stages, at most " + std::to_string(max_stage_num) + " are supported.";
+                return STATUS_ERROR;
+            }
+            state->data->stages.push_back(stage);
+        }
+        else if (name == "band_rows") {
+            int rows = std::atoi(value.c_str());
+            if (rows < 0 || rows > 4096) {
+                state->data->msg = invalidValue(name, value, "0:4096");
+                return STATUS_ERROR;
+            }
+            state->data->bandRows = (size_t)rows;
+        }
+        else if (name == "band_size") {
+            int size = std::atoi(value.c_str());
+            if (size < 16 || size > 65536) {
+                state->data->msg = invalidValue(name, value, "16:65536");
+                return STATUS_ERROR;
+            }
+            state->data->bandSize = (size_t)size * 1024;
+        }
+        else if (name == "thread_num") {
+            state->data->threadNum = std::atoi(value.c_str());
+            if (state->data->threadNum < 0 || state->data->threadNum > 255) {
+                state->data->msg = invalidValue(name, value, "0:255");
+                return STATUS_ERROR;
+            }
+        }
+        else {
+            state->data->msg = "Could not recognise option '" + name + "'.";
+            return STATUS_ERROR;
+        }
+    }
+    if (state->data->stages.empty()) {
+        state->data->msg = "At least one 'stage' or 'frame_stage' option is needed.";
+        return STATUS_ERROR;
+    }
+
+    if (0 == state->data->threadNum)
+        state->data->threadNum = std::max(1, (int)std::thread::hardware_concurrency());
+    for (size_t s = 0; s < state->data->stages.size(); s++) {
+        if (!load_stage(state->data, s)) {
+            unload_stages(state->data);
+            return STATUS_ERROR;
+        }
+    }
+    state->data->pool.start(state->data->threadNum);
+    state->data->workers.resize(state->data->threadNum);
+
+    state->data->msg = "Threads: " + std::to_string(state->data->threadNum);
+    for (size_t s = 0; s < state->data->stages.size(); s++)
+        state->data->msg += "\nStage " + stage_name(state->data, s) +
+                            (state->data->stages[s].banded ? ": bands" : ": frames");
+    return STATUS_OK;
+}
+
+static Status img_transformer_chain_close(ImgTransformerHandle handle) {
+    img_transformer_chain_t* state = (img_transformer_chain_t*)handle;
+    if (state && state->data) {
+        state->data->pool.stop();
+        unload_stages(state->data);
+        delete state->data;
+        state->data = nullptr;
+    }
+    return STATUS_OK;
+}
+
+static double elapsed(std::chrono::steady_clock::time_point& start) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - start).count();
+    start = now;
+    return ms;
+}
+
+static bool same_layout(const ImgTransformerFrame& a, const ImgTransformerFrame& b) {
+    return a.metadata.width == b.metadata.width && a.metadata.height == b.metadata.height &&
+           a.metadata.subsampling == b.metadata.subsampling && a.metadata.bitdepth == b.metadata.bitdepth &&
+           a.metadata.arrangement == b.metadata.arrangement && a.data.size == b.data.size;
+}
+
+/* Geometry of planar frame */
+struct img_transformer_chain_planes_t {
+    size_t bytes;          /* Per sample */
+    size_t width[3];       /* Samples per row */
+    size_t height[3];      /* Rows */
+    size_t offset[3];      /* Plane start in frame buffer, bytes */
+    int vsub;
+};
+
+static img_transformer_chain_planes_t frame_planes(const ImgTransformerMetadata& metadata) {
+    img_transformer_chain_planes_t planes;
+    const size_t hsub = SUBSAMPLING_S444 == metadata.subsampling ? 1 : 2;
+    planes.vsub = SUBSAMPLING_S420 == metadata.subsampling ? 2 : 1;
+    planes.bytes = BIT_DEPTH_UINT8 == metadata.bitdepth ? 1 : 2;
+    size_t offset = 0;
+    for (int p = 0; p < 3; p++) {
+        planes.width[p] = p ? ((size_t)metadata.width + hsub - 1) / hsub : (size_t)metadata.width;
+        planes.height[p] = p ? ((size_t)metadata.height + planes.vsub - 1) / planes.vsub : (size_t)metadata.height;
+        planes.offset[p] = offset;
+        offset += planes.width[p] * planes.height[p] * planes.bytes;
+    }
+    return planes;
+}
+
+/* Runs stages [first, last) band by band. Every thread runs its own instances. */
+static Status run_bands(img_transformer_chain_data_t* data, ImgTransformerFrame* frame, size_t first, size_t last) {
+    const ImgTransformerMetadata metadata = frame->metadata;
+    if (PLANAR != metadata.arrangement) {
+        data->msg = "Band stages need planar frames, use 'frame_stage' for stage " + stage_name(data, first) + ".";
+        return STATUS_ERROR;
+    }
+    const img_transformer_chain_planes_t planes = frame_planes(metadata);
+    const size_t frameSize = planes.offset[2] + planes.width[2] * planes.height[2] * planes.bytes;
+    if (metadata.width <= 0 || metadata.height <= 0 || frame->data.size < (int64_t)frameSize) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return STATUS_ERROR;
+    }
+    const size_t height = (size_t)metadata.height;
+    size_t rowsPerBand = data->bandRows;
+    if (0 == rowsPerBand)
+        rowsPerBand = std::max<size_t>(1, data->bandSize * height / frameSize);
+    rowsPerBand = (rowsPerBand + planes.vsub - 1) / planes.vsub * planes.vsub;
+    const size_t bands = (height + rowsPerBand - 1) / rowsPerBand;
+
+    ImgTransformerMetadata result = metadata;
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::mutex lock;
+    data->pool.run([&](unsigned w) {
+        img_transformer_chain_worker_t& worker = data->workers[w];
+        worker.time.assign(data->stages.size() + 1, 0);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t band = next++; band < bands && !failed; band = next++) {
+            const size_t y0 = band * rowsPerBand;
+            const size_t rows = std::min(rowsPerBand, height - y0);
+            size_t offset[3], bytes[3], size = 0;
+            for (int p = 0; p < 3; p++) {
+                const size_t row = planes.width[p] * planes.bytes;
+                const size_t first = p ? y0 / planes.vsub : y0;
+                const size_t count = p ? (rows + planes.vsub - 1) / planes.vsub : rows;
+                offset[p] = planes.offset[p] + first * row;
+                bytes[p] = count * row;
+                size += bytes[p];
+            }
+            if (worker.band.size() < size)
+                worker.band.resize(size);
+            uint8_t* dst = worker.band.data();
+            for (int p = 0; p < 3; p++) {
+                memcpy(dst, frame->data.buffer + offset[p], bytes[p]);
+                dst += bytes[p];
+            }
+            worker.time.back() += elapsed(start);
+
+            ImgTransformerFrame part;
+            part.metadata = metadata;
+            part.metadata.height = (int64_t)rows;
+            part.data.buffer = worker.band.data();
+            part.data.size = (int64_t)size;
+            part.data.bufferSize = (int64_t)size;
+            for (size_t s = first; s < last; s++) {
+                const img_transformer_chain_stage_t& stage = data->stages[s];
+                const ImgTransformerFrame before = part;
+                Status status = stage.api.process((ImgTransformerHandle)stage.instances[w].data(), &part);
+                worker.time[s] += elapsed(start);
+                std::string error;
+                if (STATUS_ERROR == status) {
+                    const char* message = stage.api.getMessage((ImgTransformerHandle)stage.instances[w].data());
+                    error = message ? message : "processing failed.";
+                }
+                else if (!same_layout(before, part) || part.data.buffer != before.data.buffer)
+                    error = "changed frame layout, run it as 'frame_stage'.";
+                if (!error.empty()) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (!failed)
+                        data->msg = "Stage " + stage_name(data, s) + ": " + error;
+                    failed = true;
+                    return;
+                }
+            }
+
+            const uint8_t* src = worker.band.data();
+            for (int p = 0; p < 3; p++) {
+                memcpy(frame->data.buffer + offset[p], src, bytes[p]);
+                src += bytes[p];
+            }
+            if (0 == band)
+                result = part.metadata;
+            worker.time.back() += elapsed(start);
+        }
+    });
+    if (failed)
+        return STATUS_ERROR;
+
+    for (size_t w = 0; w < data->workers.size(); w++) {
+        for (size_t s = first; s < last; s++)
+            data->stages[s].time += data->workers[w].time[s];
+        data->copyTime += data->workers[w].time.back();
+    }
+    result.height = metadata.height;
+    frame->metadata = result;
+    return STATUS_OK;
+}
+
+static Status img_transformer_chain_process(ImgTransformerHandle handle, ImgTransformerFrame* frame) {
+    img_transformer_chain_t* state = (img_transformer_chain_t*)handle;
+    img_transformer_chain_data_t* data = state->data;
+    data->msg.clear();
+
+    size_t s = 0;
+    while (s < data->stages.size()) {
+        img_transformer_chain_stage_t& stage = data->stages[s];
+        if (stage.banded) {
+            size_t last = s + 1;
+            while (last < data->stages.size() && data->stages[last].banded)
+                last++;
+            if (STATUS_OK != run_bands(data, frame, s, last))
+                return STATUS_ERROR;
+            s = last;
+            continue;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Status status = stage.api.process((ImgTransformerHandle)stage.instances[0].data(), frame);
+        stage.time += elapsed(start);
+        if (STATUS_ERROR == status) {
+            const char* message = stage.api.getMessage((ImgTransformerHandle)stage.instances[0].data());
+            data->msg = "Stage " + stage_name(data, s) + ": " + (message ? message : "processing failed.");
+            return STATUS_ERROR;
+        }
+        s++;
+    }
+    data->frames++;
+
+    /* Average time per frame, summed over threads */
+    char number[32];
+    data->msg = "Average stage time per frame:";
+    for (s = 0; s < data->stages.size(); s++) {
+        snprintf(number, sizeof(number), "%.2f", data->stages[s].time / data->frames);
+        data->msg += "\n" + stage_name(data, s) + ": " + number + " ms";
+    }
+    snprintf(number, sizeof(number), "%.2f", data->copyTime / data->frames);
+    data->msg += "\nBand copy: " + std::string(number) + " ms";
+    return STATUS_OK;
+}
+
+/* Metadata is passed through all stages. Frames are processed in place, so the reported size is the largest
+ * size of any stage output. */
+static Status img_transformer_chain_get_output_size(ImgTransformerHandle handle,
+                                                    const ImgTransformerMetadata* inMetadata,
+                                                    ImgTransformerMetadata* outMetadata, int64_t* outSize) {
+    img_transformer_chain_t* state = (img_transformer_chain_t*)handle;
+    img_transformer_chain_data_t* data = state->data;
+    data->msg.clear();
+
+    ImgTransformerMetadata metadata = *inMetadata;
+    const img_transformer_chain_planes_t planes = frame_planes(metadata);
+    int64_t size = (int64_t)(planes.offset[2] + planes.width[2] * planes.height[2] * planes.bytes);
+    int64_t largest = size;
+    for (size_t s = 0; s < data->stages.size(); s++) {
+        img_transformer_chain_stage_t& stage = data->stages[s];
+        if (1 == stage.version) {
+            data->msg = "Stage " + stage_name(data, s) + " uses API version 1, which cannot report output size.";
+            return STATUS_ERROR;
+        }
+        if (!stage.api.getOutputSize)
+            continue;
+        ImgTransformerMetadata next;
+        if (STATUS_ERROR == stage.api.getOutputSize((ImgTransformerHandle)stage.instances[0].data(), &metadata,
+                                                    &next, &size)) {
+            const char* message = stage.api.getMessage((ImgTransformerHandle)stage.instances[0].data());
+            data->msg = "Stage " + stage_name(data, s) + ": " + (message ? message : "input is not supported.");
+            return STATUS_ERROR;
+        }
+        metadata = next;
+        largest = std::max(largest, size);
+    }
+    *outMetadata = metadata;
+    *outSize = largest;
+    return STATUS_OK;
+}
+
+static const char* img_transformer_chain_get_message(ImgTransformerHandle handle) {
+    img_transformer_chain_t* state = (img_transformer_chain_t*)handle;
+    if (state && state->data)
+        return state->data->msg.empty() ? NULL : state->data->msg.c_str();
+    else
+        return NULL;
+}
+
+static ImgTransformerApi img_transformer_chain_plugin_api = {"chain",
+                                                             img_transformer_chain_get_info,
+                                                             img_transformer_chain_get_size,
+                                                             img_transformer_chain_init,
+                                                             img_transformer_chain_close,
+                                                             img_transformer_chain_process,
+                                                             img_transformer_chain_get_message,
+                                                             img_transformer_chain_get_output_size,
+                                                             NULL,
+                                                             NULL};
+
+DLB_EXPORT
+ImgTransformerApi* imgTransformerGetApi() {
+    return &img_transformer_chain_plugin_api;
+}
+
+DLB_EXPORT
+int imgTransformerGetApiVersion(void) {
+    return IMG_TRANSFORMER_API_VERSION;
+}
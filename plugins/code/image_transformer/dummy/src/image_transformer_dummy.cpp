@@ -1,11 +1,21 @@
 #include "image_transformer_api.h"
+#include "plugins_cpu.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 
 static const PropertyInfo img_transformer_info[] = {
     { "string_param", PROPERTY_TYPE_STRING, "Dummy string parameter.", NULL, NULL, 0, 1, ACCESS_TYPE_USER},
     { "int_param", PROPERTY_TYPE_INTEGER, "Dummy int parameter.", "-1", "0:10", 0, 1, ACCESS_TYPE_USER},
-    { "count_frames", PROPERTY_TYPE_BOOLEAN, "Count the number of frames processed by the plugin.", "false", "true:1:false:0", 0, 1, ACCESS_TYPE_USER}
+    { "count_frames", PROPERTY_TYPE_BOOLEAN, "Count the number of frames processed by the plugin.", "false", "true:1:false:0", 0, 1, ACCESS_TYPE_USER},
+    { "benchmark", PROPERTY_TYPE_STRING, "Passthrough benchmark. 'touch' reads one byte per cache line, 'checksum' reads the whole frame. "
+      "Process builds no messages, results are reported by getMessage after close.", "off", "off:touch:checksum", 0, 1, ACCESS_TYPE_USER},
+    { "bytes_per_cycle", PROPERTY_TYPE_DECIMAL, "Benchmark processing rate. Each call lasts at least frame size divided by this many "
+      "CPU timestamp counter cycles, to emulate transformers of known cost (0 = no limit).", "0", "0:1000000", 0, 1, ACCESS_TYPE_USER}
 };
 
 static size_t img_transformer_dummy_get_info(const PropertyInfo** info) {
@@ -13,17 +23,42 @@ static size_t img_transformer_dummy_get_info(const PropertyInfo** info) {
     return sizeof(img_transformer_info) / sizeof(PropertyInfo);
 }
 
+enum img_transformer_dummy_benchmark_t {
+    BENCHMARK_OFF,
+    BENCHMARK_TOUCH,
+    BENCHMARK_CHECKSUM
+};
+
+typedef std::chrono::steady_clock clock_type;
+
+/* Latency histogram in nanoseconds. Below 32 every value has its bucket, above that
+ * every power of two is split into 16 buckets, so values are kept within 1/16. */
+static const int latency_steps = 16;
+static const int latency_buckets = 64 * latency_steps;
+
 struct img_transformer_dummy_data_t {
     std::string stringParam;
     int intParam{-1};
     int frameCount{0};
     bool countFrames{false};
     std::string msg;
+
+    img_transformer_dummy_benchmark_t benchmark{BENCHMARK_OFF};
+    double bytesPerCycle{0};
+    uint64_t latency[latency_buckets] = {};
+    uint64_t frames{0};
+    uint64_t busy{0};       /* Nanoseconds in process */
+    uint64_t maxLatency{0}; /* Nanoseconds */
+    clock_type::time_point first;
+    clock_type::time_point last;
+    int64_t bytes{0};
+    uint64_t checksum{0};
 };
 
 /* This structure can contain only pointers and simple types */
 struct img_transformer_dummy_t{
     img_transformer_dummy_data_t* data;
+    char report[512]; /* Benchmark results, written on close and kept for getMessage */
 };
 
 static size_t img_transformer_dummy_get_size() {
@@ -33,6 +68,7 @@ static size_t img_transformer_dummy_get_size() {
 static Status img_transformer_dummy_init(ImgTransformerHandle handle, const ImgTransformerInitParams* init_params) {
     img_transformer_dummy_t* state = (img_transformer_dummy_t*)handle;
     state->data = new img_transformer_dummy_data_t;
+    state->report[0] = '\0';
     auto invalidValue = [&](const std::string& option, const std::string& value, const std::string& expectedValues) {
         return "Invalid '"+option+"' option value: '"+value+"'. Expected value: "+expectedValues+".";
     };
@@ -52,6 +88,23 @@ static Status img_transformer_dummy_init(ImgTransformerHandle handle, const ImgT
                 state->data->msg = invalidValue(name, value, "true:1:false:0");
                 return STATUS_ERROR;
             }
+        } else if (name == "benchmark") {
+            if (value == "off")
+                state->data->benchmark = BENCHMARK_OFF;
+            else if (value == "touch")
+                state->data->benchmark = BENCHMARK_TOUCH;
+            else if (value == "checksum")
+                state->data->benchmark = BENCHMARK_CHECKSUM;
+            else {
+                state->data->msg = invalidValue(name, value, "off:touch:checksum");
+                return STATUS_ERROR;
+            }
+        } else if (name == "bytes_per_cycle") {
+            state->data->bytesPerCycle = std::atof(value.c_str());
+            if (state->data->bytesPerCycle < 0 || state->data->bytesPerCycle > 1000000) {
+                state->data->msg = invalidValue(name, value, "0:1000000");
+                return STATUS_ERROR;
+            }
         } else {
             state->data->msg = "Could not recognise option '" + name +"'.";
             return STATUS_ERROR;
@@ -60,17 +113,123 @@ static Status img_transformer_dummy_init(ImgTransformerHandle handle, const ImgT
     return STATUS_OK;
 }
 
+static int latency_bucket(uint64_t ns) {
+    int shift = 0;
+    while ((ns >> shift) >= 2 * latency_steps)
+        shift++;
+    if (0 == shift)
+        return (int)ns;
+    return (shift + 1) * latency_steps + (int)(ns >> shift) - latency_steps;
+}
+
+/* Middle of the bucket */
+static double latency_value(int bucket) {
+    if (bucket < 2 * latency_steps)
+        return (double)bucket;
+    const int shift = bucket / latency_steps - 1;
+    const uint64_t low = (uint64_t)(bucket % latency_steps + latency_steps) << shift;
+    return (double)low + (double)((uint64_t)1 << shift) / 2;
+}
+
+/* Nearest rank, never above the largest latency seen */
+static double percentile(const img_transformer_dummy_data_t* data, int p) {
+    const uint64_t rank = std::max<uint64_t>(1, (data->frames * p + 99) / 100);
+    uint64_t count = 0;
+    int bucket = 0;
+    while (bucket < latency_buckets - 1 && count + data->latency[bucket] < rank)
+        count += data->latency[bucket++];
+    return std::min(latency_value(bucket), (double)data->maxLatency);
+}
+
+static void benchmark_summary(const img_transformer_dummy_data_t* data, char* text, size_t size) {
+    const char* mode = data->benchmark == BENCHMARK_TOUCH ? "touch" : "checksum";
+    if (0 == data->frames) {
+        snprintf(text, size, "Benchmark %s: no frames.", mode);
+        return;
+    }
+    const double frames = (double)data->frames;
+    const double busy = (double)data->busy;
+    const double wall = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(data->last - data->first).count();
+
+    /* Time between calls is spent outside the plugin, by the framework and other stages */
+    snprintf(text, size,
+             "Benchmark %s: %.0f frames, %lld bytes, checksum %016llx\n"
+             "Throughput: %.1f fps in process, %.1f fps between first and last call\n"
+             "Latency: p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n"
+             "Outside process: %.1f us per frame\n"
+             "Memory bandwidth: %.2f GB/s",
+             mode, frames, (long long)data->bytes, (unsigned long long)data->checksum, frames * 1e9 / busy,
+             wall > 0 ? frames * 1e9 / wall : 0.0, percentile(data, 50) / 1e3, percentile(data, 90) / 1e3,
+             percentile(data, 99) / 1e3, (double)data->maxLatency / 1e3, std::max(0.0, wall - busy) / 1e3 / frames,
+             (double)data->bytes / busy);
+}
+
 static Status img_transformer_dummy_close(ImgTransformerHandle handle) {
     img_transformer_dummy_t* state = (img_transformer_dummy_t*)handle;
     if (state && state->data) {
+        if (state->data->benchmark != BENCHMARK_OFF)
+            benchmark_summary(state->data, state->report, sizeof(state->report));
         delete state->data;
         state->data = nullptr;
     }
     return STATUS_OK;
 }
 
-static Status img_transformer_dummy_process(ImgTransformerHandle handle, ImgTransformerFrame*) {
+static uint64_t cycles() {
+#if defined(DLB_X86)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now().time_since_epoch()).count();
+#endif
+}
+
+static uint64_t benchmark_pass(img_transformer_dummy_benchmark_t benchmark, const uint8_t* buffer, size_t size) {
+    uint64_t sum = 0;
+    if (benchmark == BENCHMARK_TOUCH) {
+        for (size_t i = 0; i < size; i += 64)
+            sum += buffer[i];
+    } else {
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, buffer + i, sizeof(word));
+            sum += word;
+        }
+        for (; i < size; i++)
+            sum += buffer[i];
+    }
+    return sum;
+}
+
+/* Benchmark process does no allocation and builds no messages */
+static Status img_transformer_dummy_benchmark(img_transformer_dummy_data_t* data, const ImgTransformerFrame* frame) {
+    const clock_type::time_point start = clock_type::now();
+    const uint64_t startCycles = cycles();
+    const size_t size = frame->data.size > 0 ? (size_t)frame->data.size : 0;
+    data->checksum += benchmark_pass(data->benchmark, frame->data.buffer, size);
+    if (data->bytesPerCycle > 0) {
+        const uint64_t budget = (uint64_t)((double)size / data->bytesPerCycle);
+        while (cycles() - startCycles < budget) {
+        }
+    }
+    const clock_type::time_point end = clock_type::now();
+
+    const uint64_t latency = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    if (0 == data->frames)
+        data->first = start;
+    data->last = end;
+    data->latency[latency_bucket(latency)]++;
+    data->frames++;
+    data->busy += latency;
+    data->maxLatency = std::max(data->maxLatency, latency);
+    data->bytes += (int64_t)size;
+    return STATUS_OK;
+}
+
+static Status img_transformer_dummy_process(ImgTransformerHandle handle, ImgTransformerFrame* frame) {
     img_transformer_dummy_t* state = (img_transformer_dummy_t*)handle;
+    if (state->data->benchmark != BENCHMARK_OFF)
+        return img_transformer_dummy_benchmark(state->data, frame);
     state->data->msg = "";
     if(state->data->intParam >= 0)
         state->data->msg += "\nImage transformer dummy int param: " + std::to_string(state->data->intParam);
@@ -86,6 +245,8 @@ static const char* img_transformer_dummy_get_message(ImgTransformerHandle handle
     img_transformer_dummy_t* state = (img_transformer_dummy_t*)handle;
     if (state && state->data)
         return state->data->msg.empty() ? NULL : state->data->msg.c_str();
+    else if (state)
+        return state->report[0] ? state->report : NULL;
     else
         return NULL;
 }
@@ -96,7 +257,10 @@ static ImgTransformerApi img_transformer_dummy_plugin_api = {"dummy",
                                            img_transformer_dummy_init,
                                            img_transformer_dummy_close,
                                            img_transformer_dummy_process,
-                                           img_transformer_dummy_get_message};
+                                           img_transformer_dummy_get_message,
+                                           NULL,
+                                           NULL,
+                                           NULL};
 
 DLB_EXPORT
 ImgTransformerApi* imgTransformerGetApi() {
@@ -0,0 +1,413 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_api.h"
+#include "image_transformer_fingerprint_kernels.h"
+#include "plugins_threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static const PropertyInfo img_transformer_info[] = {
+    {"output_file", PROPERTY_TYPE_STRING,
+     "File written with one line per frame: frame number, frame it duplicates and frame of index with the same "
+     "fingerprint (-1 if none), width, height and XXH3 128-bit hashes of the three planes.",
+     NULL, NULL, 0, 1, ACCESS_TYPE_USER},
+    {"index_file", PROPERTY_TYPE_STRING,
+     "Fingerprint index. Read on init if it exists, so frames unchanged since previous run can be reported, and "
+     "rewritten with fingerprints of this run on close.",
+     NULL, NULL, 0, 1, ACCESS_TYPE_USER},
+    {"simd", PROPERTY_TYPE_STRING, "Instruction set used by hash kernels, limited to what the CPU supports.", "auto",
+     "auto:scalar:sse4.1:avx2:avx512", 0, 1, ACCESS_TYPE_USER},
+    {"thread_num", PROPERTY_TYPE_INTEGER,
+     "Number of threads hashing planes (0 = number of logical CPUs, up to one per plane).", "0", "0:3", 0, 1,
+     ACCESS_TYPE_USER},
+};
+
+static size_t img_transformer_fingerprint_get_info(const PropertyInfo** info) {
+    *info = img_transformer_info;
+    return sizeof(img_transformer_info) / sizeof(PropertyInfo);
+}
+
+/* Frame size and hashes of three planes. Interleaved frames are split into ranges of plane sizes. */
+struct img_transformer_fingerprint_digest_t {
+    int64_t width;
+    int64_t height;
+    fingerprint_hash_t plane[3];
+
+    bool operator==(const img_transformer_fingerprint_digest_t& other) const {
+        if (width != other.width || height != other.height)
+            return false;
+        for (int s = 0; s < 3; s++) {
+            if (plane[s].low != other.plane[s].low || plane[s].high != other.plane[s].high)
+                return false;
+        }
+        return true;
+    }
+};
+
+struct img_transformer_fingerprint_digest_hash_t {
+    size_t operator()(const img_transformer_fingerprint_digest_t& digest) const {
+        return (size_t)(digest.plane[0].low ^ digest.plane[1].low ^ digest.plane[2].low);
+    }
+};
+
+/* Fingerprints of previous run. Frame of the same number is looked up first, so that
+ * frames repeated within the title are reported at their own position. Frames are kept
+ * in a map, so memory depends on lines of the index and not on frame numbers in it. */
+struct img_transformer_fingerprint_index_t {
+    typedef std::unordered_map<img_transformer_fingerprint_digest_t, int64_t, img_transformer_fingerprint_digest_hash_t>
+        map_t;
+    typedef std::unordered_map<int64_t, img_transformer_fingerprint_digest_t> frame_map_t;
+
+    frame_map_t frames;
+    map_t first;
+
+    size_t size() const { return frames.size(); }
+
+    void insert(int64_t frame, const img_transformer_fingerprint_digest_t& digest) {
+        frames[frame] = digest;
+        map_t::iterator found = first.find(digest);
+        if (found == first.end())
+            first.insert(std::make_pair(digest, frame));
+        else
+            found->second = std::min(found->second, frame);
+    }
+
+    /* Returns -1 if the fingerprint is not in the index */
+    int64_t find(int64_t frame, const img_transformer_fingerprint_digest_t& digest) const {
+        frame_map_t::const_iterator same = frames.find(frame);
+        if (same != frames.end() && same->second == digest)
+            return frame;
+        map_t::const_iterator found = first.find(digest);
+        return found == first.end() ? -1 : found->second;
+    }
+};
+
+struct img_transformer_fingerprint_data_t {
+    std::string msg;
+    std::string outputFile;
+    std::ofstream output;
+    std::string indexFile;
+    CpuLevel cpuLevel{cpu_level()};
+    int threadNum{0};
+    plugins_worker_pool pool;
+
+    img_transformer_fingerprint_index_t index;
+    /* Fingerprints of this run, in frame order */
+    std::vector<img_transformer_fingerprint_digest_t> digests;
+
+    ImgTransformerMetadata previous{};
+    int64_t duplicateOf{-1}; /* First frame of the run of identical frames */
+
+    int64_t frames{0};
+    int64_t duplicates{0};
+    int64_t indexed{0};
+};
+
+/* This structure can contain only pointers and simple types */
+struct img_transformer_fingerprint_t {
+    img_transformer_fingerprint_data_t* data;
+};
+
+static size_t img_transformer_fingerprint_get_size() {
+    return sizeof(img_transformer_fingerprint_t);
+}
+
+static std::string hex(const fingerprint_hash_t& hash) {
+    char text[33];
+    snprintf(text, sizeof(text), "%016llx%016llx", (unsigned long long)hash.high, (unsigned long long)hash.low);
+    return text;
+}
+
+static bool parse_hex(const std::string& text, fingerprint_hash_t& hash) {
+    if (32 != text.size() || std::string::npos != text.find_first_not_of("0123456789abcdefABCDEF"))
+        return false;
+    hash.high = std::strtoull(text.substr(0, 16).c_str(), NULL, 16);
+    hash.low = std::strtoull(text.substr(16).c_str(), NULL, 16);
+    return true;
+}
+
+/* Lines of 'frame width height y cb cr', lines starting with '#' are comments. Missing file is an
+ * empty index, as on the first run. */
+static bool read_index(const std::string& path, img_transformer_fingerprint_index_t& index) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open())
+        return true;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || '#' == line[0])
+            continue;
+        std::istringstream fields(line);
+        long long frame;
+        std::string planes[3];
+        img_transformer_fingerprint_digest_t digest;
+        if (!(fields >> frame >> digest.width >> digest.height >> planes[0] >> planes[1] >> planes[2]) ||
+            frame < 0 || frame > INT32_MAX)
+            return false;
+        for (int s = 0; s < 3; s++) {
+            if (!parse_hex(planes[s], digest.plane[s]))
+                return false;
+        }
+        index.insert(frame, digest);
+    }
+    return !file.bad();
+}
+
+/* Index is written to a temporary file which then replaces the old one, so a failed
+ * write leaves the index of the previous run intact. */
+static bool write_index(const std::string& path, const std::vector<img_transformer_fingerprint_digest_t>& digests) {
+    const std::string temporary = path + ".tmp";
+    std::ofstream file(temporary.c_str());
+    file << "# frame width height y cb cr\n";
+    for (size_t n = 0; n < digests.size(); n++) {
+        file << n << " " << digests[n].width << " " << digests[n].height;
+        for (int s = 0; s < 3; s++)
+            file << " " << hex(digests[n].plane[s]);
+        file << "\n";
+    }
+    file.close();
+    if (file.fail()) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    /* Windows does not rename over an existing file */
+    if (0 != std::rename(temporary.c_str(), path.c_str()) &&
+        (0 != std::remove(path.c_str()) || 0 != std::rename(temporary.c_str(), path.c_str()))) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+static Status img_transformer_fingerprint_init(ImgTransformerHandle handle,
+                                               const ImgTransformerInitParams* init_params) {
+    img_transformer_fingerprint_t* state = (img_transformer_fingerprint_t*)handle;
+    state->data = new img_transformer_fingerprint_data_t;
+    auto invalidValue = [&](const std::string& option, const std::string& value, const std::string& expectedValues) {
+        return "Invalid '" + option + "' option value: '" + value + "'. Expected value: " + expectedValues + ".";
+    };
+    for (int i = 0; i < (int)init_params->count; i++) {
+        std::string name(init_params->properties[i].name);
+        std::string value(init_params->properties[i].value);
+        if (name == "output_file") {
+            state->data->outputFile = value;
+        }
+        else if (name == "index_file") {
+            state->data->indexFile = value;
+        }
+        else if (name == "simd") {
+            if (!parse_cpu_level(value, state->data->cpuLevel)) {
+                state->data->msg = invalidValue(name, value, "auto:scalar:sse4.1:avx2:avx512");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "thread_num") {
+            state->data->threadNum = std::atoi(value.c_str());
+            if (state->data->threadNum < 0 || state->data->threadNum > 3) {
+                state->data->msg = invalidValue(name, value, "0:3");
+                return STATUS_ERROR;
+            }
+        }
+        else {
+            state->data->msg = "Could not recognise option '" + name + "'.";
+            return STATUS_ERROR;
+        }
+    }
+
+    if (!state->data->indexFile.empty() && !read_index(state->data->indexFile, state->data->index)) {
+        state->data->msg = "Could not read index file '" + state->data->indexFile + "'.";
+        return STATUS_ERROR;
+    }
+
+    if (!state->data->outputFile.empty()) {
+        state->data->output.open(state->data->outputFile.c_str());
+        if (!state->data->output.good()) {
+            state->data->msg = "Could not open output file '" + state->data->outputFile + "'.";
+            return STATUS_ERROR;
+        }
+        state->data->output << "# frame duplicate_of index_frame width height y cb cr\n";
+    }
+
+    if (0 == state->data->threadNum)
+        state->data->threadNum = std::min(3, std::max(1, (int)std::thread::hardware_concurrency()));
+    state->data->pool.start(state->data->threadNum);
+
+    state->data->msg = "SIMD: " + std::string(cpu_level_name(state->data->cpuLevel));
+    state->data->msg += "\nThreads: " + std::to_string(state->data->threadNum);
+    if (!state->data->indexFile.empty())
+        state->data->msg += "\nIndexed frames: " + std::to_string(state->data->index.size());
+    return STATUS_OK;
+}
+
+static std::string summary(const img_transformer_fingerprint_data_t* data) {
+    std::string text = "Duplicates: " + std::to_string(data->duplicates);
+    if (!data->indexFile.empty())
+        text += ", matching index: " + std::to_string(data->indexed);
+    return text + ".";
+}
+
+static Status img_transformer_fingerprint_close(ImgTransformerHandle handle) {
+    img_transformer_fingerprint_t* state = (img_transformer_fingerprint_t*)handle;
+    Status status = STATUS_OK;
+    if (state && state->data) {
+        if (state->data->output.is_open()) {
+            state->data->output << "# Frames: " << state->data->frames << ". " << summary(state->data) << "\n";
+            state->data->output.close();
+            if (state->data->output.fail())
+                status = STATUS_ERROR;
+        }
+        if (!state->data->indexFile.empty() && !write_index(state->data->indexFile, state->data->digests))
+            status = STATUS_ERROR;
+        delete state->data;
+        state->data = nullptr;
+    }
+    return status;
+}
+
+static void plane_size(const ImgTransformerMetadata& metadata, int plane, size_t& width, size_t& height) {
+    const size_t hsub = (plane && SUBSAMPLING_S444 != metadata.subsampling) ? 2 : 1;
+    const size_t vsub = (plane && SUBSAMPLING_S420 == metadata.subsampling) ? 2 : 1;
+    width = ((size_t)metadata.width + hsub - 1) / hsub;
+    height = ((size_t)metadata.height + vsub - 1) / vsub;
+}
+
+/* Frames compare equal only if their layout is the same, not just their bytes */
+static bool same_format(const ImgTransformerMetadata& a, const ImgTransformerMetadata& b) {
+    return a.width == b.width && a.height == b.height && a.subsampling == b.subsampling &&
+           a.bitdepth == b.bitdepth && a.arrangement == b.arrangement;
+}
+
+static Status img_transformer_fingerprint_process(ImgTransformerHandle handle, ImgTransformerFrame* frame) {
+    img_transformer_fingerprint_t* state = (img_transformer_fingerprint_t*)handle;
+    img_transformer_fingerprint_data_t* data = state->data;
+    const ImgTransformerMetadata& metadata = frame->metadata;
+    data->msg.clear();
+
+    const size_t sampleBytes = BIT_DEPTH_UINT8 == metadata.bitdepth ? 1 : 2;
+    size_t offset[4] = {0};
+    for (int s = 0; s < 3; s++) {
+        size_t width, height;
+        plane_size(metadata, s, width, height);
+        offset[s + 1] = offset[s] + width * height * sampleBytes;
+    }
+    if (metadata.width <= 0 || metadata.height <= 0 || frame->data.size < (int64_t)offset[3]) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return STATUS_ERROR;
+    }
+
+    /* Planes are hashed whole, so that digests match other XXH3 tools */
+    img_transformer_fingerprint_digest_t digest;
+    digest.width = metadata.width;
+    digest.height = metadata.height;
+    const uint8_t* buffer = (const uint8_t*)frame->data.buffer;
+    const CpuLevel level = data->cpuLevel;
+    std::atomic<int> next(0);
+    data->pool.run([&](unsigned) {
+        for (int s = next++; s < 3; s = next++)
+            digest.plane[s] = fingerprint_xxh3_128(level, buffer + offset[s], offset[s + 1] - offset[s]);
+    });
+
+    if (data->frames > 0 && same_format(metadata, data->previous) && digest == data->digests.back()) {
+        if (data->duplicateOf < 0)
+            data->duplicateOf = data->frames - 1;
+        data->duplicates++;
+    }
+    else
+        data->duplicateOf = -1;
+
+    const int64_t indexFrame = data->index.find(data->frames, digest);
+    if (indexFrame >= 0)
+        data->indexed++;
+
+    if (data->output.is_open()) {
+        data->output << data->frames << " " << data->duplicateOf << " " << indexFrame << " " << digest.width << " "
+                     << digest.height;
+        for (int s = 0; s < 3; s++)
+            data->output << " " << hex(digest.plane[s]);
+        data->output << "\n";
+        if (!data->output.good()) {
+            data->msg = "Could not write output file '" + data->outputFile + "'.";
+            return STATUS_ERROR;
+        }
+    }
+
+    data->msg = "Frame " + std::to_string(data->frames);
+    if (data->duplicateOf >= 0)
+        data->msg += " duplicates frame " + std::to_string(data->duplicateOf);
+    else
+        data->msg += " differs from previous frame";
+    if (indexFrame >= 0)
+        data->msg += " and is unchanged since frame " + std::to_string(indexFrame) + " of index";
+    data->msg += ". " + summary(data);
+
+    data->digests.push_back(digest);
+    data->previous = metadata;
+    data->frames++;
+    return STATUS_OK;
+}
+
+static const char* img_transformer_fingerprint_get_message(ImgTransformerHandle handle) {
+    img_transformer_fingerprint_t* state = (img_transformer_fingerprint_t*)handle;
+    if (state && state->data)
+        return state->data->msg.empty() ? NULL : state->data->msg.c_str();
+    else
+        return NULL;
+}
+
+static ImgTransformerApi img_transformer_fingerprint_plugin_api = {"fingerprint",
+                                                                   img_transformer_fingerprint_get_info,
+                                                                   img_transformer_fingerprint_get_size,
+                                                                   img_transformer_fingerprint_init,
+                                                                   img_transformer_fingerprint_close,
+                                                                   img_transformer_fingerprint_process,
+                                                                   img_transformer_fingerprint_get_message,
+                                                                   NULL,
+                                                                   NULL,
+                                                                   NULL};
+
+DLB_EXPORT
+ImgTransformerApi* imgTransformerGetApi() {
+    return &img_transformer_fingerprint_plugin_api;
+}
+
+DLB_EXPORT
+int imgTransformerGetApiVersion(void) {
+    return IMG_TRANSFORMER_API_VERSION;
+}
@@ -0,0 +1,398 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_fingerprint_kernels.h"
+
+#include <string.h>
+
+/* XXH3 of xxHash 0.8, Y. Collet. Only the parts needed for 128-bit hash with default
+ * secret and seed 0 are here, seeded variants of the formulas are reduced accordingly. */
+
+static const uint64_t prime32_1 = 0x9E3779B1U;
+static const uint64_t prime32_2 = 0x85EBCA77U;
+static const uint64_t prime32_3 = 0xC2B2AE3DU;
+static const uint64_t prime64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t prime64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t prime64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t prime64_5 = 0x27D4EB2F165667C5ULL;
+static const uint64_t prime_mx1 = 0x165667919E3779F9ULL;
+static const uint64_t prime_mx2 = 0x9FB21C651E98DF25ULL;
+
+static const size_t secret_size = 192;
+static const size_t stripe_len = 64;
+static const size_t secret_consume_rate = 8;
+static const size_t stripes_per_block = (secret_size - stripe_len) / secret_consume_rate;
+static const size_t block_len = stripe_len * stripes_per_block;
+
+static const uint8_t secret[secret_size] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+/* Little-endian loads, as everywhere else in plugins */
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t read64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t swap32(uint32_t x) {
+    return ((x << 24) & 0xff000000U) | ((x << 8) & 0x00ff0000U) | ((x >> 8) & 0x0000ff00U) |
+           ((x >> 24) & 0x000000ffU);
+}
+
+static inline uint64_t swap64(uint64_t x) {
+    return ((uint64_t)swap32((uint32_t)x) << 32) | swap32((uint32_t)(x >> 32));
+}
+
+static inline uint32_t rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline fingerprint_hash_t mult64to128(uint64_t a, uint64_t b) {
+    fingerprint_hash_t r;
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 product = (unsigned __int128)a * b;
+    r.low = (uint64_t)product;
+    r.high = (uint64_t)(product >> 64);
+#else
+    const uint64_t lo_lo = (a & 0xffffffffU) * (b & 0xffffffffU);
+    const uint64_t hi_lo = (a >> 32) * (b & 0xffffffffU);
+    const uint64_t lo_hi = (a & 0xffffffffU) * (b >> 32);
+    const uint64_t hi_hi = (a >> 32) * (b >> 32);
+    const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffffU) + lo_hi;
+    r.low = (cross << 32) | (lo_lo & 0xffffffffU);
+    r.high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+#endif
+    return r;
+}
+
+static inline uint64_t mul128_fold64(uint64_t a, uint64_t b) {
+    const fingerprint_hash_t product = mult64to128(a, b);
+    return product.low ^ product.high;
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= prime64_2;
+    h ^= h >> 29;
+    h *= prime64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= prime_mx1;
+    h ^= h >> 32;
+    return h;
+}
+
+static fingerprint_hash_t len_0to16(const uint8_t* input, size_t len) {
+    fingerprint_hash_t h;
+    if (len > 8) {
+        const uint64_t bitflipl = read64(secret + 32) ^ read64(secret + 40);
+        const uint64_t bitfliph = read64(secret + 48) ^ read64(secret + 56);
+        uint64_t inputHi = read64(input + len - 8);
+        fingerprint_hash_t m = mult64to128(read64(input) ^ inputHi ^ bitflipl, prime64_1);
+        m.low += (uint64_t)(len - 1) << 54;
+        inputHi ^= bitfliph;
+        m.high += inputHi + (uint64_t)(uint32_t)inputHi * (prime32_2 - 1);
+        m.low ^= swap64(m.high);
+        h = mult64to128(m.low, prime64_2);
+        h.high += m.high * prime64_2;
+        h.low = xxh3_avalanche(h.low);
+        h.high = xxh3_avalanche(h.high);
+    }
+    else if (len >= 4) {
+        const uint64_t bitflip = read64(secret + 16) ^ read64(secret + 24);
+        const uint64_t input64 = read32(input) + ((uint64_t)read32(input + len - 4) << 32);
+        h = mult64to128(input64 ^ bitflip, prime64_1 + (len << 2));
+        h.high += h.low << 1;
+        h.low ^= h.high >> 3;
+        h.low ^= h.low >> 35;
+        h.low *= prime_mx2;
+        h.low ^= h.low >> 28;
+        h.high = xxh3_avalanche(h.high);
+    }
+    else if (len > 0) {
+        const uint32_t combinedl = ((uint32_t)input[0] << 16) | ((uint32_t)input[len >> 1] << 24) |
+                                   (uint32_t)input[len - 1] | ((uint32_t)len << 8);
+        const uint32_t combinedh = rotl32(swap32(combinedl), 13);
+        h.low = xxh64_avalanche(combinedl ^ (uint64_t)(read32(secret) ^ read32(secret + 4)));
+        h.high = xxh64_avalanche(combinedh ^ (uint64_t)(read32(secret + 8) ^ read32(secret + 12)));
+    }
+    else {
+        h.low = xxh64_avalanche(read64(secret + 64) ^ read64(secret + 72));
+        h.high = xxh64_avalanche(read64(secret + 80) ^ read64(secret + 88));
+    }
+    return h;
+}
+
+static inline uint64_t mix16(const uint8_t* input, const uint8_t* key) {
+    return mul128_fold64(read64(input) ^ read64(key), read64(input + 8) ^ read64(key + 8));
+}
+
+static inline void mix32(fingerprint_hash_t& acc, const uint8_t* input1, const uint8_t* input2, const uint8_t* key) {
+    acc.low += mix16(input1, key);
+    acc.low ^= read64(input2) + read64(input2 + 8);
+    acc.high += mix16(input2, key + 16);
+    acc.high ^= read64(input1) + read64(input1 + 8);
+}
+
+static fingerprint_hash_t finish_mid(const fingerprint_hash_t& acc, size_t len) {
+    fingerprint_hash_t h;
+    h.low = xxh3_avalanche(acc.low + acc.high);
+    h.high = 0 - xxh3_avalanche(acc.low * prime64_1 + acc.high * prime64_4 + len * prime64_2);
+    return h;
+}
+
+static fingerprint_hash_t len_17to128(const uint8_t* input, size_t len) {
+    fingerprint_hash_t acc = {len * prime64_1, 0};
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96)
+                mix32(acc, input + 48, input + len - 64, secret + 96);
+            mix32(acc, input + 32, input + len - 48, secret + 64);
+        }
+        mix32(acc, input + 16, input + len - 32, secret + 32);
+    }
+    mix32(acc, input, input + len - 16, secret);
+    return finish_mid(acc, len);
+}
+
+static fingerprint_hash_t len_129to240(const uint8_t* input, size_t len) {
+    fingerprint_hash_t acc = {len * prime64_1, 0};
+    size_t i = 32;
+    for (; i < 160; i += 32)
+        mix32(acc, input + i - 32, input + i - 16, secret + i - 32);
+    acc.low = xxh3_avalanche(acc.low);
+    acc.high = xxh3_avalanche(acc.high);
+    for (; i <= len; i += 32)
+        mix32(acc, input + i - 32, input + i - 16, secret + 3 + i - 160);
+    mix32(acc, input + len - 16, input + len - 32, secret + 136 - 17 - 16);
+    return finish_mid(acc, len);
+}
+
+/* Long input: eight 64-bit lanes accumulate 64-byte stripes, and are scrambled after
+ * every block of 16 stripes. Kernels process 'stripes' stripes with key advancing by
+ * 8 bytes per stripe. */
+typedef void (*accumulate_fn)(uint64_t* acc, const uint8_t* input, const uint8_t* key, size_t stripes);
+typedef void (*scramble_fn)(uint64_t* acc, const uint8_t* key);
+
+static void accumulate_scalar(uint64_t* acc, const uint8_t* input, const uint8_t* key, size_t stripes) {
+    for (size_t s = 0; s < stripes; s++) {
+        for (int i = 0; i < 8; i++) {
+            const uint64_t value = read64(input + 8 * i);
+            const uint64_t keyed = value ^ read64(key + 8 * i);
+            acc[i ^ 1] += value;
+            acc[i] += (keyed & 0xffffffffU) * (keyed >> 32);
+        }
+        input += stripe_len;
+        key += secret_consume_rate;
+    }
+}
+
+static void scramble_scalar(uint64_t* acc, const uint8_t* key) {
+    for (int i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= read64(key + 8 * i);
+        acc[i] = a * prime32_1;
+    }
+}
+
+#if defined(DLB_X86)
+
+/* Lanes of a vector take 'value' of their 64-bit neighbour and add product of low and
+ * high halves of 'keyed', which _mm_mul_epu32 gives after moving high half down. */
+DLB_TARGET_SSE41
+static void accumulate_sse41(uint64_t* acc, const uint8_t* input, const uint8_t* key, size_t stripes) {
+    __m128i a[4];
+    for (int i = 0; i < 4; i++)
+        a[i] = _mm_loadu_si128((const __m128i*)acc + i);
+    for (size_t s = 0; s < stripes; s++) {
+        for (int i = 0; i < 4; i++) {
+            const __m128i value = _mm_loadu_si128((const __m128i*)input + i);
+            const __m128i keyed = _mm_xor_si128(value, _mm_loadu_si128((const __m128i*)key + i));
+            const __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+            a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+        input += stripe_len;
+        key += secret_consume_rate;
+    }
+    for (int i = 0; i < 4; i++)
+        _mm_storeu_si128((__m128i*)acc + i, a[i]);
+}
+
+DLB_TARGET_SSE41
+static void scramble_sse41(uint64_t* acc, const uint8_t* key) {
+    const __m128i prime = _mm_set1_epi32((int)prime32_1);
+    for (int i = 0; i < 4; i++) {
+        __m128i a = _mm_loadu_si128((const __m128i*)acc + i);
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i*)key + i));
+        const __m128i high = _mm_mul_epu32(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        a = _mm_add_epi64(_mm_mul_epu32(a, prime), _mm_slli_epi64(high, 32));
+        _mm_storeu_si128((__m128i*)acc + i, a);
+    }
+}
+
+DLB_TARGET_AVX2
+static void accumulate_avx2(uint64_t* acc, const uint8_t* input, const uint8_t* key, size_t stripes) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)acc);
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)acc + 1);
+    for (size_t s = 0; s < stripes; s++) {
+        const __m256i value0 = _mm256_loadu_si256((const __m256i*)input);
+        const __m256i value1 = _mm256_loadu_si256((const __m256i*)input + 1);
+        const __m256i keyed0 = _mm256_xor_si256(value0, _mm256_loadu_si256((const __m256i*)key));
+        const __m256i keyed1 = _mm256_xor_si256(value1, _mm256_loadu_si256((const __m256i*)key + 1));
+        const __m256i product0 = _mm256_mul_epu32(keyed0, _mm256_shuffle_epi32(keyed0, _MM_SHUFFLE(0, 3, 0, 1)));
+        const __m256i product1 = _mm256_mul_epu32(keyed1, _mm256_shuffle_epi32(keyed1, _MM_SHUFFLE(0, 3, 0, 1)));
+        a0 = _mm256_add_epi64(a0, _mm256_add_epi64(product0, _mm256_shuffle_epi32(value0, _MM_SHUFFLE(1, 0, 3, 2))));
+        a1 = _mm256_add_epi64(a1, _mm256_add_epi64(product1, _mm256_shuffle_epi32(value1, _MM_SHUFFLE(1, 0, 3, 2))));
+        input += stripe_len;
+        key += secret_consume_rate;
+    }
+    _mm256_storeu_si256((__m256i*)acc, a0);
+    _mm256_storeu_si256((__m256i*)acc + 1, a1);
+}
+
+DLB_TARGET_AVX2
+static void scramble_avx2(uint64_t* acc, const uint8_t* key) {
+    const __m256i prime = _mm256_set1_epi32((int)prime32_1);
+    for (int i = 0; i < 2; i++) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)acc + i);
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a, _mm256_loadu_si256((const __m256i*)key + i));
+        const __m256i high = _mm256_mul_epu32(_mm256_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        a = _mm256_add_epi64(_mm256_mul_epu32(a, prime), _mm256_slli_epi64(high, 32));
+        _mm256_storeu_si256((__m256i*)acc + i, a);
+    }
+}
+
+DLB_TARGET_AVX512
+static void accumulate_avx512(uint64_t* acc, const uint8_t* input, const uint8_t* key, size_t stripes) {
+    __m512i a = _mm512_loadu_si512(acc);
+    for (size_t s = 0; s < stripes; s++) {
+        const __m512i value = _mm512_loadu_si512(input);
+        const __m512i keyed = _mm512_xor_si512(value, _mm512_loadu_si512(key));
+        const __m512i high = _mm512_shuffle_epi32(keyed, (_MM_PERM_ENUM)_MM_SHUFFLE(0, 3, 0, 1));
+        const __m512i swapped = _mm512_shuffle_epi32(value, (_MM_PERM_ENUM)_MM_SHUFFLE(1, 0, 3, 2));
+        a = _mm512_add_epi64(a, _mm512_add_epi64(_mm512_mul_epu32(keyed, high), swapped));
+        input += stripe_len;
+        key += secret_consume_rate;
+    }
+    _mm512_storeu_si512(acc, a);
+}
+
+DLB_TARGET_AVX512
+static void scramble_avx512(uint64_t* acc, const uint8_t* key) {
+    const __m512i prime = _mm512_set1_epi32((int)prime32_1);
+    __m512i a = _mm512_loadu_si512(acc);
+    a = _mm512_xor_si512(a, _mm512_srli_epi64(a, 47));
+    a = _mm512_xor_si512(a, _mm512_loadu_si512(key));
+    const __m512i high = _mm512_mul_epu32(_mm512_shuffle_epi32(a, (_MM_PERM_ENUM)_MM_SHUFFLE(0, 3, 0, 1)), prime);
+    a = _mm512_add_epi64(_mm512_mul_epu32(a, prime), _mm512_slli_epi64(high, 32));
+    _mm512_storeu_si512(acc, a);
+}
+
+#endif
+
+static uint64_t merge_accs(const uint64_t* acc, const uint8_t* key, uint64_t start) {
+    uint64_t result = start;
+    for (int i = 0; i < 4; i++)
+        result += mul128_fold64(acc[2 * i] ^ read64(key + 16 * i), acc[2 * i + 1] ^ read64(key + 16 * i + 8));
+    return xxh3_avalanche(result);
+}
+
+static fingerprint_hash_t hash_long(CpuLevel level, const uint8_t* input, size_t len) {
+    accumulate_fn accumulate = accumulate_scalar;
+    scramble_fn scramble = scramble_scalar;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512) {
+        accumulate = accumulate_avx512;
+        scramble = scramble_avx512;
+    }
+    else if (level >= CPU_LEVEL_AVX2) {
+        accumulate = accumulate_avx2;
+        scramble = scramble_avx2;
+    }
+    else if (level >= CPU_LEVEL_SSE41) {
+        accumulate = accumulate_sse41;
+        scramble = scramble_sse41;
+    }
+#else
+    (void)level;
+#endif
+    uint64_t acc[8] = {prime32_3, prime64_1, prime64_2, prime64_3, prime64_4, prime32_2, prime64_5, prime32_1};
+    const size_t blocks = (len - 1) / block_len;
+    for (size_t n = 0; n < blocks; n++) {
+        accumulate(acc, input + n * block_len, secret, stripes_per_block);
+        scramble(acc, secret + secret_size - stripe_len);
+    }
+    /* Partial block, then last stripe which may overlap it */
+    accumulate(acc, input + blocks * block_len, secret, ((len - 1) - blocks * block_len) / stripe_len);
+    accumulate(acc, input + len - stripe_len, secret + secret_size - stripe_len - 7, 1);
+
+    fingerprint_hash_t h;
+    h.low = merge_accs(acc, secret + 11, len * prime64_1);
+    h.high = merge_accs(acc, secret + secret_size - stripe_len - 11, ~(len * prime64_2));
+    return h;
+}
+
+fingerprint_hash_t fingerprint_xxh3_128(CpuLevel level, const uint8_t* data, size_t size) {
+    if (size <= 16)
+        return len_0to16(data, size);
+    if (size <= 128)
+        return len_17to128(data, size);
+    if (size <= 240)
+        return len_129to240(data, size);
+    return hash_long(level, data, size);
+}
@@ -0,0 +1,56 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_IMAGE_TRANSFORMER_FINGERPRINT_KERNELS_H__
+#define __DEE_PLUGINS_IMAGE_TRANSFORMER_FINGERPRINT_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "plugins_cpu.h"
+
+struct fingerprint_hash_t {
+    uint64_t low;
+    uint64_t high;
+};
+
+/** @brief 128-bit XXH3 hash of a buffer
+ *  Same value as XXH3_128bits() of xxHash 0.8, that is default secret and seed 0, so
+ *  digests can be checked with 'xxhsum -H2'. Inputs longer than 240 bytes use SIMD
+ *  accumulation allowed by 'level', shorter ones are scalar.
+ */
+fingerprint_hash_t fingerprint_xxh3_128(CpuLevel level,
+                                        const uint8_t* data, /**< [in] Input bytes */
+                                        size_t size          /**< [in] Number of bytes */
+);
+
+#endif // __DEE_PLUGINS_IMAGE_TRANSFORMER_FINGERPRINT_KERNELS_H__
@@ -0,0 +1,444 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_api.h"
+#include "image_transformer_letterbox_kernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const PropertyInfo img_transformer_info[] = {
+    {"threshold", PROPERTY_TYPE_INTEGER, "Highest level above black, in 8-bit code values, still treated as black.",
+     "12", "0:255", 0, 1, ACCESS_TYPE_USER},
+    {"row_step", PROPERTY_TYPE_INTEGER, "Only every n-th row of the picture is scanned when looking for side bars.",
+     "8", "1:64", 0, 1, ACCESS_TYPE_USER},
+    {"hysteresis", PROPERTY_TYPE_INTEGER,
+     "Number of consecutive frames that must show larger bars before they are reported. Smaller bars are reported "
+     "immediately, so picture is never reported as bar.",
+     "12", "1:10000", 0, 1, ACCESS_TYPE_USER},
+    {"align", PROPERTY_TYPE_INTEGER, "Bars are rounded down to a multiple of this value and of chroma subsampling.",
+     "2", "1:64", 0, 1, ACCESS_TYPE_USER},
+    {"crop", PROPERTY_TYPE_STRING,
+     "Removes TOP,BOTTOM,LEFT,RIGHT samples from every frame, so output size is the same for the whole stream. "
+     "Values must be multiples of chroma subsampling, typically bars reported by a previous pass without crop. "
+     "Letterbox describes bars left inside the cropped frame.",
+     NULL, NULL, 0, 1, ACCESS_TYPE_USER},
+    {"simd", PROPERTY_TYPE_STRING, "Instruction set used by scanning kernels, limited to what the CPU supports.",
+     "auto", "auto:scalar:avx2:avx512", 0, 1, ACCESS_TYPE_USER},
+};
+
+static size_t img_transformer_letterbox_get_info(const PropertyInfo** info) {
+    *info = img_transformer_info;
+    return sizeof(img_transformer_info) / sizeof(PropertyInfo);
+}
+
+/* Row or column is picture when more than 1/noise_ratio of its samples are above black */
+static const size_t noise_ratio = 64;
+
+struct img_transformer_letterbox_data_t {
+    std::string msg;
+    int threshold{12};
+    size_t rowStep{8};
+    int hysteresis{12};
+    int64_t align{2};
+    bool crop{false};
+    CpuLevel cpuLevel{cpu_level()};
+    std::vector<uint16_t> counts;
+
+    bool detected{false}; /* 'current' holds a result */
+    ImgTransformerLetterbox current{0, 0, 0, 0};
+    ImgTransformerLetterbox candidate{0, 0, 0, 0};
+    int candidateFrames{0};
+
+    ImgTransformerLetterbox cropped{0, 0, 0, 0};
+};
+
+/* This structure can contain only pointers and simple types */
+struct img_transformer_letterbox_t {
+    img_transformer_letterbox_data_t* data;
+};
+
+static size_t img_transformer_letterbox_get_size() {
+    return sizeof(img_transformer_letterbox_t);
+}
+
+static bool parse_bars(const std::string& value, ImgTransformerLetterbox& bars) {
+    int64_t* sides[4] = {&bars.top, &bars.bottom, &bars.left, &bars.right};
+    size_t pos = 0;
+    for (int i = 0; i < 4; i++) {
+        size_t sep = i < 3 ? value.find(',', pos) : value.size();
+        if (std::string::npos == sep || sep == pos || sep - pos > 6)
+            return false;
+        std::string side = value.substr(pos, sep - pos);
+        if (side.find_first_not_of("0123456789") != std::string::npos)
+            return false;
+        *sides[i] = (int64_t)std::atol(side.c_str());
+        pos = sep + 1;
+    }
+    return true;
+}
+
+static Status img_transformer_letterbox_init(ImgTransformerHandle handle, const ImgTransformerInitParams* init_params) {
+    img_transformer_letterbox_t* state = (img_transformer_letterbox_t*)handle;
+    state->data = new img_transformer_letterbox_data_t;
+    auto invalidValue = [&](const std::string& option, const std::string& value, const std::string& expectedValues) {
+        return "Invalid '" + option + "' option value: '" + value + "'. Expected value: " + expectedValues + ".";
+    };
+    for (int i = 0; i < (int)init_params->count; i++) {
+        std::string name(init_params->properties[i].name);
+        std::string value(init_params->properties[i].value);
+        if (name == "threshold") {
+            state->data->threshold = std::atoi(value.c_str());
+            if (state->data->threshold < 0 || state->data->threshold > 255) {
+                state->data->msg = invalidValue(name, value, "0:255");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "row_step") {
+            int step = std::atoi(value.c_str());
+            if (step < 1 || step > 64) {
+                state->data->msg = invalidValue(name, value, "1:64");
+                return STATUS_ERROR;
+            }
+            state->data->rowStep = (size_t)step;
+        }
+        else if (name == "hysteresis") {
+            state->data->hysteresis = std::atoi(value.c_str());
+            if (state->data->hysteresis < 1 || state->data->hysteresis > 10000) {
+                state->data->msg = invalidValue(name, value, "1:10000");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "align") {
+            state->data->align = std::atoi(value.c_str());
+            if (state->data->align < 1 || state->data->align > 64) {
+                state->data->msg = invalidValue(name, value, "1:64");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "crop") {
+            if (!parse_bars(value, state->data->cropped)) {
+                state->data->msg = invalidValue(name, value, "TOP,BOTTOM,LEFT,RIGHT");
+                return STATUS_ERROR;
+            }
+            state->data->crop = true;
+        }
+        else if (name == "simd") {
+            if (!parse_cpu_level(value, state->data->cpuLevel)) {
+                state->data->msg = invalidValue(name, value, "auto:scalar:avx2:avx512");
+                return STATUS_ERROR;
+            }
+        }
+        else {
+            state->data->msg = "Could not recognise option '" + name + "'.";
+            return STATUS_ERROR;
+        }
+    }
+    state->data->msg = "SIMD: " + std::string(cpu_level_name(state->data->cpuLevel));
+    return STATUS_OK;
+}
+
+static Status img_transformer_letterbox_close(ImgTransformerHandle handle) {
+    img_transformer_letterbox_t* state = (img_transformer_letterbox_t*)handle;
+    if (state && state->data) {
+        delete state->data;
+        state->data = nullptr;
+    }
+    return STATUS_OK;
+}
+
+static int input_bits(ImgTransformerBitdepth bitdepth) {
+    switch (bitdepth) {
+    case BIT_DEPTH_UINT10_LSB:
+        return 10;
+    case BIT_DEPTH_UINT12_LSB:
+        return 12;
+    case BIT_DEPTH_UINT14_LSB:
+        return 14;
+    case BIT_DEPTH_UINT16:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+static int64_t round_down(int64_t value, int64_t align, int64_t sub) {
+    int64_t step = align;
+    while (step % sub)
+        step += align;
+    return value / step * step;
+}
+
+/* Planes which are scanned, all of them have full resolution */
+struct scan_t {
+    const uint16_t* plane[3];
+    int planes;
+    size_t width;
+    size_t height;
+    uint16_t threshold;
+};
+
+static bool is_picture_row(const scan_t& scan, CpuLevel level, size_t y) {
+    size_t count = 0;
+    for (int p = 0; p < scan.planes; p++)
+        count += letterbox_count_row(level, scan.plane[p] + y * scan.width, scan.width, scan.threshold);
+    return count * noise_ratio > scan.width * scan.planes;
+}
+
+/* Finds bars of one frame, returns false for a frame without picture */
+static bool detect(img_transformer_letterbox_data_t* data, const scan_t& scan, ImgTransformerLetterbox& bars) {
+    const CpuLevel level = data->cpuLevel;
+    size_t top = 0;
+    while (top < scan.height && !is_picture_row(scan, level, top))
+        top++;
+    if (top == scan.height)
+        return false;
+    size_t bottom = 0;
+    while (!is_picture_row(scan, level, scan.height - 1 - bottom))
+        bottom++;
+
+    data->counts.assign(scan.width, 0);
+    size_t samples = 0;
+    for (size_t y = top; y < scan.height - bottom && samples + scan.planes <= 0xffff; y += data->rowStep) {
+        for (int p = 0; p < scan.planes; p++)
+            letterbox_count_columns(level, scan.plane[p] + y * scan.width, scan.width, scan.threshold,
+                                    data->counts.data());
+        samples += scan.planes;
+    }
+    size_t left = 0;
+    while (left < scan.width && (size_t)data->counts[left] * noise_ratio <= samples)
+        left++;
+    /* Picture rows spread too thin to make any column picture */
+    if (left == scan.width)
+        return false;
+    size_t right = 0;
+    while ((size_t)data->counts[scan.width - 1 - right] * noise_ratio <= samples)
+        right++;
+
+    bars.top = (int64_t)top;
+    bars.bottom = (int64_t)bottom;
+    bars.left = (int64_t)left;
+    bars.right = (int64_t)right;
+    return true;
+}
+
+static bool same_bars(const ImgTransformerLetterbox& a, const ImgTransformerLetterbox& b) {
+    return a.top == b.top && a.bottom == b.bottom && a.left == b.left && a.right == b.right;
+}
+
+/* Bars shrink at once when picture shows up in them, and grow only after 'hysteresis' frames agree */
+static void update(img_transformer_letterbox_data_t* data, const ImgTransformerLetterbox& bars) {
+    ImgTransformerLetterbox& current = data->current;
+    if (!data->detected) {
+        current = bars;
+        data->detected = true;
+        data->candidateFrames = 0;
+        return;
+    }
+    current.top = std::min(current.top, bars.top);
+    current.bottom = std::min(current.bottom, bars.bottom);
+    current.left = std::min(current.left, bars.left);
+    current.right = std::min(current.right, bars.right);
+    if (same_bars(current, bars)) {
+        data->candidateFrames = 0;
+        return;
+    }
+    if (data->candidateFrames > 0 && same_bars(data->candidate, bars))
+        data->candidateFrames++;
+    else {
+        data->candidate = bars;
+        data->candidateFrames = 1;
+    }
+    if (data->candidateFrames >= data->hysteresis) {
+        current = bars;
+        data->candidateFrames = 0;
+    }
+}
+
+/* Moves the window of every plane to the start of the buffer, planes stay packed */
+static void crop_frame(ImgTransformerFrame* frame, const ImgTransformerLetterbox& bars, int hsub, int vsub) {
+    ImgTransformerMetadata& metadata = frame->metadata;
+    uint16_t* src = (uint16_t*)frame->data.buffer;
+    uint16_t* dst = src;
+    for (int p = 0; p < 3; p++) {
+        const int64_t h = p ? hsub : 1;
+        const int64_t v = p ? vsub : 1;
+        const size_t width = (size_t)((metadata.width + h - 1) / h);
+        const size_t height = (size_t)((metadata.height + v - 1) / v);
+        const size_t left = (size_t)(bars.left / h);
+        const size_t top = (size_t)(bars.top / v);
+        const size_t outWidth = (size_t)((metadata.width - bars.left - bars.right + h - 1) / h);
+        const size_t outHeight = (size_t)((metadata.height - bars.top - bars.bottom + v - 1) / v);
+        for (size_t y = 0; y < outHeight; y++, dst += outWidth)
+            memmove(dst, src + (top + y) * width + left, outWidth * sizeof(uint16_t));
+        src += width * height;
+    }
+    metadata.width -= bars.left + bars.right;
+    metadata.height -= bars.top + bars.bottom;
+    frame->data.size = (int64_t)((uint8_t*)dst - frame->data.buffer);
+}
+
+/* Checks that 'crop' leaves picture and keeps chroma aligned, returns false with message otherwise */
+static bool check_crop(img_transformer_letterbox_data_t* data, const ImgTransformerMetadata& metadata, int hsub,
+                       int vsub) {
+    const ImgTransformerLetterbox& bars = data->cropped;
+    if (bars.top % vsub || bars.bottom % vsub || bars.left % hsub || bars.right % hsub) {
+        data->msg = "'crop' values must be multiples of chroma subsampling.";
+        return false;
+    }
+    if (bars.top + bars.bottom >= metadata.height || bars.left + bars.right >= metadata.width) {
+        data->msg = "'crop' removes the whole frame.";
+        return false;
+    }
+    return true;
+}
+
+static Status img_transformer_letterbox_process(ImgTransformerHandle handle, ImgTransformerFrame* frame) {
+    img_transformer_letterbox_t* state = (img_transformer_letterbox_t*)handle;
+    img_transformer_letterbox_data_t* data = state->data;
+    ImgTransformerMetadata& metadata = frame->metadata;
+    data->msg.clear();
+
+    int bits = input_bits(metadata.bitdepth);
+    if (PLANAR != metadata.arrangement || 0 == bits) {
+        data->msg = "Input must be planar with 10 to 16 bits per sample.";
+        return STATUS_ERROR;
+    }
+    const int hsub = SUBSAMPLING_S444 == metadata.subsampling ? 1 : 2;
+    const int vsub = SUBSAMPLING_S420 == metadata.subsampling ? 2 : 1;
+    const size_t width = (size_t)metadata.width;
+    const size_t height = (size_t)metadata.height;
+    const size_t lumaSize = width * height;
+    const size_t chromaSize = ((width + hsub - 1) / hsub) * ((height + vsub - 1) / vsub);
+    if (metadata.width <= 0 || metadata.height <= 0 ||
+        frame->data.size < (int64_t)((lumaSize + 2 * chromaSize) * sizeof(uint16_t))) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return STATUS_ERROR;
+    }
+
+    /* Luma carries the picture of YUV, RGB needs all planes */
+    scan_t scan;
+    scan.width = width;
+    scan.height = height;
+    scan.planes = COLOR_SPACE_RGB == metadata.colorspace && 1 == hsub && 1 == vsub ? 3 : 1;
+    for (int p = 0; p < 3; p++)
+        scan.plane[p] = (const uint16_t*)frame->data.buffer + p * lumaSize;
+    bool legal =
+        RANGE_LEGAL == metadata.range || (RANGE_UNKNOWN == metadata.range && COLOR_SPACE_RGB != metadata.colorspace);
+    uint32_t threshold = ((legal ? 16u : 0u) + (uint32_t)data->threshold) << (bits - 8);
+    scan.threshold = (uint16_t)std::min(threshold, (1u << bits) - 1);
+
+    ImgTransformerLetterbox bars;
+    if (detect(data, scan, bars)) {
+        bars.top = round_down(bars.top, data->align, vsub);
+        bars.bottom = round_down(bars.bottom, data->align, vsub);
+        bars.left = round_down(bars.left, data->align, hsub);
+        bars.right = round_down(bars.right, data->align, hsub);
+        update(data, bars);
+    }
+    if (!data->crop) {
+        metadata.letterbox = data->current;
+        return STATUS_OK;
+    }
+    if (!check_crop(data, metadata, hsub, vsub))
+        return STATUS_ERROR;
+    metadata.letterbox.top = std::max<int64_t>(0, data->current.top - data->cropped.top);
+    metadata.letterbox.bottom = std::max<int64_t>(0, data->current.bottom - data->cropped.bottom);
+    metadata.letterbox.left = std::max<int64_t>(0, data->current.left - data->cropped.left);
+    metadata.letterbox.right = std::max<int64_t>(0, data->current.right - data->cropped.right);
+    crop_frame(frame, data->cropped, hsub, vsub);
+    return STATUS_OK;
+}
+
+static Status img_transformer_letterbox_get_output_size(ImgTransformerHandle handle,
+                                                        const ImgTransformerMetadata* inMetadata,
+                                                        ImgTransformerMetadata* outMetadata, int64_t* outSize) {
+    img_transformer_letterbox_t* state = (img_transformer_letterbox_t*)handle;
+    img_transformer_letterbox_data_t* data = state->data;
+    data->msg.clear();
+
+    if (PLANAR != inMetadata->arrangement || 0 == input_bits(inMetadata->bitdepth)) {
+        data->msg = "Input must be planar with 10 to 16 bits per sample.";
+        return STATUS_ERROR;
+    }
+    const int hsub = SUBSAMPLING_S444 == inMetadata->subsampling ? 1 : 2;
+    const int vsub = SUBSAMPLING_S420 == inMetadata->subsampling ? 2 : 1;
+    const ImgTransformerLetterbox& bars = data->cropped;
+    *outMetadata = *inMetadata;
+    if (outMetadata->width <= 0 || outMetadata->height <= 0) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return STATUS_ERROR;
+    }
+    if (data->crop) {
+        if (!check_crop(data, *inMetadata, hsub, vsub))
+            return STATUS_ERROR;
+        outMetadata->width -= bars.left + bars.right;
+        outMetadata->height -= bars.top + bars.bottom;
+    }
+    const size_t width = (size_t)outMetadata->width;
+    const size_t height = (size_t)outMetadata->height;
+    *outSize = (int64_t)((width * height + 2 * ((width + hsub - 1) / hsub) * ((height + vsub - 1) / vsub)) *
+                         sizeof(uint16_t));
+    return STATUS_OK;
+}
+
+static const char* img_transformer_letterbox_get_message(ImgTransformerHandle handle) {
+    img_transformer_letterbox_t* state = (img_transformer_letterbox_t*)handle;
+    if (state && state->data)
+        return state->data->msg.empty() ? NULL : state->data->msg.c_str();
+    else
+        return NULL;
+}
+
+static ImgTransformerApi img_transformer_letterbox_plugin_api = {"letterbox",
+                                                                 img_transformer_letterbox_get_info,
+                                                                 img_transformer_letterbox_get_size,
+                                                                 img_transformer_letterbox_init,
+                                                                 img_transformer_letterbox_close,
+                                                                 img_transformer_letterbox_process,
+                                                                 img_transformer_letterbox_get_message,
+                                                                 img_transformer_letterbox_get_output_size,
+                                                                 NULL,
+                                                                 NULL};
+
+DLB_EXPORT
+ImgTransformerApi* imgTransformerGetApi() {
+    return &img_transformer_letterbox_plugin_api;
+}
+
+DLB_EXPORT
+int imgTransformerGetApiVersion(void) {
+    return IMG_TRANSFORMER_API_VERSION;
+}
@@ -0,0 +1,151 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_letterbox_kernels.h"
+
+static size_t count_row_scalar(const uint16_t* row, size_t width, uint16_t threshold) {
+    size_t count = 0;
+    for (size_t i = 0; i < width; i++)
+        count += row[i] > threshold;
+    return count;
+}
+
+static void count_columns_scalar(const uint16_t* row, size_t width, uint16_t threshold, uint16_t* counts) {
+    for (size_t i = 0; i < width; i++)
+        counts[i] += row[i] > threshold;
+}
+
+#if defined(DLB_X86)
+
+/* 16-bit lane counters are widened before they can overflow */
+static const size_t flush_iterations = 0x7fff;
+
+DLB_TARGET_AVX2
+static inline __m256i above_avx2(const uint16_t* src, __m256i first) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)src);
+    return _mm256_cmpeq_epi16(_mm256_max_epu16(v, first), v);
+}
+
+DLB_TARGET_AVX2
+static size_t count_row_avx2(const uint16_t* row, size_t width, uint16_t threshold, size_t& done) {
+    /* Unsigned compare is done as max(v, threshold + 1) == v */
+    const __m256i first = _mm256_set1_epi16((short)(threshold + 1));
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    while (i + 16 <= width) {
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t n = 0; n < flush_iterations && i + 16 <= width; n++, i += 16)
+            acc = _mm256_sub_epi16(acc, above_avx2(row + i, first));
+        total = _mm256_add_epi32(total, _mm256_madd_epi16(acc, ones));
+    }
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    done = i;
+    return (size_t)(uint32_t)_mm_cvtsi128_si32(sum);
+}
+
+DLB_TARGET_AVX2
+static size_t count_columns_avx2(const uint16_t* row, size_t width, uint16_t threshold, uint16_t* counts) {
+    const __m256i first = _mm256_set1_epi16((short)(threshold + 1));
+    size_t i = 0;
+    for (; i + 16 <= width; i += 16) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(counts + i));
+        _mm256_storeu_si256((__m256i*)(counts + i), _mm256_sub_epi16(c, above_avx2(row + i, first)));
+    }
+    return i;
+}
+
+DLB_TARGET_AVX512
+static size_t count_row_avx512(const uint16_t* row, size_t width, uint16_t threshold, size_t& done) {
+    const __m512i thr = _mm512_set1_epi16((short)threshold);
+    const __m512i ones = _mm512_set1_epi16(1);
+    __m512i total = _mm512_setzero_si512();
+    size_t i = 0;
+    while (i + 32 <= width) {
+        __m512i acc = _mm512_setzero_si512();
+        for (size_t n = 0; n < flush_iterations && i + 32 <= width; n++, i += 32) {
+            __mmask32 above = _mm512_cmpgt_epu16_mask(_mm512_loadu_si512(row + i), thr);
+            acc = _mm512_mask_add_epi16(acc, above, acc, ones);
+        }
+        total = _mm512_add_epi32(total, _mm512_madd_epi16(acc, ones));
+    }
+    done = i;
+    return (size_t)(uint32_t)_mm512_reduce_add_epi32(total);
+}
+
+DLB_TARGET_AVX512
+static size_t count_columns_avx512(const uint16_t* row, size_t width, uint16_t threshold, uint16_t* counts) {
+    const __m512i thr = _mm512_set1_epi16((short)threshold);
+    const __m512i ones = _mm512_set1_epi16(1);
+    size_t i = 0;
+    for (; i + 32 <= width; i += 32) {
+        __mmask32 above = _mm512_cmpgt_epu16_mask(_mm512_loadu_si512(row + i), thr);
+        __m512i c = _mm512_loadu_si512(counts + i);
+        _mm512_storeu_si512(counts + i, _mm512_mask_add_epi16(c, above, c, ones));
+    }
+    return i;
+}
+
+#endif
+
+size_t letterbox_count_row(CpuLevel level, const uint16_t* row, size_t width, uint16_t threshold) {
+    size_t done = 0;
+    size_t count = 0;
+#if defined(DLB_X86)
+    if (0xffff == threshold)
+        return 0;
+    if (level >= CPU_LEVEL_AVX512)
+        count = count_row_avx512(row, width, threshold, done);
+    else if (level >= CPU_LEVEL_AVX2)
+        count = count_row_avx2(row, width, threshold, done);
+#else
+    (void)level;
+#endif
+    return count + count_row_scalar(row + done, width - done, threshold);
+}
+
+void letterbox_count_columns(CpuLevel level, const uint16_t* row, size_t width, uint16_t threshold, uint16_t* counts) {
+    size_t done = 0;
+#if defined(DLB_X86)
+    if (0xffff == threshold)
+        return;
+    if (level >= CPU_LEVEL_AVX512)
+        done = count_columns_avx512(row, width, threshold, counts);
+    else if (level >= CPU_LEVEL_AVX2)
+        done = count_columns_avx2(row, width, threshold, counts);
+#else
+    (void)level;
+#endif
+    count_columns_scalar(row + done, width - done, threshold, counts + done);
+}
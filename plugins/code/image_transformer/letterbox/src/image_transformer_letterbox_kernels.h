@@ -0,0 +1,58 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_IMAGE_TRANSFORMER_LETTERBOX_KERNELS_H__
+#define __DEE_PLUGINS_IMAGE_TRANSFORMER_LETTERBOX_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "plugins_cpu.h"
+
+/** @brief Counts samples of a row above 'threshold' */
+size_t letterbox_count_row(CpuLevel level,
+                           const uint16_t* row, /**< [in] Samples */
+                           size_t width,        /**< [in] Number of samples */
+                           uint16_t threshold   /**< [in] Highest sample value counted as black */
+);
+
+/** @brief Adds one to counts[i] for every row[i] above 'threshold'
+ *  Counters are 16-bit, so at most 65535 rows can be accumulated.
+ */
+void letterbox_count_columns(CpuLevel level,
+                             const uint16_t* row, /**< [in] Samples */
+                             size_t width,        /**< [in] Number of samples */
+                             uint16_t threshold,  /**< [in] Highest sample value counted as black */
+                             uint16_t* counts     /**< [in,out] 'width' counters */
+);
+
+#endif // __DEE_PLUGINS_IMAGE_TRANSFORMER_LETTERBOX_KERNELS_H__
@@ -0,0 +1,318 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_api.h"
+#include "image_transformer_light_level_kernels.h"
+#include "plugins_threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const PropertyInfo img_transformer_info[] = {
+    {"output_file", PROPERTY_TYPE_STRING,
+     "File written on close with MaxCLL and MaxFALL as 'light_level_max_content' and "
+     "'light_level_max_frame_average' encoder options, one 'name=value' per line.",
+     NULL, NULL, 0, 1, ACCESS_TYPE_USER},
+    {"simd", PROPERTY_TYPE_STRING, "Instruction set used by analysis kernels, limited to what the CPU supports.",
+     "auto", "auto:scalar:avx2:avx512", 0, 1, ACCESS_TYPE_USER},
+    {"thread_num", PROPERTY_TYPE_INTEGER, "Number of threads analysing bands of rows (0 = number of logical CPUs).",
+     "0", "0:255", 0, 1, ACCESS_TYPE_USER},
+};
+
+static size_t img_transformer_light_level_get_info(const PropertyInfo** info) {
+    *info = img_transformer_info;
+    return sizeof(img_transformer_info) / sizeof(PropertyInfo);
+}
+
+/* Rows per job */
+static const size_t band_rows = 32;
+
+struct img_transformer_light_level_band_t {
+    uint32_t maxCode{0};
+    double sum{0};
+};
+
+struct img_transformer_light_level_data_t {
+    std::string msg;
+    std::string outputFile;
+    CpuLevel cpuLevel{cpu_level()};
+    int threadNum{0};
+    plugins_worker_pool pool;
+    std::vector<img_transformer_light_level_band_t> bands;
+
+    /* PQ to cd/m2 table of the last input format */
+    std::vector<float> nits;
+    int nitsBits{0};
+    bool nitsLegal{false};
+
+    double maxContent{0};
+    double maxFrameAverage{0};
+    int64_t frames{0};
+};
+
+/* This structure can contain only pointers and simple types */
+struct img_transformer_light_level_t {
+    img_transformer_light_level_data_t* data;
+};
+
+static size_t img_transformer_light_level_get_size() {
+    return sizeof(img_transformer_light_level_t);
+}
+
+static Status img_transformer_light_level_init(ImgTransformerHandle handle,
+                                               const ImgTransformerInitParams* init_params) {
+    img_transformer_light_level_t* state = (img_transformer_light_level_t*)handle;
+    state->data = new img_transformer_light_level_data_t;
+    auto invalidValue = [&](const std::string& option, const std::string& value, const std::string& expectedValues) {
+        return "Invalid '" + option + "' option value: '" + value + "'. Expected value: " + expectedValues + ".";
+    };
+    for (int i = 0; i < (int)init_params->count; i++) {
+        std::string name(init_params->properties[i].name);
+        std::string value(init_params->properties[i].value);
+        if (name == "output_file") {
+            state->data->outputFile = value;
+        }
+        else if (name == "simd") {
+            if (!parse_cpu_level(value, state->data->cpuLevel)) {
+                state->data->msg = invalidValue(name, value, "auto:scalar:avx2:avx512");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "thread_num") {
+            state->data->threadNum = std::atoi(value.c_str());
+            if (state->data->threadNum < 0 || state->data->threadNum > 255) {
+                state->data->msg = invalidValue(name, value, "0:255");
+                return STATUS_ERROR;
+            }
+        }
+        else {
+            state->data->msg = "Could not recognise option '" + name + "'.";
+            return STATUS_ERROR;
+        }
+    }
+
+    if (0 == state->data->threadNum)
+        state->data->threadNum = std::max(1, (int)std::thread::hardware_concurrency());
+    state->data->pool.start(state->data->threadNum);
+
+    state->data->msg = "SIMD: " + std::string(cpu_level_name(state->data->cpuLevel));
+    state->data->msg += "\nThreads: " + std::to_string(state->data->threadNum);
+    return STATUS_OK;
+}
+
+static int64_t cd_m2(double value) {
+    return (int64_t)std::min(65535.0, std::ceil(value - 0.5));
+}
+
+static Status img_transformer_light_level_close(ImgTransformerHandle handle) {
+    img_transformer_light_level_t* state = (img_transformer_light_level_t*)handle;
+    Status status = STATUS_OK;
+    if (state && state->data) {
+        if (!state->data->outputFile.empty()) {
+            std::ofstream file(state->data->outputFile.c_str());
+            file << "light_level_max_content=" << cd_m2(state->data->maxContent) << "\n";
+            file << "light_level_max_frame_average=" << cd_m2(state->data->maxFrameAverage) << "\n";
+            if (!file.good())
+                status = STATUS_ERROR;
+        }
+        delete state->data;
+        state->data = nullptr;
+    }
+    return status;
+}
+
+static int input_bits(ImgTransformerBitdepth bitdepth) {
+    switch (bitdepth) {
+    case BIT_DEPTH_UINT10_LSB:
+        return 10;
+    case BIT_DEPTH_UINT12_LSB:
+        return 12;
+    case BIT_DEPTH_UINT14_LSB:
+        return 14;
+    case BIT_DEPTH_UINT16:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+/* SMPTE ST 2084 EOTF of every code value */
+static void make_nits(int bits, bool legal, std::vector<float>& nits) {
+    const double m1 = 2610.0 / 16384.0;
+    const double m2 = 2523.0 / 4096.0 * 128.0;
+    const double c1 = 3424.0 / 4096.0;
+    const double c2 = 2413.0 / 4096.0 * 32.0;
+    const double c3 = 2392.0 / 4096.0 * 32.0;
+    const size_t codes = (size_t)1 << bits;
+    nits.resize(codes);
+    for (size_t code = 0; code < codes; code++) {
+        double e = legal ? ((double)code / (1u << (bits - 8)) - 16.0) / 219.0 : (double)code / (codes - 1);
+        e = std::min(1.0, std::max(0.0, e));
+        double p = std::pow(e, 1.0 / m2);
+        nits[code] = (float)(10000.0 * std::pow(std::max(p - c1, 0.0) / (c2 - c3 * p), 1.0 / m1));
+    }
+}
+
+static Status img_transformer_light_level_process(ImgTransformerHandle handle, ImgTransformerFrame* frame) {
+    img_transformer_light_level_t* state = (img_transformer_light_level_t*)handle;
+    img_transformer_light_level_data_t* data = state->data;
+    ImgTransformerMetadata& metadata = frame->metadata;
+    data->msg.clear();
+
+    int bits = input_bits(metadata.bitdepth);
+    if (PLANAR != metadata.arrangement || 0 == bits) {
+        data->msg = "Input must be planar with 10 to 16 bits per sample.";
+        return STATUS_ERROR;
+    }
+    if (EOTF_PQ != metadata.eotf && EOTF_UNKNOWN != metadata.eotf) {
+        data->msg = "Light level can only be measured on PQ content.";
+        return STATUS_ERROR;
+    }
+    const bool rgb = COLOR_SPACE_RGB == metadata.colorspace;
+    const int hsub = SUBSAMPLING_S444 == metadata.subsampling ? 1 : 2;
+    const int vsub = SUBSAMPLING_S420 == metadata.subsampling ? 2 : 1;
+    if (rgb && hsub * vsub > 1) {
+        data->msg = "RGB input must not be subsampled.";
+        return STATUS_ERROR;
+    }
+    const size_t width = (size_t)metadata.width;
+    const size_t height = (size_t)metadata.height;
+    const size_t chromaWidth = (width + hsub - 1) / hsub;
+    const size_t lumaSize = width * height;
+    const size_t chromaSize = chromaWidth * ((height + vsub - 1) / vsub);
+    if (metadata.width <= 0 || metadata.height <= 0 ||
+        frame->data.size < (int64_t)((lumaSize + 2 * chromaSize) * sizeof(uint16_t))) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return STATUS_ERROR;
+    }
+
+    const bool legal = RANGE_LEGAL == metadata.range || (RANGE_UNKNOWN == metadata.range && !rgb);
+    if (data->nitsBits != bits || data->nitsLegal != legal) {
+        make_nits(bits, legal, data->nits);
+        data->nitsBits = bits;
+        data->nitsLegal = legal;
+    }
+    light_level_coeffs_t coeffs;
+    if (COLOR_SPACE_REC709_YUV == metadata.colorspace)
+        light_level_make_coeffs(0.2126, 0.0722, bits, legal, &coeffs);
+    else
+        light_level_make_coeffs(0.2627, 0.0593, bits, legal, &coeffs);
+    coeffs.rgb = rgb;
+
+    /* Bars are not part of the picture. Left edge is moved to a chroma sample. */
+    const ImgTransformerLetterbox& bars = metadata.letterbox;
+    const size_t top = (size_t)std::max<int64_t>(0, bars.top);
+    const size_t left = (size_t)std::max<int64_t>(0, bars.left) / hsub * hsub;
+    const size_t bottom = (size_t)std::max<int64_t>(0, bars.bottom);
+    const size_t right = (size_t)std::max<int64_t>(0, bars.right);
+    if (top + bottom >= height || left + right >= width) {
+        data->msg = "Letterbox covers the whole frame.";
+        return STATUS_ERROR;
+    }
+    const size_t rows = height - top - bottom;
+    const size_t columns = width - left - right;
+
+    const uint16_t* planes[3];
+    planes[0] = (const uint16_t*)frame->data.buffer;
+    planes[1] = planes[0] + lumaSize;
+    planes[2] = planes[1] + (rgb ? lumaSize : chromaSize);
+
+    const CpuLevel level = data->cpuLevel;
+    const size_t bands = (rows + band_rows - 1) / band_rows;
+    data->bands.assign(bands, img_transformer_light_level_band_t());
+    std::atomic<size_t> next(0);
+    data->pool.run([&](unsigned) {
+        for (size_t band = next++; band < bands; band = next++) {
+            img_transformer_light_level_band_t& result = data->bands[band];
+            size_t last = top + std::min(rows, (band + 1) * band_rows);
+            for (size_t y = top + band * band_rows; y < last; y++) {
+                const size_t c = (y / vsub) * chromaWidth + left / hsub;
+                const uint16_t* src[3] = {planes[0] + y * width + left, planes[1] + (rgb ? y * width + left : c),
+                                          planes[2] + (rgb ? y * width + left : c)};
+                light_level_row(level, coeffs, src, columns, hsub, data->nits.data(), &result.maxCode, &result.sum);
+            }
+        }
+    });
+
+    /* Bands are summed in order, so result does not depend on threading */
+    uint32_t maxCode = 0;
+    double sum = 0;
+    for (size_t band = 0; band < bands; band++) {
+        maxCode = std::max(maxCode, data->bands[band].maxCode);
+        sum += data->bands[band].sum;
+    }
+    const double frameMax = data->nits[maxCode];
+    const double frameAverage = sum / (double)(rows * columns);
+    data->maxContent = std::max(data->maxContent, frameMax);
+    data->maxFrameAverage = std::max(data->maxFrameAverage, frameAverage);
+    data->frames++;
+
+    data->msg = "Frame " + std::to_string(data->frames) + " max: " + std::to_string(cd_m2(frameMax)) +
+                " cd/m2, average: " + std::to_string(cd_m2(frameAverage)) +
+                " cd/m2. MaxCLL: " + std::to_string(cd_m2(data->maxContent)) +
+                " cd/m2, MaxFALL: " + std::to_string(cd_m2(data->maxFrameAverage)) + " cd/m2.";
+    return STATUS_OK;
+}
+
+static const char* img_transformer_light_level_get_message(ImgTransformerHandle handle) {
+    img_transformer_light_level_t* state = (img_transformer_light_level_t*)handle;
+    if (state && state->data)
+        return state->data->msg.empty() ? NULL : state->data->msg.c_str();
+    else
+        return NULL;
+}
+
+static ImgTransformerApi img_transformer_light_level_plugin_api = {"light_level",
+                                                                   img_transformer_light_level_get_info,
+                                                                   img_transformer_light_level_get_size,
+                                                                   img_transformer_light_level_init,
+                                                                   img_transformer_light_level_close,
+                                                                   img_transformer_light_level_process,
+                                                                   img_transformer_light_level_get_message,
+                                                                   NULL,
+                                                                   NULL,
+                                                                   NULL};
+
+DLB_EXPORT
+ImgTransformerApi* imgTransformerGetApi() {
+    return &img_transformer_light_level_plugin_api;
+}
+
+DLB_EXPORT
+int imgTransformerGetApiVersion(void) {
+    return IMG_TRANSFORMER_API_VERSION;
+}
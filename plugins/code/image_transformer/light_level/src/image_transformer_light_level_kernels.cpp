@@ -0,0 +1,249 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_light_level_kernels.h"
+
+#include <math.h>
+
+void light_level_make_coeffs(double kr, double kb, int bits, bool legal, light_level_coeffs_t* coeffs) {
+    const double kg = 1.0 - kr - kb;
+    const double scale = (legal ? 219.0 / 224.0 : 1.0) * (1u << LIGHT_LEVEL_SHIFT);
+    coeffs->rgb = false;
+    coeffs->crToR = (int32_t)lround(2.0 * (1.0 - kr) * scale);
+    coeffs->cbToG = (int32_t)lround(-2.0 * kb * (1.0 - kb) / kg * scale);
+    coeffs->crToG = (int32_t)lround(-2.0 * kr * (1.0 - kr) / kg * scale);
+    coeffs->cbToB = (int32_t)lround(2.0 * (1.0 - kb) * scale);
+    coeffs->chromaZero = 1 << (bits - 1);
+    coeffs->maxCode = (int32_t)((1u << bits) - 1);
+}
+
+static const int32_t round_half = 1 << (LIGHT_LEVEL_SHIFT - 1);
+
+static inline int32_t max3(int32_t a, int32_t b, int32_t c) {
+    int32_t m = a > b ? a : b;
+    return m > c ? m : c;
+}
+
+static void light_level_scalar(const light_level_coeffs_t& c,
+                               const uint16_t* const src[3],
+                               size_t first,
+                               size_t width,
+                               int hsub,
+                               const float* nits,
+                               uint32_t& maxCode,
+                               double& sum) {
+    for (size_t i = first; i < width; i++) {
+        int32_t m;
+        /* Samples above 'bits' would index past the end of 'nits' */
+        if (c.rgb) {
+            m = max3(src[0][i], src[1][i], src[2][i]);
+            m = m > c.maxCode ? c.maxCode : m;
+        }
+        else {
+            const int32_t y = src[0][i];
+            const int32_t cb = src[1][i / hsub] - c.chromaZero;
+            const int32_t cr = src[2][i / hsub] - c.chromaZero;
+            const int32_t r = y + ((c.crToR * cr + round_half) >> LIGHT_LEVEL_SHIFT);
+            const int32_t g = y + ((c.cbToG * cb + c.crToG * cr + round_half) >> LIGHT_LEVEL_SHIFT);
+            const int32_t b = y + ((c.cbToB * cb + round_half) >> LIGHT_LEVEL_SHIFT);
+            m = max3(r, g, b);
+            m = m < 0 ? 0 : (m > c.maxCode ? c.maxCode : m);
+        }
+        if ((uint32_t)m > maxCode)
+            maxCode = (uint32_t)m;
+        sum += nits[m];
+    }
+}
+
+#if defined(DLB_X86)
+
+DLB_TARGET_AVX2
+static inline __m256i load8_avx2(const uint16_t* src) {
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)src));
+}
+
+DLB_TARGET_AVX2
+static inline __m256i weigh_avx2(__m256i y, __m256i a, __m256i wa, __m256i b, __m256i wb, __m256i round) {
+    __m256i v = _mm256_add_epi32(_mm256_mullo_epi32(a, wa), _mm256_mullo_epi32(b, wb));
+    return _mm256_add_epi32(y, _mm256_srai_epi32(_mm256_add_epi32(v, round), LIGHT_LEVEL_SHIFT));
+}
+
+DLB_TARGET_AVX2
+static size_t light_level_avx2(const light_level_coeffs_t& c,
+                               const uint16_t* const src[3],
+                               size_t width,
+                               int hsub,
+                               const float* nits,
+                               uint32_t& maxCode,
+                               double& sum) {
+    const __m256i zero = _mm256_set1_epi32(c.chromaZero);
+    const __m256i crToR = _mm256_set1_epi32(c.crToR);
+    const __m256i cbToG = _mm256_set1_epi32(c.cbToG);
+    const __m256i crToG = _mm256_set1_epi32(c.crToG);
+    const __m256i cbToB = _mm256_set1_epi32(c.cbToB);
+    const __m256i none = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi32(round_half);
+    const __m256i top = _mm256_set1_epi32(c.maxCode);
+    const __m256i pairs = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    __m256i vmax = _mm256_setzero_si256();
+    __m256 vsum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= width; i += 8) {
+        __m256i m;
+        __m256i y = load8_avx2(src[0] + i);
+        if (c.rgb)
+            m = _mm256_min_epi32(_mm256_max_epi32(_mm256_max_epi32(y, load8_avx2(src[1] + i)), load8_avx2(src[2] + i)),
+                                 top);
+        else {
+            __m256i cb, cr;
+            if (1 == hsub) {
+                cb = load8_avx2(src[1] + i);
+                cr = load8_avx2(src[2] + i);
+            }
+            else {
+                cb = _mm256_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(src[1] + i / 2)));
+                cr = _mm256_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(src[2] + i / 2)));
+                cb = _mm256_permutevar8x32_epi32(cb, pairs);
+                cr = _mm256_permutevar8x32_epi32(cr, pairs);
+            }
+            cb = _mm256_sub_epi32(cb, zero);
+            cr = _mm256_sub_epi32(cr, zero);
+            __m256i r = weigh_avx2(y, cr, crToR, none, none, round);
+            __m256i g = weigh_avx2(y, cb, cbToG, cr, crToG, round);
+            __m256i b = weigh_avx2(y, cb, cbToB, none, none, round);
+            m = _mm256_max_epi32(_mm256_max_epi32(r, g), b);
+            m = _mm256_min_epi32(_mm256_max_epi32(m, none), top);
+        }
+        vmax = _mm256_max_epu32(vmax, m);
+        vsum = _mm256_add_ps(vsum, _mm256_i32gather_ps(nits, m, 4));
+    }
+    __m128i m4 = _mm_max_epu32(_mm256_castsi256_si128(vmax), _mm256_extracti128_si256(vmax, 1));
+    m4 = _mm_max_epu32(m4, _mm_shuffle_epi32(m4, _MM_SHUFFLE(1, 0, 3, 2)));
+    m4 = _mm_max_epu32(m4, _mm_shuffle_epi32(m4, _MM_SHUFFLE(2, 3, 0, 1)));
+    uint32_t m = (uint32_t)_mm_cvtsi128_si32(m4);
+    if (m > maxCode)
+        maxCode = m;
+    __m128 s4 = _mm_add_ps(_mm256_castps256_ps128(vsum), _mm256_extractf128_ps(vsum, 1));
+    s4 = _mm_add_ps(s4, _mm_movehl_ps(s4, s4));
+    s4 = _mm_add_ss(s4, _mm_shuffle_ps(s4, s4, 1));
+    sum += _mm_cvtss_f32(s4);
+    return i;
+}
+
+DLB_TARGET_AVX512
+static inline __m512i load16_avx512(const uint16_t* src) {
+    return _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)src));
+}
+
+DLB_TARGET_AVX512
+static inline __m512i weigh_avx512(__m512i y, __m512i a, __m512i wa, __m512i b, __m512i wb, __m512i round) {
+    __m512i v = _mm512_add_epi32(_mm512_mullo_epi32(a, wa), _mm512_mullo_epi32(b, wb));
+    return _mm512_add_epi32(y, _mm512_srai_epi32(_mm512_add_epi32(v, round), LIGHT_LEVEL_SHIFT));
+}
+
+DLB_TARGET_AVX512
+static size_t light_level_avx512(const light_level_coeffs_t& c,
+                                 const uint16_t* const src[3],
+                                 size_t width,
+                                 int hsub,
+                                 const float* nits,
+                                 uint32_t& maxCode,
+                                 double& sum) {
+    const __m512i zero = _mm512_set1_epi32(c.chromaZero);
+    const __m512i crToR = _mm512_set1_epi32(c.crToR);
+    const __m512i cbToG = _mm512_set1_epi32(c.cbToG);
+    const __m512i crToG = _mm512_set1_epi32(c.crToG);
+    const __m512i cbToB = _mm512_set1_epi32(c.cbToB);
+    const __m512i none = _mm512_setzero_si512();
+    const __m512i round = _mm512_set1_epi32(round_half);
+    const __m512i top = _mm512_set1_epi32(c.maxCode);
+    const __m512i pairs = _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+    __m512i vmax = _mm512_setzero_si512();
+    __m512 vsum = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= width; i += 16) {
+        __m512i m;
+        __m512i y = load16_avx512(src[0] + i);
+        if (c.rgb)
+            m = _mm512_min_epi32(
+                _mm512_max_epi32(_mm512_max_epi32(y, load16_avx512(src[1] + i)), load16_avx512(src[2] + i)), top);
+        else {
+            __m512i cb, cr;
+            if (1 == hsub) {
+                cb = load16_avx512(src[1] + i);
+                cr = load16_avx512(src[2] + i);
+            }
+            else {
+                cb = _mm512_cvtepu16_epi32(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(src[1] + i / 2))));
+                cr = _mm512_cvtepu16_epi32(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(src[2] + i / 2))));
+                cb = _mm512_permutexvar_epi32(pairs, cb);
+                cr = _mm512_permutexvar_epi32(pairs, cr);
+            }
+            cb = _mm512_sub_epi32(cb, zero);
+            cr = _mm512_sub_epi32(cr, zero);
+            __m512i r = weigh_avx512(y, cr, crToR, none, none, round);
+            __m512i g = weigh_avx512(y, cb, cbToG, cr, crToG, round);
+            __m512i b = weigh_avx512(y, cb, cbToB, none, none, round);
+            m = _mm512_max_epi32(_mm512_max_epi32(r, g), b);
+            m = _mm512_min_epi32(_mm512_max_epi32(m, none), top);
+        }
+        vmax = _mm512_max_epu32(vmax, m);
+        vsum = _mm512_add_ps(vsum, _mm512_i32gather_ps(m, nits, 4));
+    }
+    uint32_t m = _mm512_reduce_max_epu32(vmax);
+    if (m > maxCode)
+        maxCode = m;
+    sum += _mm512_reduce_add_ps(vsum);
+    return i;
+}
+
+#endif
+
+void light_level_row(CpuLevel level,
+                     const light_level_coeffs_t& coeffs,
+                     const uint16_t* const src[3],
+                     size_t width,
+                     int hsub,
+                     const float* nits,
+                     uint32_t* maxCode,
+                     double* sum) {
+    size_t done = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        done = light_level_avx512(coeffs, src, width, hsub, nits, *maxCode, *sum);
+    else if (level >= CPU_LEVEL_AVX2)
+        done = light_level_avx2(coeffs, src, width, hsub, nits, *maxCode, *sum);
+#else
+    (void)level;
+#endif
+    light_level_scalar(coeffs, src, done, width, hsub, nits, *maxCode, *sum);
+}
@@ -0,0 +1,74 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_IMAGE_TRANSFORMER_LIGHT_LEVEL_KERNELS_H__
+#define __DEE_PLUGINS_IMAGE_TRANSFORMER_LIGHT_LEVEL_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "plugins_cpu.h"
+
+#define LIGHT_LEVEL_SHIFT 12
+
+/** @brief Fixed-point Y'CbCr to R'G'B' coefficients
+ *  R'G'B' is computed in luma code values, so the range of chroma is folded into
+ *  the weights. Green weights are negative.
+ */
+typedef struct {
+    bool rgb;           /**< Planes are R', G', B' and no matrix is applied */
+    int32_t crToR;      /**< Scaled by 2^LIGHT_LEVEL_SHIFT */
+    int32_t cbToG;      /**< Scaled by 2^LIGHT_LEVEL_SHIFT */
+    int32_t crToG;      /**< Scaled by 2^LIGHT_LEVEL_SHIFT */
+    int32_t cbToB;      /**< Scaled by 2^LIGHT_LEVEL_SHIFT */
+    int32_t chromaZero; /**< Code value of zero chroma */
+    int32_t maxCode;    /**< Largest code value */
+} light_level_coeffs_t;
+
+/** @brief Computes coefficients for Y'CbCr matrix given by luma weights of red and blue */
+void light_level_make_coeffs(double kr, double kb, int bits, bool legal, light_level_coeffs_t* coeffs);
+
+/** @brief Light level of one row
+ *  Light level of a pixel is the largest of its R', G' and B', converted to cd/m2
+ *  by 'nits'. Subsampled chroma is taken from the nearest sample on the left.
+ */
+void light_level_row(CpuLevel level,
+                     const light_level_coeffs_t& coeffs,
+                     const uint16_t* const src[3], /**< [in] Y, Cb, Cr or R, G, B rows */
+                     size_t width,                 /**< [in] Pixels per row */
+                     int hsub,                     /**< [in] Horizontal chroma subsampling, 1 or 2 */
+                     const float* nits,            /**< [in] Light level of each code value up to 'maxCode' */
+                     uint32_t* maxCode,            /**< [in,out] Largest code value seen */
+                     double* sum                   /**< [in,out] Sum of light levels */
+);
+
+#endif // __DEE_PLUGINS_IMAGE_TRANSFORMER_LIGHT_LEVEL_KERNELS_H__
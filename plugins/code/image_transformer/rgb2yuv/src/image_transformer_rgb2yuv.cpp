@@ -0,0 +1,371 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_api.h"
+#include "image_transformer_rgb2yuv_kernels.h"
+#include "plugins_buffers.h"
+#include "plugins_threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const PropertyInfo img_transformer_info[] = {
+    {"matrix", PROPERTY_TYPE_STRING,
+     "Y'CbCr matrix. 'auto' uses bt2020 for Rec. 2020 input primaries and bt709 otherwise.", "auto",
+     "auto:bt709:bt2020", 0, 1, ACCESS_TYPE_USER},
+    {"subsampling", PROPERTY_TYPE_STRING, "Chroma subsampling of output.", "420", "420:422:444", 0, 1,
+     ACCESS_TYPE_USER},
+    {"range", PROPERTY_TYPE_STRING, "Output range, legal is 64-940 for luma and 64-960 for chroma.", "legal",
+     "legal:full", 0, 1, ACCESS_TYPE_USER},
+    {"simd", PROPERTY_TYPE_STRING, "Instruction set used by conversion kernels, limited to what the CPU supports.",
+     "auto", "auto:scalar:avx2:avx512", 0, 1, ACCESS_TYPE_USER},
+    {"thread_num", PROPERTY_TYPE_INTEGER, "Number of threads converting bands of rows (0 = number of logical CPUs).",
+     "0", "0:255", 0, 1, ACCESS_TYPE_USER},
+};
+
+static size_t img_transformer_rgb2yuv_get_info(const PropertyInfo** info) {
+    *info = img_transformer_info;
+    return sizeof(img_transformer_info) / sizeof(PropertyInfo);
+}
+
+/* Output is always 10-bit, as expected by HEVC encoders */
+static const int output_bits = 10;
+
+/* Chroma rows converted by one job */
+static const int band_rows = 16;
+
+struct img_transformer_rgb2yuv_data_t {
+    std::string msg;
+    std::string matrix{"auto"};
+    ImgTransformerSubsampling subsampling{SUBSAMPLING_S420};
+    bool legal{true};
+    CpuLevel cpuLevel{cpu_level()};
+    int threadNum{0};
+    plugins_worker_pool pool;
+    std::vector<uint16_t> chroma; /* Subsampled Cb and Cr, they overlap unread input when written in place */
+    plugins_buffer_pool frames;   /* Outputs of processTo */
+};
+
+/* This structure can contain only pointers and simple types */
+struct img_transformer_rgb2yuv_t {
+    img_transformer_rgb2yuv_data_t* data;
+};
+
+static size_t img_transformer_rgb2yuv_get_size() {
+    return sizeof(img_transformer_rgb2yuv_t);
+}
+
+static Status img_transformer_rgb2yuv_init(ImgTransformerHandle handle, const ImgTransformerInitParams* init_params) {
+    img_transformer_rgb2yuv_t* state = (img_transformer_rgb2yuv_t*)handle;
+    state->data = new img_transformer_rgb2yuv_data_t;
+    auto invalidValue = [&](const std::string& option, const std::string& value, const std::string& expectedValues) {
+        return "Invalid '" + option + "' option value: '" + value + "'. Expected value: " + expectedValues + ".";
+    };
+    for (int i = 0; i < (int)init_params->count; i++) {
+        std::string name(init_params->properties[i].name);
+        std::string value(init_params->properties[i].value);
+        if (name == "matrix") {
+            if (value != "auto" && value != "bt709" && value != "bt2020") {
+                state->data->msg = invalidValue(name, value, "auto:bt709:bt2020");
+                return STATUS_ERROR;
+            }
+            state->data->matrix = value;
+        }
+        else if (name == "subsampling") {
+            if (value == "420")
+                state->data->subsampling = SUBSAMPLING_S420;
+            else if (value == "422")
+                state->data->subsampling = SUBSAMPLING_S422;
+            else if (value == "444")
+                state->data->subsampling = SUBSAMPLING_S444;
+            else {
+                state->data->msg = invalidValue(name, value, "420:422:444");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "range") {
+            if (value != "legal" && value != "full") {
+                state->data->msg = invalidValue(name, value, "legal:full");
+                return STATUS_ERROR;
+            }
+            state->data->legal = value == "legal";
+        }
+        else if (name == "simd") {
+            if (!parse_cpu_level(value, state->data->cpuLevel)) {
+                state->data->msg = invalidValue(name, value, "auto:scalar:avx2:avx512");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "thread_num") {
+            state->data->threadNum = std::atoi(value.c_str());
+            if (state->data->threadNum < 0 || state->data->threadNum > 255) {
+                state->data->msg = invalidValue(name, value, "0:255");
+                return STATUS_ERROR;
+            }
+        }
+        else {
+            state->data->msg = "Could not recognise option '" + name + "'.";
+            return STATUS_ERROR;
+        }
+    }
+
+    if (0 == state->data->threadNum)
+        state->data->threadNum = std::max(1, (int)std::thread::hardware_concurrency());
+    state->data->pool.start(state->data->threadNum);
+
+    state->data->msg = "SIMD: " + std::string(cpu_level_name(state->data->cpuLevel));
+    state->data->msg += "\nThreads: " + std::to_string(state->data->threadNum);
+    return STATUS_OK;
+}
+
+static Status img_transformer_rgb2yuv_close(ImgTransformerHandle handle) {
+    img_transformer_rgb2yuv_t* state = (img_transformer_rgb2yuv_t*)handle;
+    if (state && state->data) {
+        delete state->data;
+        state->data = nullptr;
+    }
+    return STATUS_OK;
+}
+
+static int input_bits(ImgTransformerBitdepth bitdepth) {
+    switch (bitdepth) {
+    case BIT_DEPTH_UINT10_LSB:
+        return 10;
+    case BIT_DEPTH_UINT12_LSB:
+        return 12;
+    case BIT_DEPTH_UINT14_LSB:
+        return 14;
+    case BIT_DEPTH_UINT16:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+static bool check_input(img_transformer_rgb2yuv_data_t* data, const ImgTransformerMetadata& metadata,
+                        const int64_t* size) {
+    int bits = input_bits(metadata.bitdepth);
+    if (PLANAR != metadata.arrangement || COLOR_SPACE_RGB != metadata.colorspace || 0 == bits) {
+        data->msg = "Input must be planar RGB with 10 to 16 bits per sample.";
+        return false;
+    }
+    if (metadata.width <= 0 || metadata.height <= 0 ||
+        (size && *size < (int64_t)(3 * (size_t)metadata.width * (size_t)metadata.height * sizeof(uint16_t)))) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return false;
+    }
+    return true;
+}
+
+static bool use_bt2020(const img_transformer_rgb2yuv_data_t* data, const ImgTransformerMetadata& metadata) {
+    return data->matrix == "bt2020" || (data->matrix == "auto" && CHROMA_REC2020 == metadata.chroma);
+}
+
+/* Samples of one output chroma plane */
+static size_t chroma_size(const img_transformer_rgb2yuv_data_t* data, const ImgTransformerMetadata& metadata) {
+    const size_t hsub = SUBSAMPLING_S444 == data->subsampling ? 1 : 2;
+    const size_t vsub = SUBSAMPLING_S420 == data->subsampling ? 2 : 1;
+    return ((size_t)metadata.width + hsub - 1) / hsub * (((size_t)metadata.height + vsub - 1) / vsub);
+}
+
+/* Returns size of output in bytes */
+static int64_t output_metadata(const img_transformer_rgb2yuv_data_t* data, ImgTransformerMetadata& metadata) {
+    const size_t chromaSize = chroma_size(data, metadata);
+    metadata.colorspace = use_bt2020(data, metadata) ? COLOR_SPACE_REC2020_YUV : COLOR_SPACE_REC709_YUV;
+    metadata.subsampling = data->subsampling;
+    metadata.bitdepth = BIT_DEPTH_UINT10_LSB;
+    metadata.range = data->legal ? RANGE_LEGAL : RANGE_COMPUTER;
+    return (int64_t)(((size_t)metadata.width * (size_t)metadata.height + 2 * chromaSize) * sizeof(uint16_t));
+}
+
+/* Converts checked planar RGB into luma and chroma planes. Output planes may be the input planes,
+ * luma rows and 4:4:4 chroma rows are written only after the same input rows were read. */
+static void convert(img_transformer_rgb2yuv_data_t* data, const ImgTransformerMetadata& metadata,
+                    const uint16_t* const rgb[3], uint16_t* luma, uint16_t* cb, uint16_t* cr) {
+    const int inBits = input_bits(metadata.bitdepth);
+    rgb2yuv_coeffs_t coeffs;
+    if (use_bt2020(data, metadata))
+        rgb2yuv_make_coeffs(0.2627, 0.0593, inBits, output_bits, data->legal, &coeffs);
+    else
+        rgb2yuv_make_coeffs(0.2126, 0.0722, inBits, output_bits, data->legal, &coeffs);
+
+    const size_t width = (size_t)metadata.width;
+    const size_t height = (size_t)metadata.height;
+    const int hsub = SUBSAMPLING_S444 == data->subsampling ? 1 : 2;
+    const int vsub = SUBSAMPLING_S420 == data->subsampling ? 2 : 1;
+    const size_t chromaWidth = (width + hsub - 1) / hsub;
+    const size_t chromaHeight = (height + vsub - 1) / vsub;
+
+    const CpuLevel level = data->cpuLevel;
+    const size_t bands = (chromaHeight + band_rows - 1) / band_rows;
+    std::atomic<size_t> next(0);
+    data->pool.run([&](unsigned) {
+        for (size_t band = next++; band < bands; band = next++) {
+            size_t last = std::min(chromaHeight, (band + 1) * band_rows);
+            for (size_t j = band * band_rows; j < last; j++) {
+                size_t y = j * vsub;
+                const uint16_t* src0[3] = {rgb[0] + y * width, rgb[1] + y * width, rgb[2] + y * width};
+                const uint16_t* const* src1 = NULL;
+                uint16_t* y1 = NULL;
+                /* Odd last row is paired with itself */
+                const uint16_t* second[3];
+                if (2 == vsub) {
+                    size_t y2 = std::min(y + 1, height - 1);
+                    for (int s = 0; s < 3; s++)
+                        second[s] = rgb[s] + y2 * width;
+                    src1 = second;
+                    if (y2 != y)
+                        y1 = luma + y2 * width;
+                }
+                rgb2yuv_rows(level, coeffs, src0, src1, width, hsub, luma + y * width, y1, cb + j * chromaWidth,
+                             cr + j * chromaWidth);
+            }
+        }
+    });
+}
+
+/* Converts planar RGB in place. Luma replaces red plane row by row and 4:4:4
+ * chroma replaces green and blue, so only subsampled chroma needs a buffer. */
+static Status img_transformer_rgb2yuv_process(ImgTransformerHandle handle, ImgTransformerFrame* frame) {
+    img_transformer_rgb2yuv_t* state = (img_transformer_rgb2yuv_t*)handle;
+    img_transformer_rgb2yuv_data_t* data = state->data;
+    ImgTransformerMetadata& metadata = frame->metadata;
+    data->msg.clear();
+
+    if (!check_input(data, metadata, &frame->data.size))
+        return STATUS_ERROR;
+    const size_t planeSize = (size_t)metadata.width * (size_t)metadata.height;
+    uint16_t* rgb[3];
+    for (int s = 0; s < 3; s++)
+        rgb[s] = (uint16_t*)frame->data.buffer + s * planeSize;
+    uint16_t* cb = rgb[1];
+    uint16_t* cr = rgb[2];
+    const bool subsampled = SUBSAMPLING_S444 != data->subsampling;
+    const size_t chromaSize = chroma_size(data, metadata);
+    if (subsampled) {
+        if (data->chroma.size() < 2 * chromaSize)
+            data->chroma.resize(2 * chromaSize);
+        cb = data->chroma.data();
+        cr = cb + chromaSize;
+    }
+
+    convert(data, metadata, rgb, rgb[0], cb, cr);
+    if (subsampled)
+        memcpy(rgb[1], cb, 2 * chromaSize * sizeof(uint16_t));
+
+    frame->data.size = output_metadata(data, metadata);
+    return STATUS_OK;
+}
+
+/* Converts into a buffer of the plugin, subsampled chroma is written to its place without a copy */
+static Status img_transformer_rgb2yuv_process_to(ImgTransformerHandle handle, const ImgTransformerFrame* inFrame,
+                                                 ImgTransformerFrame* outFrame) {
+    img_transformer_rgb2yuv_t* state = (img_transformer_rgb2yuv_t*)handle;
+    img_transformer_rgb2yuv_data_t* data = state->data;
+    data->msg.clear();
+
+    if (!check_input(data, inFrame->metadata, &inFrame->data.size))
+        return STATUS_ERROR;
+    ImgTransformerMetadata metadata = inFrame->metadata;
+    const int64_t size = output_metadata(data, metadata);
+    size_t capacity = 0;
+    uint8_t* buffer = data->frames.acquire((size_t)size, capacity);
+
+    const size_t planeSize = (size_t)metadata.width * (size_t)metadata.height;
+    const size_t chromaSize = chroma_size(data, metadata);
+    const uint16_t* rgb[3];
+    for (int s = 0; s < 3; s++)
+        rgb[s] = (const uint16_t*)inFrame->data.buffer + s * planeSize;
+    uint16_t* luma = (uint16_t*)buffer;
+    convert(data, inFrame->metadata, rgb, luma, luma + planeSize, luma + planeSize + chromaSize);
+
+    outFrame->metadata = metadata;
+    outFrame->data.buffer = buffer;
+    outFrame->data.size = size;
+    outFrame->data.bufferSize = (int64_t)capacity;
+    return STATUS_OK;
+}
+
+static Status img_transformer_rgb2yuv_release(ImgTransformerHandle handle, ImgTransformerFrame* outFrame) {
+    img_transformer_rgb2yuv_t* state = (img_transformer_rgb2yuv_t*)handle;
+    if (!state->data->frames.release(outFrame->data.buffer)) {
+        state->data->msg = "Frame was not returned by this plugin or was already released.";
+        return STATUS_ERROR;
+    }
+    outFrame->data.buffer = NULL;
+    return STATUS_OK;
+}
+
+static Status img_transformer_rgb2yuv_get_output_size(ImgTransformerHandle handle,
+                                                      const ImgTransformerMetadata* inMetadata,
+                                                      ImgTransformerMetadata* outMetadata, int64_t* outSize) {
+    img_transformer_rgb2yuv_t* state = (img_transformer_rgb2yuv_t*)handle;
+    state->data->msg.clear();
+    if (!check_input(state->data, *inMetadata, NULL))
+        return STATUS_ERROR;
+    *outMetadata = *inMetadata;
+    *outSize = output_metadata(state->data, *outMetadata);
+    return STATUS_OK;
+}
+
+static const char* img_transformer_rgb2yuv_get_message(ImgTransformerHandle handle) {
+    img_transformer_rgb2yuv_t* state = (img_transformer_rgb2yuv_t*)handle;
+    if (state && state->data)
+        return state->data->msg.empty() ? NULL : state->data->msg.c_str();
+    else
+        return NULL;
+}
+
+static ImgTransformerApi img_transformer_rgb2yuv_plugin_api = {"rgb2yuv",
+                                                               img_transformer_rgb2yuv_get_info,
+                                                               img_transformer_rgb2yuv_get_size,
+                                                               img_transformer_rgb2yuv_init,
+                                                               img_transformer_rgb2yuv_close,
+                                                               img_transformer_rgb2yuv_process,
+                                                               img_transformer_rgb2yuv_get_message,
+                                                               img_transformer_rgb2yuv_get_output_size,
+                                                               img_transformer_rgb2yuv_process_to,
+                                                               img_transformer_rgb2yuv_release};
+
+DLB_EXPORT
+ImgTransformerApi* imgTransformerGetApi() {
+    return &img_transformer_rgb2yuv_plugin_api;
+}
+
+DLB_EXPORT
+int imgTransformerGetApiVersion(void) {
+    return IMG_TRANSFORMER_API_VERSION;
+}
@@ -0,0 +1,349 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_rgb2yuv_kernels.h"
+
+#include <math.h>
+
+/* Sum of 'rows' x 'hsub' chroma samples is scaled down by 2^(RGB2YUV_CHROMA_SHIFT + k) */
+static int sum_shift(int hsub, int rows) {
+    return (hsub * rows == 4) ? 2 : (hsub * rows == 2) ? 1 : 0;
+}
+
+void rgb2yuv_make_coeffs(double kr, double kb, int inBits, int outBits, bool legal, rgb2yuv_coeffs_t* coeffs) {
+    const double inMax = (double)((1u << inBits) - 1);
+    const double lumaScale = (legal ? (219u << (outBits - 8)) : (1u << outBits) - 1) / inMax;
+    const double chromaScale = (legal ? (224u << (outBits - 8)) : (1u << outBits) - 1) / inMax;
+
+    /* Weights are rounded so that they keep their exact sums: white maps to the
+     * top of luma range and grey has zero chroma */
+    const double ls = lumaScale * (1u << RGB2YUV_LUMA_SHIFT);
+    int32_t lumaR = (int32_t)lround(kr * ls);
+    int32_t lumaB = (int32_t)lround(kb * ls);
+    coeffs->luma[0] = (uint32_t)lumaR;
+    coeffs->luma[1] = (uint32_t)((int32_t)lround(ls) - lumaR - lumaB);
+    coeffs->luma[2] = (uint32_t)lumaB;
+
+    const double cs = chromaScale * (1u << RGB2YUV_CHROMA_SHIFT);
+    int32_t cbR = (int32_t)lround(-kr / (2.0 * (1.0 - kb)) * cs);
+    int32_t cbB = (int32_t)lround(0.5 * cs);
+    coeffs->cb[0] = (uint32_t)cbR;
+    coeffs->cb[1] = (uint32_t)(-cbR - cbB);
+    coeffs->cb[2] = (uint32_t)cbB;
+
+    int32_t crR = (int32_t)lround(0.5 * cs);
+    int32_t crB = (int32_t)lround(-kb / (2.0 * (1.0 - kr)) * cs);
+    coeffs->cr[0] = (uint32_t)crR;
+    coeffs->cr[1] = (uint32_t)(-crR - crB);
+    coeffs->cr[2] = (uint32_t)crB;
+
+    uint32_t black = legal ? 16u << (outBits - 8) : 0;
+    coeffs->lumaOffset = (black << RGB2YUV_LUMA_SHIFT) + (1u << (RGB2YUV_LUMA_SHIFT - 1));
+    coeffs->chromaZero = (1u << (outBits - 1)) << RGB2YUV_CHROMA_SHIFT;
+    coeffs->maxCode = (1u << outBits) - 1;
+}
+
+static inline uint16_t clamp_code(uint32_t v, uint32_t maxCode) {
+    return (uint16_t)(v < maxCode ? v : maxCode);
+}
+
+/* Converts pixels from 'first' on, 'first' is even when 'hsub' is 2 */
+static void rgb2yuv_scalar(const rgb2yuv_coeffs_t& c,
+                           const uint16_t* const src0[3],
+                           const uint16_t* const src1[3],
+                           size_t first,
+                           size_t width,
+                           int hsub,
+                           uint16_t* y0,
+                           uint16_t* y1,
+                           uint16_t* cb,
+                           uint16_t* cr) {
+    const int k = sum_shift(hsub, src1 ? 2 : 1);
+    const uint32_t chromaOffset = (c.chromaZero << k) + (1u << (RGB2YUV_CHROMA_SHIFT + k - 1));
+    const int chromaShift = RGB2YUV_CHROMA_SHIFT + k;
+
+    const uint16_t* const* rows[2] = {src0, src1};
+    uint16_t* luma[2] = {y0, y1};
+    for (size_t x = first; x < width; x += hsub) {
+        /* Odd last column is counted twice. Luma may overwrite red input, so it is
+         * stored after all samples of the block are read. */
+        const int cols = (x + 1 < width) ? hsub : 1;
+        uint32_t sum[3] = {0, 0, 0};
+        uint16_t y[2][2];
+        for (int r = 0; r < (src1 ? 2 : 1); r++) {
+            for (int i = 0; i < cols; i++) {
+                uint32_t red = rows[r][0][x + i];
+                uint32_t green = rows[r][1][x + i];
+                uint32_t blue = rows[r][2][x + i];
+                sum[0] += red;
+                sum[1] += green;
+                sum[2] += blue;
+                y[r][i] = clamp_code(
+                    (c.luma[0] * red + c.luma[1] * green + c.luma[2] * blue + c.lumaOffset) >> RGB2YUV_LUMA_SHIFT,
+                    c.maxCode);
+            }
+        }
+        if (cols < hsub) {
+            for (int s = 0; s < 3; s++)
+                sum[s] *= 2;
+        }
+        for (int r = 0; r < (src1 ? 2 : 1); r++) {
+            if (luma[r]) {
+                for (int i = 0; i < cols; i++)
+                    luma[r][x + i] = y[r][i];
+            }
+        }
+        size_t j = x / hsub;
+        cb[j] = clamp_code((c.cb[0] * sum[0] + c.cb[1] * sum[1] + c.cb[2] * sum[2] + chromaOffset) >> chromaShift,
+                           c.maxCode);
+        cr[j] = clamp_code((c.cr[0] * sum[0] + c.cr[1] * sum[1] + c.cr[2] * sum[2] + chromaOffset) >> chromaShift,
+                           c.maxCode);
+    }
+}
+
+#if defined(DLB_X86)
+
+DLB_TARGET_AVX2
+static inline __m256i weigh_avx2(__m256i r, __m256i g, __m256i b, const __m256i w[3], __m256i offset, int shift) {
+    __m256i t = _mm256_add_epi32(_mm256_mullo_epi32(r, w[0]), _mm256_mullo_epi32(g, w[1]));
+    t = _mm256_add_epi32(t, _mm256_mullo_epi32(b, w[2]));
+    return _mm256_srl_epi32(_mm256_add_epi32(t, offset), _mm_cvtsi32_si128(shift));
+}
+
+/* Widens 16 samples to two vectors of 8 */
+DLB_TARGET_AVX2
+static inline void widen_avx2(const uint16_t* src, __m256i& lo, __m256i& hi, __m256i& pairs) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)src);
+    lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v));
+    hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1));
+    pairs = _mm256_add_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xFFFF)), _mm256_srli_epi32(v, 16));
+}
+
+DLB_TARGET_AVX2
+static inline void store16_avx2(uint16_t* dst, __m256i lo, __m256i hi, __m256i maxCode) {
+    __m256i v = _mm256_packus_epi32(_mm256_min_epu32(lo, maxCode), _mm256_min_epu32(hi, maxCode));
+    _mm256_storeu_si256((__m256i*)dst, _mm256_permute4x64_epi64(v, 0xD8));
+}
+
+DLB_TARGET_AVX2
+static inline void store8_avx2(uint16_t* dst, __m256i v, __m256i maxCode) {
+    v = _mm256_min_epu32(v, maxCode);
+    v = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+    _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(v));
+}
+
+/* 16 pixels per iteration, all loads of an iteration happen before its stores */
+DLB_TARGET_AVX2
+static size_t rgb2yuv_avx2(const rgb2yuv_coeffs_t& c,
+                           const uint16_t* const src0[3],
+                           const uint16_t* const src1[3],
+                           size_t width,
+                           int hsub,
+                           uint16_t* y0,
+                           uint16_t* y1,
+                           uint16_t* cb,
+                           uint16_t* cr) {
+    const int k = sum_shift(hsub, src1 ? 2 : 1);
+    const __m256i luma[3] = {_mm256_set1_epi32((int)c.luma[0]), _mm256_set1_epi32((int)c.luma[1]),
+                             _mm256_set1_epi32((int)c.luma[2])};
+    const __m256i wcb[3] = {_mm256_set1_epi32((int)c.cb[0]), _mm256_set1_epi32((int)c.cb[1]),
+                            _mm256_set1_epi32((int)c.cb[2])};
+    const __m256i wcr[3] = {_mm256_set1_epi32((int)c.cr[0]), _mm256_set1_epi32((int)c.cr[1]),
+                            _mm256_set1_epi32((int)c.cr[2])};
+    const __m256i lumaOffset = _mm256_set1_epi32((int)c.lumaOffset);
+    const __m256i chromaOffset =
+        _mm256_set1_epi32((int)((c.chromaZero << k) + (1u << (RGB2YUV_CHROMA_SHIFT + k - 1))));
+    const int chromaShift = RGB2YUV_CHROMA_SHIFT + k;
+    const __m256i maxCode = _mm256_set1_epi32((int)c.maxCode);
+
+    size_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i lo0[3], hi0[3], pairs[3];
+        for (int s = 0; s < 3; s++)
+            widen_avx2(src0[s] + x, lo0[s], hi0[s], pairs[s]);
+        /* 'y1' is only given together with 'src1', zeroing just silences -Wmaybe-uninitialized */
+        __m256i lo1[3] = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+        __m256i hi1[3] = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+        if (src1) {
+            for (int s = 0; s < 3; s++) {
+                __m256i p;
+                widen_avx2(src1[s] + x, lo1[s], hi1[s], p);
+                pairs[s] = _mm256_add_epi32(pairs[s], p);
+            }
+        }
+
+        store16_avx2(y0 + x, weigh_avx2(lo0[0], lo0[1], lo0[2], luma, lumaOffset, RGB2YUV_LUMA_SHIFT),
+                     weigh_avx2(hi0[0], hi0[1], hi0[2], luma, lumaOffset, RGB2YUV_LUMA_SHIFT), maxCode);
+        if (y1) {
+            store16_avx2(y1 + x, weigh_avx2(lo1[0], lo1[1], lo1[2], luma, lumaOffset, RGB2YUV_LUMA_SHIFT),
+                         weigh_avx2(hi1[0], hi1[1], hi1[2], luma, lumaOffset, RGB2YUV_LUMA_SHIFT), maxCode);
+        }
+
+        if (2 == hsub) {
+            store8_avx2(cb + x / 2, weigh_avx2(pairs[0], pairs[1], pairs[2], wcb, chromaOffset, chromaShift),
+                        maxCode);
+            store8_avx2(cr + x / 2, weigh_avx2(pairs[0], pairs[1], pairs[2], wcr, chromaOffset, chromaShift),
+                        maxCode);
+        }
+        else {
+            if (src1) {
+                for (int s = 0; s < 3; s++) {
+                    lo0[s] = _mm256_add_epi32(lo0[s], lo1[s]);
+                    hi0[s] = _mm256_add_epi32(hi0[s], hi1[s]);
+                }
+            }
+            store16_avx2(cb + x, weigh_avx2(lo0[0], lo0[1], lo0[2], wcb, chromaOffset, chromaShift),
+                         weigh_avx2(hi0[0], hi0[1], hi0[2], wcb, chromaOffset, chromaShift), maxCode);
+            store16_avx2(cr + x, weigh_avx2(lo0[0], lo0[1], lo0[2], wcr, chromaOffset, chromaShift),
+                         weigh_avx2(hi0[0], hi0[1], hi0[2], wcr, chromaOffset, chromaShift), maxCode);
+        }
+    }
+    return x;
+}
+
+DLB_TARGET_AVX512
+static inline __m512i weigh_avx512(__m512i r, __m512i g, __m512i b, const __m512i w[3], __m512i offset, int shift) {
+    __m512i t = _mm512_add_epi32(_mm512_mullo_epi32(r, w[0]), _mm512_mullo_epi32(g, w[1]));
+    t = _mm512_add_epi32(t, _mm512_mullo_epi32(b, w[2]));
+    return _mm512_srl_epi32(_mm512_add_epi32(t, offset), _mm_cvtsi32_si128(shift));
+}
+
+DLB_TARGET_AVX512
+static inline void widen_avx512(const uint16_t* src, __m512i& lo, __m512i& hi, __m512i& pairs) {
+    __m512i v = _mm512_loadu_si512(src);
+    lo = _mm512_cvtepu16_epi32(_mm512_castsi512_si256(v));
+    hi = _mm512_cvtepu16_epi32(_mm512_extracti64x4_epi64(v, 1));
+    pairs = _mm512_add_epi32(_mm512_and_si512(v, _mm512_set1_epi32(0xFFFF)), _mm512_srli_epi32(v, 16));
+}
+
+DLB_TARGET_AVX512
+static inline void store16_avx512(uint16_t* dst, __m512i v, __m512i maxCode) {
+    _mm256_storeu_si256((__m256i*)dst, _mm512_cvtepi32_epi16(_mm512_min_epu32(v, maxCode)));
+}
+
+/* 32 pixels per iteration, same structure as the AVX2 kernel */
+DLB_TARGET_AVX512
+static size_t rgb2yuv_avx512(const rgb2yuv_coeffs_t& c,
+                             const uint16_t* const src0[3],
+                             const uint16_t* const src1[3],
+                             size_t width,
+                             int hsub,
+                             uint16_t* y0,
+                             uint16_t* y1,
+                             uint16_t* cb,
+                             uint16_t* cr) {
+    const int k = sum_shift(hsub, src1 ? 2 : 1);
+    const __m512i luma[3] = {_mm512_set1_epi32((int)c.luma[0]), _mm512_set1_epi32((int)c.luma[1]),
+                             _mm512_set1_epi32((int)c.luma[2])};
+    const __m512i wcb[3] = {_mm512_set1_epi32((int)c.cb[0]), _mm512_set1_epi32((int)c.cb[1]),
+                            _mm512_set1_epi32((int)c.cb[2])};
+    const __m512i wcr[3] = {_mm512_set1_epi32((int)c.cr[0]), _mm512_set1_epi32((int)c.cr[1]),
+                            _mm512_set1_epi32((int)c.cr[2])};
+    const __m512i lumaOffset = _mm512_set1_epi32((int)c.lumaOffset);
+    const __m512i chromaOffset =
+        _mm512_set1_epi32((int)((c.chromaZero << k) + (1u << (RGB2YUV_CHROMA_SHIFT + k - 1))));
+    const int chromaShift = RGB2YUV_CHROMA_SHIFT + k;
+    const __m512i maxCode = _mm512_set1_epi32((int)c.maxCode);
+
+    size_t x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m512i lo0[3], hi0[3], pairs[3];
+        for (int s = 0; s < 3; s++)
+            widen_avx512(src0[s] + x, lo0[s], hi0[s], pairs[s]);
+        /* 'y1' is only given together with 'src1', zeroing just silences -Wmaybe-uninitialized */
+        __m512i lo1[3] = {_mm512_setzero_si512(), _mm512_setzero_si512(), _mm512_setzero_si512()};
+        __m512i hi1[3] = {_mm512_setzero_si512(), _mm512_setzero_si512(), _mm512_setzero_si512()};
+        if (src1) {
+            for (int s = 0; s < 3; s++) {
+                __m512i p;
+                widen_avx512(src1[s] + x, lo1[s], hi1[s], p);
+                pairs[s] = _mm512_add_epi32(pairs[s], p);
+            }
+        }
+
+        store16_avx512(y0 + x, weigh_avx512(lo0[0], lo0[1], lo0[2], luma, lumaOffset, RGB2YUV_LUMA_SHIFT), maxCode);
+        store16_avx512(y0 + x + 16, weigh_avx512(hi0[0], hi0[1], hi0[2], luma, lumaOffset, RGB2YUV_LUMA_SHIFT),
+                       maxCode);
+        if (y1) {
+            store16_avx512(y1 + x, weigh_avx512(lo1[0], lo1[1], lo1[2], luma, lumaOffset, RGB2YUV_LUMA_SHIFT),
+                           maxCode);
+            store16_avx512(y1 + x + 16, weigh_avx512(hi1[0], hi1[1], hi1[2], luma, lumaOffset, RGB2YUV_LUMA_SHIFT),
+                           maxCode);
+        }
+
+        if (2 == hsub) {
+            store16_avx512(cb + x / 2, weigh_avx512(pairs[0], pairs[1], pairs[2], wcb, chromaOffset, chromaShift),
+                           maxCode);
+            store16_avx512(cr + x / 2, weigh_avx512(pairs[0], pairs[1], pairs[2], wcr, chromaOffset, chromaShift),
+                           maxCode);
+        }
+        else {
+            if (src1) {
+                for (int s = 0; s < 3; s++) {
+                    lo0[s] = _mm512_add_epi32(lo0[s], lo1[s]);
+                    hi0[s] = _mm512_add_epi32(hi0[s], hi1[s]);
+                }
+            }
+            store16_avx512(cb + x, weigh_avx512(lo0[0], lo0[1], lo0[2], wcb, chromaOffset, chromaShift), maxCode);
+            store16_avx512(cb + x + 16, weigh_avx512(hi0[0], hi0[1], hi0[2], wcb, chromaOffset, chromaShift),
+                           maxCode);
+            store16_avx512(cr + x, weigh_avx512(lo0[0], lo0[1], lo0[2], wcr, chromaOffset, chromaShift), maxCode);
+            store16_avx512(cr + x + 16, weigh_avx512(hi0[0], hi0[1], hi0[2], wcr, chromaOffset, chromaShift),
+                           maxCode);
+        }
+    }
+    return x;
+}
+
+#endif
+
+void rgb2yuv_rows(CpuLevel level,
+                  const rgb2yuv_coeffs_t& coeffs,
+                  const uint16_t* const src0[3],
+                  const uint16_t* const src1[3],
+                  size_t width,
+                  int hsub,
+                  uint16_t* y0,
+                  uint16_t* y1,
+                  uint16_t* cb,
+                  uint16_t* cr) {
+    size_t done = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        done = rgb2yuv_avx512(coeffs, src0, src1, width, hsub, y0, y1, cb, cr);
+    else if (level >= CPU_LEVEL_AVX2)
+        done = rgb2yuv_avx2(coeffs, src0, src1, width, hsub, y0, y1, cb, cr);
+#else
+    (void)level;
+#endif
+    rgb2yuv_scalar(coeffs, src0, src1, done, width, hsub, y0, y1, cb, cr);
+}
@@ -0,0 +1,79 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_IMAGE_TRANSFORMER_RGB2YUV_KERNELS_H__
+#define __DEE_PLUGINS_IMAGE_TRANSFORMER_RGB2YUV_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "plugins_cpu.h"
+
+#define RGB2YUV_LUMA_SHIFT 20
+#define RGB2YUV_CHROMA_SHIFT 19
+
+/** @brief Fixed-point conversion coefficients
+ *  Weights are applied to input code values, so input bit depth and output range
+ *  are folded in. Chroma weights are two's complement, all arithmetic is done
+ *  modulo 2^32 which keeps SIMD kernels bit-exact with the scalar code.
+ */
+typedef struct {
+    uint32_t luma[3];     /**< R, G, B weights scaled by 2^RGB2YUV_LUMA_SHIFT */
+    uint32_t cb[3];       /**< R, G, B weights scaled by 2^RGB2YUV_CHROMA_SHIFT */
+    uint32_t cr[3];       /**< R, G, B weights scaled by 2^RGB2YUV_CHROMA_SHIFT */
+    uint32_t lumaOffset;  /**< Black level and rounding, scaled by 2^RGB2YUV_LUMA_SHIFT */
+    uint32_t chromaZero;  /**< Zero chroma level scaled by 2^RGB2YUV_CHROMA_SHIFT, without rounding */
+    uint32_t maxCode;     /**< Largest output code value */
+} rgb2yuv_coeffs_t;
+
+/** @brief Computes coefficients for Y'CbCr matrix given by luma weights of red and blue
+ *  'legal' selects narrow range output (64 - 940 luma, 64 - 960 chroma for 10 bits).
+ */
+void rgb2yuv_make_coeffs(double kr, double kb, int inBits, int outBits, bool legal, rgb2yuv_coeffs_t* coeffs);
+
+/** @brief Converts one or two rows of planar RGB to Y'CbCr
+ *  Chroma is the average of 'hsub' x 'rows' pixels, 'rows' being 2 when 'src1' is
+ *  given. Odd last column is replicated. Luma row may share memory with R row of
+ *  the same input row.
+ */
+void rgb2yuv_rows(CpuLevel level,
+                  const rgb2yuv_coeffs_t& coeffs,
+                  const uint16_t* const src0[3], /**< [in] R, G, B rows */
+                  const uint16_t* const src1[3], /**< [in] R, G, B of the second row, NULL for one row */
+                  size_t width,                  /**< [in] Pixels per row */
+                  int hsub,                      /**< [in] Horizontal chroma subsampling, 1 or 2 */
+                  uint16_t* y0,                  /**< [out] Luma of first row */
+                  uint16_t* y1,                  /**< [out] Luma of second row, NULL skips it */
+                  uint16_t* cb,                  /**< [out] (width + hsub - 1) / hsub chroma samples */
+                  uint16_t* cr);
+
+#endif // __DEE_PLUGINS_IMAGE_TRANSFORMER_RGB2YUV_KERNELS_H__
@@ -0,0 +1,137 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Checks that SIMD kernels of every instruction set level supported by the CPU give
+ * the same result as the scalar kernel, over widths around vector sizes, chroma
+ * subsampling, input bit depths, ranges and matrices.
+ */
+
+#include "image_transformer_rgb2yuv_kernels.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+/* Deterministic samples, so a failure can be reproduced */
+static uint32_t next_random(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+struct test_case_t {
+    size_t width;
+    int hsub;
+    bool twoRows;
+    int inBits;
+    bool legal;
+    bool bt2020;
+    bool inPlace; /* Luma replaces red, as the transformer does */
+};
+
+/* Converts with 'level' and returns Y0, Y1, Cb, Cr rows one after another */
+static std::vector<uint16_t> convert(CpuLevel level, const test_case_t& t, const rgb2yuv_coeffs_t& coeffs,
+                                     const std::vector<uint16_t>& rgb) {
+    const size_t w = t.width;
+    const size_t chromaWidth = (w + t.hsub - 1) / t.hsub;
+    std::vector<uint16_t> in(rgb);
+    std::vector<uint16_t> out(2 * w + 2 * chromaWidth, 0xdead);
+    const uint16_t* src0[3] = {&in[0], &in[w], &in[2 * w]};
+    const uint16_t* src1[3] = {&in[3 * w], &in[4 * w], &in[5 * w]};
+    uint16_t* y0 = t.inPlace ? &in[0] : &out[0];
+    uint16_t* y1 = t.twoRows ? (t.inPlace ? &in[3 * w] : &out[w]) : NULL;
+    rgb2yuv_rows(level, coeffs, src0, t.twoRows ? src1 : NULL, w, t.hsub, y0, y1, &out[2 * w],
+                 &out[2 * w + chromaWidth]);
+    if (t.inPlace) {
+        std::copy(in.begin(), in.begin() + w, out.begin());
+        if (t.twoRows)
+            std::copy(in.begin() + 3 * w, in.begin() + 4 * w, out.begin() + w);
+    }
+    return out;
+}
+
+/* Returns number of levels giving a different result than scalar, or 1 if scalar result is out of range */
+static int run_case(const test_case_t& t, uint32_t& state) {
+    rgb2yuv_coeffs_t coeffs;
+    if (t.bt2020)
+        rgb2yuv_make_coeffs(0.2627, 0.0593, t.inBits, 10, t.legal, &coeffs);
+    else
+        rgb2yuv_make_coeffs(0.2126, 0.0722, t.inBits, 10, t.legal, &coeffs);
+
+    /* Random samples with runs of black and full scale pixels, which stress rounding and clamping */
+    const size_t w = t.width;
+    const uint32_t maxIn = (1u << t.inBits) - 1;
+    std::vector<uint16_t> rgb(6 * w);
+    for (size_t i = 0; i < rgb.size(); i++)
+        rgb[i] = (uint16_t)(next_random(state) & maxIn);
+    for (size_t i = 0; i < w; i += 5)
+        for (int s = 0; s < 6; s++)
+            rgb[s * w + i] = (uint16_t)(i % 10 ? maxIn : 0);
+
+    char name[160];
+    snprintf(name, sizeof(name), "width %zu, hsub %d, rows %d, bits %d, legal %d, bt2020 %d, in place %d", w, t.hsub,
+             t.twoRows ? 2 : 1, t.inBits, t.legal, t.bt2020, t.inPlace);
+    const std::vector<uint16_t> expected = convert(CPU_LEVEL_SCALAR, t, coeffs, rgb);
+    for (size_t i = 0; i < expected.size(); i++) {
+        const bool unused = !t.twoRows && i >= w && i < 2 * w;
+        if (!unused && expected[i] > coeffs.maxCode) {
+            printf("scalar sample %zu out of range: %s\n", i, name);
+            return 1;
+        }
+    }
+    int failures = 0;
+    for (int level = CPU_LEVEL_SCALAR + 1; level <= cpu_level(); level++) {
+        if (convert((CpuLevel)level, t, coeffs, rgb) != expected) {
+            printf("%s differs from scalar: %s\n", cpu_level_name((CpuLevel)level), name);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main() {
+    static const size_t widths[] = {1, 2, 3, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 127, 128, 129, 1920, 1921};
+    static const int bits[] = {10, 12, 16};
+    uint32_t state = 1;
+    int cases = 0;
+    int failures = 0;
+    for (size_t w : widths)
+        for (int hsub = 1; hsub <= 2; hsub++)
+            for (int options = 0; options < 16; options++)
+                for (int inBits : bits) {
+                    const test_case_t t = {w, hsub, 0 != (options & 1), inBits, 0 != (options & 2), 0 != (options & 4),
+                                           0 != (options & 8)};
+                    failures += run_case(t, state);
+                    cases++;
+                }
+    printf("%d cases, levels up to %s, %d failure(s)\n", cases, cpu_level_name(cpu_level()), failures);
+    return failures ? 1 : 0;
+}
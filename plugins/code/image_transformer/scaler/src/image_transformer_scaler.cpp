@@ -0,0 +1,446 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_api.h"
+#include "image_transformer_scaler_kernels.h"
+#include "plugins_buffers.h"
+#include "plugins_threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static const int max_output_num = 4;
+
+static const PropertyInfo img_transformer_info[] = {
+    {"output_size", PROPERTY_TYPE_STRING,
+     "Output size as WIDTHxHEIGHT, not larger than input. First size replaces the frame, further sizes are scaled "
+     "in the same pass over the input and stored in the frame buffer after the first one, in the same order. All "
+     "sizes together must fit in the frame buffer capacity.",
+     NULL, NULL, 1, max_output_num, ACCESS_TYPE_USER},
+    {"filter", PROPERTY_TYPE_STRING, "Resampling filter, lanczos has 3 lobes.", "lanczos", "lanczos:bicubic:bilinear",
+     0, 1, ACCESS_TYPE_USER},
+    {"simd", PROPERTY_TYPE_STRING, "Instruction set used by scaling kernels, limited to what the CPU supports.",
+     "auto", "auto:scalar:avx2:avx512", 0, 1, ACCESS_TYPE_USER},
+    {"thread_num", PROPERTY_TYPE_INTEGER, "Number of threads scaling bands of rows (0 = number of logical CPUs).",
+     "0", "0:255", 0, 1, ACCESS_TYPE_USER},
+};
+
+static size_t img_transformer_scaler_get_info(const PropertyInfo** info) {
+    *info = img_transformer_info;
+    return sizeof(img_transformer_info) / sizeof(PropertyInfo);
+}
+
+/* Input rows per job. All outputs of a band are produced while its rows are in cache. */
+static const size_t band_rows = 32;
+
+/* One output size. Index 0 of filters and bands is luma, 1 is chroma. */
+struct img_transformer_scaler_output_t {
+    size_t width{0};
+    size_t height{0};
+    scaler_filter_t horizontal[2];
+    scaler_filter_t vertical[2];
+    std::vector<size_t> bandFirstRow[2]; /* First output row of each band, one extra entry ends the last band */
+    size_t offset{0};                    /* Start in output buffer, samples */
+    size_t samples{0};                   /* All planes */
+};
+
+struct img_transformer_scaler_data_t {
+    std::string msg;
+    ScalerFilter filter{SCALER_FILTER_LANCZOS};
+    CpuLevel cpuLevel{cpu_level()};
+    int threadNum{0};
+    plugins_worker_pool pool;
+    std::vector<img_transformer_scaler_output_t> outputs;
+    std::vector<std::vector<int32_t> > rows; /* Intermediate row of each worker */
+    std::vector<std::vector<const uint16_t*> > taps; /* Input rows of vertical filter of each worker */
+    std::vector<uint16_t> scratch;           /* Outputs of in-place processing, input is read until the end */
+    plugins_buffer_pool frames;              /* Outputs of processTo */
+    size_t total{0};                         /* Samples of all outputs */
+
+    /* Input geometry the filters were built for */
+    int64_t width{0};
+    int64_t height{0};
+    ImgTransformerSubsampling subsampling{SUBSAMPLING_S444};
+};
+
+/* This structure can contain only pointers and simple types */
+struct img_transformer_scaler_t {
+    img_transformer_scaler_data_t* data;
+};
+
+static size_t img_transformer_scaler_get_size() {
+    return sizeof(img_transformer_scaler_t);
+}
+
+static bool parse_size(const std::string& value, size_t& width, size_t& height) {
+    size_t sep = value.find('x');
+    if (std::string::npos == sep || 0 == sep || sep + 1 == value.size())
+        return false;
+    if (value.find_first_not_of("0123456789x") != std::string::npos || value.find('x', sep + 1) != std::string::npos)
+        return false;
+    width = (size_t)std::atol(value.substr(0, sep).c_str());
+    height = (size_t)std::atol(value.substr(sep + 1).c_str());
+    return width > 0 && height > 0;
+}
+
+static Status img_transformer_scaler_init(ImgTransformerHandle handle, const ImgTransformerInitParams* init_params) {
+    img_transformer_scaler_t* state = (img_transformer_scaler_t*)handle;
+    state->data = new img_transformer_scaler_data_t;
+    auto invalidValue = [&](const std::string& option, const std::string& value, const std::string& expectedValues) {
+        return "Invalid '" + option + "' option value: '" + value + "'. Expected value: " + expectedValues + ".";
+    };
+    for (int i = 0; i < (int)init_params->count; i++) {
+        std::string name(init_params->properties[i].name);
+        std::string value(init_params->properties[i].value);
+        if (name == "output_size") {
+            img_transformer_scaler_output_t output;
+            if (!parse_size(value, output.width, output.height)) {
+                state->data->msg = invalidValue(name, value, "WIDTHxHEIGHT");
+                return STATUS_ERROR;
+            }
+            if ((int)state->data->outputs.size() == max_output_num) {
+                state->data->msg = "Too many 'output_size' options, at most " + std::to_string(max_output_num) +
+                                   " are supported.";
+                return STATUS_ERROR;
+            }
+            state->data->outputs.push_back(output);
+        }
+        else if (name == "filter") {
+            if (value == "lanczos")
+                state->data->filter = SCALER_FILTER_LANCZOS;
+            else if (value == "bicubic")
+                state->data->filter = SCALER_FILTER_BICUBIC;
+            else if (value == "bilinear")
+                state->data->filter = SCALER_FILTER_BILINEAR;
+            else {
+                state->data->msg = invalidValue(name, value, "lanczos:bicubic:bilinear");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "simd") {
+            if (!parse_cpu_level(value, state->data->cpuLevel)) {
+                state->data->msg = invalidValue(name, value, "auto:scalar:avx2:avx512");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "thread_num") {
+            state->data->threadNum = std::atoi(value.c_str());
+            if (state->data->threadNum < 0 || state->data->threadNum > 255) {
+                state->data->msg = invalidValue(name, value, "0:255");
+                return STATUS_ERROR;
+            }
+        }
+        else {
+            state->data->msg = "Could not recognise option '" + name + "'.";
+            return STATUS_ERROR;
+        }
+    }
+    if (state->data->outputs.empty()) {
+        state->data->msg = "Missing 'output_size' option.";
+        return STATUS_ERROR;
+    }
+
+    if (0 == state->data->threadNum)
+        state->data->threadNum = std::max(1, (int)std::thread::hardware_concurrency());
+    state->data->pool.start(state->data->threadNum);
+    state->data->rows.resize(state->data->threadNum);
+    state->data->taps.resize(state->data->threadNum);
+
+    state->data->msg = "SIMD: " + std::string(cpu_level_name(state->data->cpuLevel));
+    state->data->msg += "\nThreads: " + std::to_string(state->data->threadNum);
+    return STATUS_OK;
+}
+
+static Status img_transformer_scaler_close(ImgTransformerHandle handle) {
+    img_transformer_scaler_t* state = (img_transformer_scaler_t*)handle;
+    if (state && state->data) {
+        delete state->data;
+        state->data = nullptr;
+    }
+    return STATUS_OK;
+}
+
+static int input_bits(ImgTransformerBitdepth bitdepth) {
+    switch (bitdepth) {
+    case BIT_DEPTH_UINT10_LSB:
+        return 10;
+    case BIT_DEPTH_UINT12_LSB:
+        return 12;
+    case BIT_DEPTH_UINT14_LSB:
+        return 14;
+    case BIT_DEPTH_UINT16:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+/* Output rows are assigned to the band holding the middle of their filter window */
+static void assign_bands(const scaler_filter_t& vertical, size_t rowsPerBand, size_t bands,
+                         std::vector<size_t>& first) {
+    first.assign(bands + 1, vertical.size);
+    for (size_t i = vertical.size; i-- > 0;) {
+        size_t band = std::min((size_t)(vertical.start[i] + vertical.taps / 2) / rowsPerBand, bands - 1);
+        for (size_t k = 0; k <= band; k++)
+            first[k] = i;
+    }
+}
+
+/* Builds filters for new input geometry */
+static bool prepare(img_transformer_scaler_data_t* data, const ImgTransformerMetadata& metadata, int hsub, int vsub) {
+    const size_t width = (size_t)metadata.width;
+    const size_t height = (size_t)metadata.height;
+    const size_t bands = (height + band_rows - 1) / band_rows;
+    size_t total = 0;
+    for (size_t o = 0; o < data->outputs.size(); o++) {
+        img_transformer_scaler_output_t& output = data->outputs[o];
+        if (output.width > width || output.height > height || output.width % hsub || output.height % vsub) {
+            data->msg = "Output size " + std::to_string(output.width) + "x" + std::to_string(output.height) +
+                        " does not fit input " + std::to_string(width) + "x" + std::to_string(height) +
+                        " or its chroma subsampling.";
+            return false;
+        }
+        size_t chromaWidth = output.width / hsub;
+        size_t chromaHeight = output.height / vsub;
+        output.offset = total;
+        output.samples = output.width * output.height + 2 * chromaWidth * chromaHeight;
+        total += output.samples;
+
+        scaler_make_filter(data->filter, width, output.width, &output.horizontal[0]);
+        scaler_make_filter(data->filter, height, output.height, &output.vertical[0]);
+        scaler_make_filter(data->filter, (width + hsub - 1) / hsub, chromaWidth, &output.horizontal[1]);
+        scaler_make_filter(data->filter, (height + vsub - 1) / vsub, chromaHeight, &output.vertical[1]);
+        assign_bands(output.vertical[0], band_rows, bands, output.bandFirstRow[0]);
+        assign_bands(output.vertical[1], band_rows / vsub, bands, output.bandFirstRow[1]);
+        /* Downscaling by large factors needs hundreds of taps */
+        for (size_t w = 0; w < data->taps.size(); w++) {
+            for (int t = 0; t < 2; t++) {
+                if (data->taps[w].size() < (size_t)output.vertical[t].taps)
+                    data->taps[w].resize(output.vertical[t].taps);
+            }
+        }
+    }
+    data->total = total;
+    data->width = metadata.width;
+    data->height = metadata.height;
+    data->subsampling = metadata.subsampling;
+    return true;
+}
+
+/* Checks input and builds filters when its geometry changes. NULL 'size' skips the check of frame size. */
+static bool check_input(img_transformer_scaler_data_t* data, const ImgTransformerMetadata& metadata,
+                        const int64_t* size) {
+    int bits = input_bits(metadata.bitdepth);
+    if (PLANAR != metadata.arrangement || 0 == bits) {
+        data->msg = "Input must be planar with 10 to 16 bits per sample.";
+        return false;
+    }
+    const int hsub = SUBSAMPLING_S444 == metadata.subsampling ? 1 : 2;
+    const int vsub = SUBSAMPLING_S420 == metadata.subsampling ? 2 : 1;
+    const size_t width = (size_t)std::max<int64_t>(0, metadata.width);
+    const size_t height = (size_t)std::max<int64_t>(0, metadata.height);
+    const size_t chromaSize = ((width + hsub - 1) / hsub) * ((height + vsub - 1) / vsub);
+    const int64_t frameSize = (int64_t)((width * height + 2 * chromaSize) * sizeof(uint16_t));
+    if (0 == width || 0 == height || (size && *size < frameSize)) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return false;
+    }
+    if (metadata.width != data->width || metadata.height != data->height || metadata.subsampling != data->subsampling) {
+        data->width = 0;
+        if (!prepare(data, metadata, hsub, vsub))
+            return false;
+    }
+    return true;
+}
+
+/* Scales all outputs of checked input into 'out', which holds 'total' samples */
+static void scale(img_transformer_scaler_data_t* data, const ImgTransformerFrame* frame, uint16_t* out) {
+    const ImgTransformerMetadata& metadata = frame->metadata;
+    const int hsub = SUBSAMPLING_S444 == metadata.subsampling ? 1 : 2;
+    const int vsub = SUBSAMPLING_S420 == metadata.subsampling ? 2 : 1;
+    const size_t width = (size_t)metadata.width;
+    const size_t height = (size_t)metadata.height;
+    const size_t planeWidth[2] = {width, (width + hsub - 1) / hsub};
+    const size_t planeHeight[2] = {height, (height + vsub - 1) / vsub};
+
+    const uint16_t* input[3];
+    input[0] = (const uint16_t*)frame->data.buffer;
+    input[1] = input[0] + width * height;
+    input[2] = input[1] + planeWidth[1] * planeHeight[1];
+
+    const CpuLevel level = data->cpuLevel;
+    const uint32_t maxCode = (1u << input_bits(metadata.bitdepth)) - 1;
+    const size_t bands = (height + band_rows - 1) / band_rows;
+    std::atomic<size_t> next(0);
+    data->pool.run([&](unsigned worker) {
+        std::vector<int32_t>& row = data->rows[worker];
+        if (row.size() < width)
+            row.resize(width);
+        const uint16_t** taps = data->taps[worker].data();
+        for (size_t band = next++; band < bands; band = next++) {
+            for (size_t o = 0; o < data->outputs.size(); o++) {
+                const img_transformer_scaler_output_t& output = data->outputs[o];
+                uint16_t* plane = out + output.offset;
+                for (int p = 0; p < 3; p++) {
+                    const int t = p ? 1 : 0;
+                    const scaler_filter_t& vertical = output.vertical[t];
+                    const scaler_filter_t& horizontal = output.horizontal[t];
+                    for (size_t i = output.bandFirstRow[t][band]; i < output.bandFirstRow[t][band + 1]; i++) {
+                        for (int k = 0; k < vertical.taps; k++)
+                            taps[k] = input[p] + (vertical.start[i] + k) * planeWidth[t];
+                        scaler_vertical(level, taps, vertical.coeffs.data() + i, vertical.size, vertical.taps,
+                                        planeWidth[t], row.data());
+                        scaler_horizontal(level, row.data(), horizontal, maxCode, plane + i * horizontal.size);
+                    }
+                    plane += horizontal.size * vertical.size;
+                }
+            }
+        }
+    });
+}
+
+/* Metadata of first output, letterbox is scaled with the picture */
+static void output_metadata(const img_transformer_scaler_data_t* data, ImgTransformerMetadata& metadata) {
+    const img_transformer_scaler_output_t& first = data->outputs[0];
+    ImgTransformerLetterbox& letterbox = metadata.letterbox;
+    letterbox.top = letterbox.top * (int64_t)first.height / metadata.height;
+    letterbox.bottom = letterbox.bottom * (int64_t)first.height / metadata.height;
+    letterbox.left = letterbox.left * (int64_t)first.width / metadata.width;
+    letterbox.right = letterbox.right * (int64_t)first.width / metadata.width;
+    metadata.width = (int64_t)first.width;
+    metadata.height = (int64_t)first.height;
+}
+
+static Status img_transformer_scaler_process(ImgTransformerHandle handle, ImgTransformerFrame* frame) {
+    img_transformer_scaler_t* state = (img_transformer_scaler_t*)handle;
+    img_transformer_scaler_data_t* data = state->data;
+    data->msg.clear();
+
+    if (!check_input(data, frame->metadata, &frame->data.size))
+        return STATUS_ERROR;
+    const int64_t capacity = std::max(frame->data.size, frame->data.bufferSize);
+    if ((int64_t)(data->total * sizeof(uint16_t)) > capacity) {
+        data->msg = "All outputs together need " + std::to_string(data->total * sizeof(uint16_t)) +
+                    " bytes, frame buffer capacity is " + std::to_string(capacity) + ".";
+        return STATUS_ERROR;
+    }
+
+    /* Input is fully read, outputs replace it */
+    if (data->scratch.size() < data->total)
+        data->scratch.resize(data->total);
+    scale(data, frame, data->scratch.data());
+    memcpy(frame->data.buffer, data->scratch.data(), data->total * sizeof(uint16_t));
+
+    output_metadata(data, frame->metadata);
+    frame->data.size = (int64_t)(data->outputs[0].samples * sizeof(uint16_t));
+    return STATUS_OK;
+}
+
+/* Outputs are scaled straight into a buffer of the plugin, without the copy of in-place processing */
+static Status img_transformer_scaler_process_to(ImgTransformerHandle handle, const ImgTransformerFrame* inFrame,
+                                                ImgTransformerFrame* outFrame) {
+    img_transformer_scaler_t* state = (img_transformer_scaler_t*)handle;
+    img_transformer_scaler_data_t* data = state->data;
+    data->msg.clear();
+
+    if (!check_input(data, inFrame->metadata, &inFrame->data.size))
+        return STATUS_ERROR;
+    size_t capacity = 0;
+    uint8_t* buffer = data->frames.acquire(data->total * sizeof(uint16_t), capacity);
+    scale(data, inFrame, (uint16_t*)buffer);
+
+    outFrame->metadata = inFrame->metadata;
+    output_metadata(data, outFrame->metadata);
+    outFrame->data.buffer = buffer;
+    outFrame->data.size = (int64_t)(data->outputs[0].samples * sizeof(uint16_t));
+    outFrame->data.bufferSize = (int64_t)capacity;
+    return STATUS_OK;
+}
+
+static Status img_transformer_scaler_release(ImgTransformerHandle handle, ImgTransformerFrame* outFrame) {
+    img_transformer_scaler_t* state = (img_transformer_scaler_t*)handle;
+    if (!state->data->frames.release(outFrame->data.buffer)) {
+        state->data->msg = "Frame was not returned by this plugin or was already released.";
+        return STATUS_ERROR;
+    }
+    outFrame->data.buffer = NULL;
+    return STATUS_OK;
+}
+
+/* Reported size covers all outputs, which follow each other in the buffer */
+static Status img_transformer_scaler_get_output_size(ImgTransformerHandle handle,
+                                                     const ImgTransformerMetadata* inMetadata,
+                                                     ImgTransformerMetadata* outMetadata, int64_t* outSize) {
+    img_transformer_scaler_t* state = (img_transformer_scaler_t*)handle;
+    img_transformer_scaler_data_t* data = state->data;
+    data->msg.clear();
+
+    if (!check_input(data, *inMetadata, NULL))
+        return STATUS_ERROR;
+    *outMetadata = *inMetadata;
+    output_metadata(data, *outMetadata);
+    *outSize = (int64_t)(data->total * sizeof(uint16_t));
+    return STATUS_OK;
+}
+
+static const char* img_transformer_scaler_get_message(ImgTransformerHandle handle) {
+    img_transformer_scaler_t* state = (img_transformer_scaler_t*)handle;
+    if (state && state->data)
+        return state->data->msg.empty() ? NULL : state->data->msg.c_str();
+    else
+        return NULL;
+}
+
+static ImgTransformerApi img_transformer_scaler_plugin_api = {"scaler",
+                                                              img_transformer_scaler_get_info,
+                                                              img_transformer_scaler_get_size,
+                                                              img_transformer_scaler_init,
+                                                              img_transformer_scaler_close,
+                                                              img_transformer_scaler_process,
+                                                              img_transformer_scaler_get_message,
+                                                              img_transformer_scaler_get_output_size,
+                                                              img_transformer_scaler_process_to,
+                                                              img_transformer_scaler_release};
+
+DLB_EXPORT
+ImgTransformerApi* imgTransformerGetApi() {
+    return &img_transformer_scaler_plugin_api;
+}
+
+DLB_EXPORT
+int imgTransformerGetApiVersion(void) {
+    return IMG_TRANSFORMER_API_VERSION;
+}
@@ -0,0 +1,293 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_scaler_kernels.h"
+
+#include <algorithm>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static double filter_radius(ScalerFilter kind) {
+    switch (kind) {
+    case SCALER_FILTER_BILINEAR:
+        return 1.0;
+    case SCALER_FILTER_BICUBIC:
+        return 2.0;
+    default:
+        return 3.0;
+    }
+}
+
+static double sinc(double x) {
+    if (fabs(x) < 1e-9)
+        return 1.0;
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+static double filter_weight(ScalerFilter kind, double x) {
+    x = fabs(x);
+    switch (kind) {
+    case SCALER_FILTER_BILINEAR:
+        return x < 1.0 ? 1.0 - x : 0.0;
+    case SCALER_FILTER_BICUBIC:
+        /* Keys cubic with a = -0.5 */
+        if (x < 1.0)
+            return (1.5 * x - 2.5) * x * x + 1.0;
+        if (x < 2.0)
+            return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+        return 0.0;
+    default:
+        return x < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+    }
+}
+
+void scaler_make_filter(ScalerFilter kind, size_t inSize, size_t outSize, scaler_filter_t* filter) {
+    const double scale = (double)inSize / (double)outSize;
+    const double stretch = scale > 1.0 ? scale : 1.0;
+    const double support = filter_radius(kind) * stretch;
+    int taps = (int)ceil(2.0 * support) + 1;
+    if ((size_t)taps > inSize)
+        taps = (int)inSize;
+
+    filter->taps = taps;
+    filter->size = outSize;
+    filter->start.assign(outSize, 0);
+    filter->coeffs.assign(outSize * taps, 0);
+
+    std::vector<double> weights(taps);
+    for (size_t i = 0; i < outSize; i++) {
+        /* Sample centers are aligned, 'center' is in input sample coordinates */
+        double center = ((double)i + 0.5) * scale - 0.5;
+        long first = (long)floor(center - support) + 1;
+        long start = first < 0 ? 0 : first;
+        if (start > (long)inSize - taps)
+            start = (long)inSize - taps;
+        filter->start[i] = (int32_t)start;
+
+        std::fill(weights.begin(), weights.end(), 0.0);
+        double total = 0.0;
+        for (long j = first; j < first + taps; j++) {
+            double w = filter_weight(kind, ((double)j - center) / stretch);
+            long clamped = j < 0 ? 0 : (j >= (long)inSize ? (long)inSize - 1 : j);
+            weights[clamped - start] += w;
+            total += w;
+        }
+
+        /* Rounding error goes to the largest coefficient, so sum is exactly one */
+        int32_t sum = 0;
+        int largest = 0;
+        for (int k = 0; k < taps; k++) {
+            int32_t c = (int32_t)lround(weights[k] / total * (1 << SCALER_COEFF_BITS));
+            filter->coeffs[k * outSize + i] = c;
+            sum += c;
+            if (fabs(weights[k]) > fabs(weights[largest]))
+                largest = k;
+        }
+        filter->coeffs[largest * outSize + i] += (1 << SCALER_COEFF_BITS) - sum;
+    }
+}
+
+static inline int32_t round_coeff(int32_t v) {
+    return (v + (1 << (SCALER_COEFF_BITS - 1))) >> SCALER_COEFF_BITS;
+}
+
+static void vertical_scalar(const uint16_t* const rows[],
+                            const int32_t* coeffs,
+                            size_t stride,
+                            int taps,
+                            size_t first,
+                            size_t width,
+                            int32_t* dst) {
+    for (size_t x = first; x < width; x++) {
+        int32_t acc = 0;
+        for (int k = 0; k < taps; k++)
+            acc += coeffs[k * stride] * (int32_t)rows[k][x];
+        dst[x] = round_coeff(acc);
+    }
+}
+
+static void horizontal_scalar(const int32_t* src,
+                              const scaler_filter_t& filter,
+                              size_t first,
+                              uint32_t maxCode,
+                              uint16_t* dst) {
+    for (size_t i = first; i < filter.size; i++) {
+        const int32_t* in = src + filter.start[i];
+        int32_t acc = 0;
+        for (int k = 0; k < filter.taps; k++)
+            acc += filter.coeffs[k * filter.size + i] * in[k];
+        int32_t v = round_coeff(acc);
+        dst[i] = (uint16_t)(v < 0 ? 0 : ((uint32_t)v > maxCode ? maxCode : (uint32_t)v));
+    }
+}
+
+#if defined(DLB_X86)
+
+DLB_TARGET_AVX2
+static size_t vertical_avx2(const uint16_t* const rows[],
+                            const int32_t* coeffs,
+                            size_t stride,
+                            int taps,
+                            size_t width,
+                            int32_t* dst) {
+    const __m256i round = _mm256_set1_epi32(1 << (SCALER_COEFF_BITS - 1));
+    size_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i lo = round;
+        __m256i hi = round;
+        for (int k = 0; k < taps; k++) {
+            __m256i c = _mm256_set1_epi32(coeffs[k * stride]);
+            __m256i v = _mm256_loadu_si256((const __m256i*)(rows[k] + x));
+            lo = _mm256_add_epi32(lo, _mm256_mullo_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)), c));
+            __m256i upper = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1));
+            hi = _mm256_add_epi32(hi, _mm256_mullo_epi32(upper, c));
+        }
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm256_srai_epi32(lo, SCALER_COEFF_BITS));
+        _mm256_storeu_si256((__m256i*)(dst + x + 8), _mm256_srai_epi32(hi, SCALER_COEFF_BITS));
+    }
+    return x;
+}
+
+/* Input samples are gathered, 8 outputs per iteration */
+DLB_TARGET_AVX2
+static size_t horizontal_avx2(const int32_t* src, const scaler_filter_t& filter, uint32_t maxCode, uint16_t* dst) {
+    const __m256i round = _mm256_set1_epi32(1 << (SCALER_COEFF_BITS - 1));
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i top = _mm256_set1_epi32((int)maxCode);
+    const int32_t* coeffs = filter.coeffs.data();
+    size_t i = 0;
+    for (; i + 8 <= filter.size; i += 8) {
+        __m256i index = _mm256_loadu_si256((const __m256i*)(filter.start.data() + i));
+        __m256i acc = round;
+        for (int k = 0; k < filter.taps; k++) {
+            __m256i v = _mm256_i32gather_epi32((const int*)src, index, 4);
+            __m256i c = _mm256_loadu_si256((const __m256i*)(coeffs + k * filter.size + i));
+            acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(v, c));
+            index = _mm256_add_epi32(index, one);
+        }
+        __m256i v = _mm256_srai_epi32(acc, SCALER_COEFF_BITS);
+        v = _mm256_min_epi32(_mm256_max_epi32(v, _mm256_setzero_si256()), top);
+        v = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(v));
+    }
+    return i;
+}
+
+DLB_TARGET_AVX512
+static size_t vertical_avx512(const uint16_t* const rows[],
+                              const int32_t* coeffs,
+                              size_t stride,
+                              int taps,
+                              size_t width,
+                              int32_t* dst) {
+    const __m512i round = _mm512_set1_epi32(1 << (SCALER_COEFF_BITS - 1));
+    size_t x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m512i lo = round;
+        __m512i hi = round;
+        for (int k = 0; k < taps; k++) {
+            __m512i c = _mm512_set1_epi32(coeffs[k * stride]);
+            __m512i v = _mm512_loadu_si512(rows[k] + x);
+            lo = _mm512_add_epi32(lo, _mm512_mullo_epi32(_mm512_cvtepu16_epi32(_mm512_castsi512_si256(v)), c));
+            __m512i upper = _mm512_cvtepu16_epi32(_mm512_extracti64x4_epi64(v, 1));
+            hi = _mm512_add_epi32(hi, _mm512_mullo_epi32(upper, c));
+        }
+        _mm512_storeu_si512(dst + x, _mm512_srai_epi32(lo, SCALER_COEFF_BITS));
+        _mm512_storeu_si512(dst + x + 16, _mm512_srai_epi32(hi, SCALER_COEFF_BITS));
+    }
+    return x;
+}
+
+DLB_TARGET_AVX512
+static size_t horizontal_avx512(const int32_t* src, const scaler_filter_t& filter, uint32_t maxCode, uint16_t* dst) {
+    const __m512i round = _mm512_set1_epi32(1 << (SCALER_COEFF_BITS - 1));
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i top = _mm512_set1_epi32((int)maxCode);
+    const int32_t* coeffs = filter.coeffs.data();
+    size_t i = 0;
+    for (; i + 16 <= filter.size; i += 16) {
+        __m512i index = _mm512_loadu_si512(filter.start.data() + i);
+        __m512i acc = round;
+        for (int k = 0; k < filter.taps; k++) {
+            __m512i v = _mm512_i32gather_epi32(index, src, 4);
+            __m512i c = _mm512_loadu_si512(coeffs + k * filter.size + i);
+            acc = _mm512_add_epi32(acc, _mm512_mullo_epi32(v, c));
+            index = _mm512_add_epi32(index, one);
+        }
+        __m512i v = _mm512_srai_epi32(acc, SCALER_COEFF_BITS);
+        v = _mm512_min_epi32(_mm512_max_epi32(v, _mm512_setzero_si512()), top);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm512_cvtepi32_epi16(v));
+    }
+    return i;
+}
+
+#endif
+
+void scaler_vertical(CpuLevel level,
+                     const uint16_t* const rows[],
+                     const int32_t* coeffs,
+                     size_t stride,
+                     int taps,
+                     size_t width,
+                     int32_t* dst) {
+    size_t done = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        done = vertical_avx512(rows, coeffs, stride, taps, width, dst);
+    else if (level >= CPU_LEVEL_AVX2)
+        done = vertical_avx2(rows, coeffs, stride, taps, width, dst);
+#else
+    (void)level;
+#endif
+    vertical_scalar(rows, coeffs, stride, taps, done, width, dst);
+}
+
+void scaler_horizontal(CpuLevel level,
+                       const int32_t* src,
+                       const scaler_filter_t& filter,
+                       uint32_t maxCode,
+                       uint16_t* dst) {
+    size_t done = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        done = horizontal_avx512(src, filter, maxCode, dst);
+    else if (level >= CPU_LEVEL_AVX2)
+        done = horizontal_avx2(src, filter, maxCode, dst);
+#else
+    (void)level;
+#endif
+    horizontal_scalar(src, filter, done, maxCode, dst);
+}
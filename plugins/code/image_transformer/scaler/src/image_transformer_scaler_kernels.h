@@ -0,0 +1,89 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_IMAGE_TRANSFORMER_SCALER_KERNELS_H__
+#define __DEE_PLUGINS_IMAGE_TRANSFORMER_SCALER_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "plugins_cpu.h"
+
+/* Filter coefficients are fixed-point with this many fraction bits */
+#define SCALER_COEFF_BITS 14
+
+typedef enum {
+    SCALER_FILTER_BILINEAR = 0,
+    SCALER_FILTER_BICUBIC,
+    SCALER_FILTER_LANCZOS,
+} ScalerFilter;
+
+/** @brief Polyphase filter of one axis
+ *  Every output sample is a weighted sum of 'taps' consecutive input samples
+ *  starting at 'start'. Samples outside the image are folded into the edge
+ *  samples when the table is built, so kernels need no bounds checks.
+ */
+typedef struct {
+    int taps;
+    size_t size;                 /* Number of output samples */
+    std::vector<int32_t> start;  /* First input sample of each output sample */
+    std::vector<int32_t> coeffs; /* Tap-major: coefficient k of output i is coeffs[k * size + i] */
+} scaler_filter_t;
+
+/** @brief Builds filter resampling 'inSize' samples to 'outSize'
+ *  Filter is widened by the scale factor when downscaling, so it also acts as
+ *  anti-aliasing filter. Coefficients of each output sample sum to exactly 1.
+ */
+void scaler_make_filter(ScalerFilter kind, size_t inSize, size_t outSize, scaler_filter_t* filter);
+
+/** @brief Filters 'taps' input rows into one intermediate row
+ *  Result is rounded to input precision and may be negative or exceed input range.
+ */
+void scaler_vertical(CpuLevel level,
+                     const uint16_t* const rows[], /**< [in] 'taps' input rows */
+                     const int32_t* coeffs,        /**< [in] Coefficient k at coeffs[k * stride] */
+                     size_t stride,                /**< [in] Distance between coefficients */
+                     int taps,                     /**< [in] Number of rows */
+                     size_t width,                 /**< [in] Samples per row */
+                     int32_t* dst                  /**< [out] Intermediate row */
+);
+
+/** @brief Filters intermediate row horizontally into output samples clamped to 0 - 'maxCode' */
+void scaler_horizontal(CpuLevel level,
+                       const int32_t* src,            /**< [in] Intermediate row */
+                       const scaler_filter_t& filter, /**< [in] Horizontal filter */
+                       uint32_t maxCode,              /**< [in] Largest output value */
+                       uint16_t* dst                  /**< [out] 'filter.size' samples */
+);
+
+#endif // __DEE_PLUGINS_IMAGE_TRANSFORMER_SCALER_KERNELS_H__
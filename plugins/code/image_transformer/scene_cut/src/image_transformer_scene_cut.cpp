@@ -0,0 +1,430 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_api.h"
+#include "image_transformer_scene_cut_kernels.h"
+#include "plugins_threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const PropertyInfo img_transformer_info[] = {
+    {"output_file", PROPERTY_TYPE_STRING,
+     "File receiving one line per frame: frame number, scene cut flag (0 or 1), intra and inter complexity as mean "
+     "absolute differences of 8-bit samples, and histogram difference. Lines starting with '#' are comments.",
+     NULL, NULL, 0, 1, ACCESS_TYPE_USER},
+    {"reference_file", PROPERTY_TYPE_STRING,
+     "Scene cuts to compare detection with, e.g. from a full encode. Either x265 frame CSV log, where I slices are "
+     "taken as cuts, or one frame number per line. Result is reported in messages and in 'output_file'.",
+     NULL, NULL, 0, 1, ACCESS_TYPE_USER},
+    {"threshold", PROPERTY_TYPE_INTEGER,
+     "Smallest histogram difference of a scene cut, in percent of samples which changed their histogram bin.", "30",
+     "1:100", 0, 1, ACCESS_TYPE_USER},
+    {"sad_ratio", PROPERTY_TYPE_DECIMAL,
+     "Inter complexity of a scene cut must be this many times the average of previous frames of the scene. Keeps "
+     "gradual changes and steady motion from being detected.",
+     "2.0", "1:20", 0, 1, ACCESS_TYPE_USER},
+    {"min_gap", PROPERTY_TYPE_INTEGER, "Smallest number of frames between scene cuts.", "4", "1:1000", 0, 1,
+     ACCESS_TYPE_USER},
+    {"simd", PROPERTY_TYPE_STRING, "Instruction set used by analysis kernels, limited to what the CPU supports.",
+     "auto", "auto:scalar:avx2:avx512", 0, 1, ACCESS_TYPE_USER},
+    {"thread_num", PROPERTY_TYPE_INTEGER, "Number of threads downscaling bands of rows (0 = number of logical CPUs).",
+     "0", "0:255", 0, 1, ACCESS_TYPE_USER},
+};
+
+static size_t img_transformer_scene_cut_get_info(const PropertyInfo** info) {
+    *info = img_transformer_info;
+    return sizeof(img_transformer_info) / sizeof(PropertyInfo);
+}
+
+/* Downscaled rows per job */
+static const size_t band_rows = 16;
+
+/* Histogram of downscaled luma */
+static const int histogram_bins = 64;
+
+struct img_transformer_scene_cut_data_t {
+    std::string msg;
+    std::string outputFile;
+    std::ofstream output;
+    int threshold{30};
+    double sadRatio{2.0};
+    int64_t minGap{4};
+    CpuLevel cpuLevel{cpu_level()};
+    int threadNum{0};
+    plugins_worker_pool pool;
+
+    /* Luma downscaled by 4 in both directions, previous frame is kept for comparison */
+    size_t width{0};
+    size_t height{0};
+    std::vector<uint8_t> current;
+    std::vector<uint8_t> previous;
+    std::vector<uint32_t> histogram;
+    std::vector<uint32_t> previousHistogram;
+
+    int64_t frames{0};
+    int64_t lastCut{0};
+    double averageInter{0}; /* Over frames of current scene */
+    int64_t sceneFrames{0};
+
+    std::vector<int64_t> reference; /* Sorted frame numbers */
+    int64_t detected{0};
+    int64_t matched{0};
+};
+
+/* This structure can contain only pointers and simple types */
+struct img_transformer_scene_cut_t {
+    img_transformer_scene_cut_data_t* data;
+};
+
+static size_t img_transformer_scene_cut_get_size() {
+    return sizeof(img_transformer_scene_cut_t);
+}
+
+/* Reads x265 CSV log or list of frame numbers. First frame is not a cut, it starts the stream. */
+static bool read_reference(const std::string& path, std::vector<int64_t>& cuts) {
+    std::ifstream file(path.c_str());
+    if (!file.good())
+        return false;
+    std::string line;
+    int typeColumn = -1;
+    int pocColumn = -1;
+    while (std::getline(file, line)) {
+        if (line.empty() || '#' == line[0])
+            continue;
+        if (std::string::npos == line.find(',')) {
+            char* end = NULL;
+            long long frame = std::strtoll(line.c_str(), &end, 10);
+            if (end != line.c_str() && frame > 0)
+                cuts.push_back(frame);
+            continue;
+        }
+        std::vector<std::string> columns;
+        std::stringstream stream(line);
+        std::string column;
+        while (std::getline(stream, column, ',')) {
+            size_t start = column.find_first_not_of(' ');
+            columns.push_back(std::string::npos == start ? std::string() : column.substr(start));
+        }
+        if (typeColumn < 0) {
+            for (size_t c = 0; c < columns.size(); c++) {
+                if (columns[c] == "Type")
+                    typeColumn = (int)c;
+                else if (columns[c] == "POC")
+                    pocColumn = (int)c;
+            }
+            if (typeColumn < 0 || pocColumn < 0)
+                return false;
+            continue;
+        }
+        if ((int)columns.size() > std::max(typeColumn, pocColumn) &&
+            std::string::npos != columns[typeColumn].find("I-SLICE")) {
+            long long frame = std::atoll(columns[pocColumn].c_str());
+            if (frame > 0)
+                cuts.push_back(frame);
+        }
+    }
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+    return true;
+}
+
+static Status img_transformer_scene_cut_init(ImgTransformerHandle handle, const ImgTransformerInitParams* init_params) {
+    img_transformer_scene_cut_t* state = (img_transformer_scene_cut_t*)handle;
+    state->data = new img_transformer_scene_cut_data_t;
+    auto invalidValue = [&](const std::string& option, const std::string& value, const std::string& expectedValues) {
+        return "Invalid '" + option + "' option value: '" + value + "'. Expected value: " + expectedValues + ".";
+    };
+    for (int i = 0; i < (int)init_params->count; i++) {
+        std::string name(init_params->properties[i].name);
+        std::string value(init_params->properties[i].value);
+        if (name == "output_file") {
+            state->data->outputFile = value;
+        }
+        else if (name == "reference_file") {
+            if (!read_reference(value, state->data->reference)) {
+                state->data->msg = "Could not read reference file '" + value + "'.";
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "threshold") {
+            state->data->threshold = std::atoi(value.c_str());
+            if (state->data->threshold < 1 || state->data->threshold > 100) {
+                state->data->msg = invalidValue(name, value, "1:100");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "sad_ratio") {
+            state->data->sadRatio = std::atof(value.c_str());
+            if (state->data->sadRatio < 1.0 || state->data->sadRatio > 20.0) {
+                state->data->msg = invalidValue(name, value, "1:20");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "min_gap") {
+            state->data->minGap = std::atoi(value.c_str());
+            if (state->data->minGap < 1 || state->data->minGap > 1000) {
+                state->data->msg = invalidValue(name, value, "1:1000");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "simd") {
+            if (!parse_cpu_level(value, state->data->cpuLevel)) {
+                state->data->msg = invalidValue(name, value, "auto:scalar:avx2:avx512");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "thread_num") {
+            state->data->threadNum = std::atoi(value.c_str());
+            if (state->data->threadNum < 0 || state->data->threadNum > 255) {
+                state->data->msg = invalidValue(name, value, "0:255");
+                return STATUS_ERROR;
+            }
+        }
+        else {
+            state->data->msg = "Could not recognise option '" + name + "'.";
+            return STATUS_ERROR;
+        }
+    }
+
+    if (!state->data->outputFile.empty()) {
+        state->data->output.open(state->data->outputFile.c_str());
+        if (!state->data->output.good()) {
+            state->data->msg = "Could not open output file '" + state->data->outputFile + "'.";
+            return STATUS_ERROR;
+        }
+        state->data->output << "# frame scene_cut intra inter histogram\n";
+    }
+
+    if (0 == state->data->threadNum)
+        state->data->threadNum = std::max(1, (int)std::thread::hardware_concurrency());
+    state->data->pool.start(state->data->threadNum);
+
+    state->data->msg = "SIMD: " + std::string(cpu_level_name(state->data->cpuLevel));
+    state->data->msg += "\nThreads: " + std::to_string(state->data->threadNum);
+    return STATUS_OK;
+}
+
+static std::string reference_summary(const img_transformer_scene_cut_data_t* data) {
+    return "Reference cuts: " + std::to_string(data->reference.size()) + ", detected: " +
+           std::to_string(data->detected) + ", matched: " + std::to_string(data->matched) + ".";
+}
+
+static Status img_transformer_scene_cut_close(ImgTransformerHandle handle) {
+    img_transformer_scene_cut_t* state = (img_transformer_scene_cut_t*)handle;
+    Status status = STATUS_OK;
+    if (state && state->data) {
+        if (state->data->output.is_open()) {
+            if (!state->data->reference.empty())
+                state->data->output << "# " << reference_summary(state->data) << "\n";
+            state->data->output.close();
+            if (state->data->output.fail())
+                status = STATUS_ERROR;
+        }
+        delete state->data;
+        state->data = nullptr;
+    }
+    return status;
+}
+
+static int input_bits(ImgTransformerBitdepth bitdepth) {
+    switch (bitdepth) {
+    case BIT_DEPTH_UINT10_LSB:
+        return 10;
+    case BIT_DEPTH_UINT12_LSB:
+        return 12;
+    case BIT_DEPTH_UINT14_LSB:
+        return 14;
+    case BIT_DEPTH_UINT16:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+static Status img_transformer_scene_cut_process(ImgTransformerHandle handle, ImgTransformerFrame* frame) {
+    img_transformer_scene_cut_t* state = (img_transformer_scene_cut_t*)handle;
+    img_transformer_scene_cut_data_t* data = state->data;
+    const ImgTransformerMetadata& metadata = frame->metadata;
+    data->msg.clear();
+
+    int bits = input_bits(metadata.bitdepth);
+    if (PLANAR != metadata.arrangement || 0 == bits) {
+        data->msg = "Input must be planar with 10 to 16 bits per sample.";
+        return STATUS_ERROR;
+    }
+    const size_t width = (size_t)metadata.width;
+    const size_t height = (size_t)metadata.height;
+    if (metadata.width <= 0 || metadata.height <= 0 ||
+        frame->data.size < (int64_t)(width * height * sizeof(uint16_t))) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return STATUS_ERROR;
+    }
+
+    /* Only the picture inside bars is analysed, so changing bars do not look like cuts */
+    const ImgTransformerLetterbox& bars = metadata.letterbox;
+    const size_t top = (size_t)std::max<int64_t>(0, bars.top);
+    const size_t left = (size_t)std::max<int64_t>(0, bars.left);
+    const size_t bottom = (size_t)std::max<int64_t>(0, bars.bottom);
+    const size_t right = (size_t)std::max<int64_t>(0, bars.right);
+    if (top + bottom + 4 > height || left + right + 4 > width) {
+        data->msg = "Picture inside letterbox is smaller than 4x4.";
+        return STATUS_ERROR;
+    }
+    const size_t smallWidth = (width - left - right) / 4;
+    const size_t smallHeight = (height - top - bottom) / 4;
+    const size_t count = smallWidth * smallHeight;
+    if (smallWidth != data->width || smallHeight != data->height) {
+        /* Frames of other size can not be compared, analysis starts again */
+        data->width = smallWidth;
+        data->height = smallHeight;
+        data->current.assign(count, 0);
+        data->previous.assign(count, 0);
+        data->sceneFrames = 0;
+    }
+
+    const uint16_t* luma = (const uint16_t*)frame->data.buffer + top * width + left;
+    const CpuLevel level = data->cpuLevel;
+    const size_t bands = (smallHeight + band_rows - 1) / band_rows;
+    std::atomic<size_t> next(0);
+    data->pool.run([&](unsigned) {
+        for (size_t band = next++; band < bands; band = next++) {
+            size_t last = std::min(smallHeight, (band + 1) * band_rows);
+            for (size_t y = band * band_rows; y < last; y++) {
+                const uint16_t* rows[4];
+                for (int k = 0; k < 4; k++)
+                    rows[k] = luma + (4 * y + k) * width;
+                scene_cut_downscale(level, rows, smallWidth, bits - 8, data->current.data() + y * smallWidth);
+            }
+        }
+    });
+
+    /* Intra complexity is the mean difference of neighbouring samples */
+    const uint8_t* small = data->current.data();
+    uint64_t gradient = 0;
+    for (size_t y = 0; y < smallHeight; y++) {
+        const uint8_t* row = small + y * smallWidth;
+        gradient += scene_cut_sad(level, row, row + 1, smallWidth - 1);
+        if (y + 1 < smallHeight)
+            gradient += scene_cut_sad(level, row, row + smallWidth, smallWidth);
+    }
+    const size_t pairs = smallHeight * (smallWidth - 1) + (smallHeight - 1) * smallWidth;
+    const double intra = pairs ? (double)gradient / (double)pairs : 0.0;
+
+    data->histogram.assign(histogram_bins, 0);
+    for (size_t i = 0; i < count; i++)
+        data->histogram[small[i] >> 2]++;
+
+    double inter = 0;
+    double histogram = 0;
+    bool cut = 0 == data->sceneFrames;
+    if (data->sceneFrames > 0) {
+        inter = (double)scene_cut_sad(level, small, data->previous.data(), count) / (double)count;
+        uint64_t changed = 0;
+        for (int b = 0; b < histogram_bins; b++)
+            changed += (uint64_t)std::abs((int64_t)data->histogram[b] - (int64_t)data->previousHistogram[b]);
+        histogram = (double)changed / (2.0 * (double)count);
+        cut = data->frames - data->lastCut >= data->minGap && histogram * 100.0 >= data->threshold &&
+              inter >= data->sadRatio * std::max(data->averageInter, 1.0);
+    }
+    if (cut) {
+        data->lastCut = data->frames;
+        data->averageInter = 0;
+        data->sceneFrames = 0;
+        if (data->frames > 0) {
+            data->detected++;
+            if (std::binary_search(data->reference.begin(), data->reference.end(), data->frames))
+                data->matched++;
+        }
+    }
+    else
+        data->averageInter = (data->averageInter * (double)(data->sceneFrames - 1) + inter) / (double)data->sceneFrames;
+    data->sceneFrames++;
+
+    if (data->output.is_open()) {
+        char line[128];
+        snprintf(line, sizeof(line), "%lld %d %.2f %.2f %.3f\n", (long long)data->frames, cut ? 1 : 0, intra, inter,
+                 histogram);
+        data->output << line;
+        if (!data->output.good()) {
+            data->msg = "Could not write output file '" + data->outputFile + "'.";
+            return STATUS_ERROR;
+        }
+    }
+
+    char numbers[96];
+    snprintf(numbers, sizeof(numbers), "intra: %.2f, inter: %.2f, histogram difference: %.3f.", intra, inter,
+             histogram);
+    data->msg = "Frame " + std::to_string(data->frames) + (cut ? " starts a scene, " : " ") + numbers;
+    if (!data->reference.empty())
+        data->msg += " " + reference_summary(data);
+
+    data->previous.swap(data->current);
+    data->previousHistogram.swap(data->histogram);
+    data->frames++;
+    return STATUS_OK;
+}
+
+static const char* img_transformer_scene_cut_get_message(ImgTransformerHandle handle) {
+    img_transformer_scene_cut_t* state = (img_transformer_scene_cut_t*)handle;
+    if (state && state->data)
+        return state->data->msg.empty() ? NULL : state->data->msg.c_str();
+    else
+        return NULL;
+}
+
+static ImgTransformerApi img_transformer_scene_cut_plugin_api = {"scene_cut",
+                                                                 img_transformer_scene_cut_get_info,
+                                                                 img_transformer_scene_cut_get_size,
+                                                                 img_transformer_scene_cut_init,
+                                                                 img_transformer_scene_cut_close,
+                                                                 img_transformer_scene_cut_process,
+                                                                 img_transformer_scene_cut_get_message,
+                                                                 NULL,
+                                                                 NULL,
+                                                                 NULL};
+
+DLB_EXPORT
+ImgTransformerApi* imgTransformerGetApi() {
+    return &img_transformer_scene_cut_plugin_api;
+}
+
+DLB_EXPORT
+int imgTransformerGetApiVersion(void) {
+    return IMG_TRANSFORMER_API_VERSION;
+}
@@ -0,0 +1,155 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_scene_cut_kernels.h"
+
+#include <string.h>
+
+static inline uint32_t average(uint32_t a, uint32_t b) {
+    return (a + b + 1) >> 1;
+}
+
+static void downscale_scalar(const uint16_t* const src[4], size_t first, size_t width, int shift, uint8_t* dst) {
+    for (size_t i = first; i < width; i++) {
+        uint32_t sum = 0;
+        for (size_t x = 4 * i; x < 4 * i + 4; x++)
+            sum += average(average(src[0][x], src[1][x]), average(src[2][x], src[3][x])) >> shift;
+        dst[i] = (uint8_t)((sum + 2) >> 2);
+    }
+}
+
+static uint64_t sad_scalar(const uint8_t* a, const uint8_t* b, size_t first, size_t count) {
+    uint64_t sum = 0;
+    for (size_t i = first; i < count; i++)
+        sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    return sum;
+}
+
+#if defined(DLB_X86)
+
+/* 16 input samples give 4 outputs */
+DLB_TARGET_AVX2
+static size_t downscale_avx2(const uint16_t* const src[4], size_t width, int shift, uint8_t* dst) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m256i bytes = _mm256_setr_epi8(0, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 8, -1, -1,
+                                           -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 4 <= width; i += 4) {
+        const size_t x = 4 * i;
+        __m256i a = _mm256_avg_epu16(_mm256_loadu_si256((const __m256i*)(src[0] + x)),
+                                     _mm256_loadu_si256((const __m256i*)(src[1] + x)));
+        __m256i b = _mm256_avg_epu16(_mm256_loadu_si256((const __m256i*)(src[2] + x)),
+                                     _mm256_loadu_si256((const __m256i*)(src[3] + x)));
+        __m256i v = _mm256_srl_epi16(_mm256_avg_epu16(a, b), count);
+        /* Pairs, then quads in the low half of every 64 bits */
+        __m256i p = _mm256_madd_epi16(v, ones);
+        __m256i q = _mm256_add_epi32(p, _mm256_srli_epi64(p, 32));
+        q = _mm256_shuffle_epi8(_mm256_srli_epi32(_mm256_add_epi32(q, two), 2), bytes);
+        uint32_t out = (uint32_t)_mm256_extract_epi16(q, 0) | ((uint32_t)_mm256_extract_epi16(q, 8) << 16);
+        memcpy(dst + i, &out, sizeof(out));
+    }
+    return i;
+}
+
+DLB_TARGET_AVX2
+static size_t sad_avx2(const uint8_t* a, const uint8_t* b, size_t count, uint64_t& sum) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32)
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                                    _mm256_loadu_si256((const __m256i*)(b + i))));
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    s = _mm_add_epi64(s, _mm_unpackhi_epi64(s, s));
+    sum += (uint64_t)_mm_cvtsi128_si64(s);
+    return i;
+}
+
+/* 32 input samples give 8 outputs */
+DLB_TARGET_AVX512
+static size_t downscale_avx512(const uint16_t* const src[4], size_t width, int shift, uint8_t* dst) {
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m512i ones = _mm512_set1_epi16(1);
+    const __m512i two = _mm512_set1_epi32(2);
+    size_t i = 0;
+    for (; i + 8 <= width; i += 8) {
+        const size_t x = 4 * i;
+        __m512i a = _mm512_avg_epu16(_mm512_loadu_si512(src[0] + x), _mm512_loadu_si512(src[1] + x));
+        __m512i b = _mm512_avg_epu16(_mm512_loadu_si512(src[2] + x), _mm512_loadu_si512(src[3] + x));
+        __m512i v = _mm512_srl_epi16(_mm512_avg_epu16(a, b), count);
+        __m512i p = _mm512_madd_epi16(v, ones);
+        __m512i q = _mm512_add_epi32(p, _mm512_srli_epi64(p, 32));
+        q = _mm512_srli_epi32(_mm512_add_epi32(q, two), 2);
+        _mm_storel_epi64((__m128i*)(dst + i), _mm512_cvtepi64_epi8(q));
+    }
+    return i;
+}
+
+DLB_TARGET_AVX512
+static size_t sad_avx512(const uint8_t* a, const uint8_t* b, size_t count, uint64_t& sum) {
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64)
+        acc = _mm512_add_epi64(acc, _mm512_sad_epu8(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)));
+    sum += (uint64_t)_mm512_reduce_add_epi64(acc);
+    return i;
+}
+
+#endif
+
+void scene_cut_downscale(CpuLevel level, const uint16_t* const src[4], size_t width, int shift, uint8_t* dst) {
+    size_t done = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        done = downscale_avx512(src, width, shift, dst);
+    else if (level >= CPU_LEVEL_AVX2)
+        done = downscale_avx2(src, width, shift, dst);
+#else
+    (void)level;
+#endif
+    downscale_scalar(src, done, width, shift, dst);
+}
+
+uint64_t scene_cut_sad(CpuLevel level, const uint8_t* a, const uint8_t* b, size_t count) {
+    size_t done = 0;
+    uint64_t sum = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        done = sad_avx512(a, b, count, sum);
+    else if (level >= CPU_LEVEL_AVX2)
+        done = sad_avx2(a, b, count, sum);
+#else
+    (void)level;
+#endif
+    return sum + sad_scalar(a, b, done, count);
+}
@@ -0,0 +1,59 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_IMAGE_TRANSFORMER_SCENE_CUT_KERNELS_H__
+#define __DEE_PLUGINS_IMAGE_TRANSFORMER_SCENE_CUT_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "plugins_cpu.h"
+
+/** @brief Downscales four rows by four into 8-bit samples
+ *  Rows are averaged pairwise with rounding, reduced to 8 bits and then four
+ *  neighbouring samples are averaged with rounding, so all kernels give the same result.
+ */
+void scene_cut_downscale(CpuLevel level,
+                         const uint16_t* const src[4], /**< [in] Four rows of at least 4 * 'width' samples */
+                         size_t width,                 /**< [in] Number of output samples */
+                         int shift,                    /**< [in] Bits per input sample minus 8 */
+                         uint8_t* dst                  /**< [out] 'width' samples */
+);
+
+/** @brief Sum of absolute differences of two rows of 8-bit samples */
+uint64_t scene_cut_sad(CpuLevel level,
+                       const uint8_t* a, /**< [in] First row */
+                       const uint8_t* b, /**< [in] Second row */
+                       size_t count      /**< [in] Number of samples */
+);
+
+#endif // __DEE_PLUGINS_IMAGE_TRANSFORMER_SCENE_CUT_KERNELS_H__
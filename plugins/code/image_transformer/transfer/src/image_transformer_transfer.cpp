@@ -0,0 +1,535 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_api.h"
+#include "image_transformer_transfer_kernels.h"
+#include "plugins_threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const PropertyInfo img_transformer_info[] = {
+    {"eotf", PROPERTY_TYPE_STRING, "Transfer function of output. Input transfer function is taken from frame metadata.",
+     NULL, "pq:hlg:bt1886:rec709", 1, 1, ACCESS_TYPE_USER},
+    {"primaries", PROPERTY_TYPE_STRING,
+     "Primaries of output. Conversion is done in linear light, in the same pass as the transfer functions.", "keep",
+     "keep:bt709:bt2020:p3d65", 0, 1, ACCESS_TYPE_USER},
+    {"tone_map", PROPERTY_TYPE_STRING,
+     "Mapping of light levels above the output peak. 'bt2390' rolls highlights off with the BT.2390 EETF, applied "
+     "to each channel.",
+     "bt2390", "bt2390:clip", 0, 1, ACCESS_TYPE_USER},
+    {"source_peak", PROPERTY_TYPE_INTEGER, "Peak luminance of PQ input in cd/m2, usually of the mastering display.",
+     "1000", "100:10000", 0, 1, ACCESS_TYPE_USER},
+    {"hlg_peak", PROPERTY_TYPE_INTEGER, "Nominal peak luminance of HLG display in cd/m2.", "1000", "100:10000", 0, 1,
+     ACCESS_TYPE_USER},
+    {"sdr_peak", PROPERTY_TYPE_INTEGER, "Peak luminance of BT.1886 and Rec. 709 display in cd/m2.", "100", "48:1000",
+     0, 1, ACCESS_TYPE_USER},
+    {"simd", PROPERTY_TYPE_STRING, "Instruction set used by conversion kernels, limited to what the CPU supports.",
+     "auto", "auto:scalar:avx2:avx512", 0, 1, ACCESS_TYPE_USER},
+    {"thread_num", PROPERTY_TYPE_INTEGER, "Number of threads converting bands of rows (0 = number of logical CPUs).",
+     "0", "0:255", 0, 1, ACCESS_TYPE_USER},
+};
+
+static size_t img_transformer_transfer_get_info(const PropertyInfo** info) {
+    *info = img_transformer_info;
+    return sizeof(img_transformer_info) / sizeof(PropertyInfo);
+}
+
+/* Rows per job */
+static const size_t band_rows = 16;
+
+struct img_transformer_transfer_data_t {
+    std::string msg;
+    ImgTransformerEotf eotf{EOTF_UNKNOWN};
+    ImgTransformerChroma primaries{CHROMA_UNKNOWN}; /* Unknown keeps input primaries */
+    bool toneMap{true};
+    double sourcePeak{1000};
+    double hlgPeak{1000};
+    double sdrPeak{100};
+    CpuLevel cpuLevel{cpu_level()};
+    int threadNum{0};
+    plugins_worker_pool pool;
+
+    /* Tables of the last input format */
+    bool matrix{false};
+    std::vector<uint16_t> lut; /* Code to code, used when primaries do not change */
+    transfer_tables_t tables;
+    ImgTransformerEotf tablesEotf{EOTF_UNKNOWN};
+    ImgTransformerChroma tablesChroma{CHROMA_UNKNOWN};
+    ImgTransformerBitdepth tablesBitdepth{BIT_DEPTH_UNKNOWN};
+    ImgTransformerRange tablesRange{RANGE_UNKNOWN};
+};
+
+/* This structure can contain only pointers and simple types */
+struct img_transformer_transfer_t {
+    img_transformer_transfer_data_t* data;
+};
+
+static size_t img_transformer_transfer_get_size() {
+    return sizeof(img_transformer_transfer_t);
+}
+
+static Status img_transformer_transfer_init(ImgTransformerHandle handle, const ImgTransformerInitParams* init_params) {
+    img_transformer_transfer_t* state = (img_transformer_transfer_t*)handle;
+    state->data = new img_transformer_transfer_data_t;
+    auto invalidValue = [&](const std::string& option, const std::string& value, const std::string& expectedValues) {
+        return "Invalid '" + option + "' option value: '" + value + "'. Expected value: " + expectedValues + ".";
+    };
+    auto parsePeak = [&](const std::string& name, const std::string& value, int min, int max, double& peak) {
+        int v = std::atoi(value.c_str());
+        if (v < min || v > max) {
+            state->data->msg = invalidValue(name, value, std::to_string(min) + ":" + std::to_string(max));
+            return false;
+        }
+        peak = v;
+        return true;
+    };
+    for (int i = 0; i < (int)init_params->count; i++) {
+        std::string name(init_params->properties[i].name);
+        std::string value(init_params->properties[i].value);
+        if (name == "eotf") {
+            if (value == "pq")
+                state->data->eotf = EOTF_PQ;
+            else if (value == "hlg")
+                state->data->eotf = EOTF_HLG;
+            else if (value == "bt1886")
+                state->data->eotf = EOTF_BT1886;
+            else if (value == "rec709")
+                state->data->eotf = EOTF_REC709;
+            else {
+                state->data->msg = invalidValue(name, value, "pq:hlg:bt1886:rec709");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "primaries") {
+            if (value == "keep")
+                state->data->primaries = CHROMA_UNKNOWN;
+            else if (value == "bt709")
+                state->data->primaries = CHROMA_REC709;
+            else if (value == "bt2020")
+                state->data->primaries = CHROMA_REC2020;
+            else if (value == "p3d65")
+                state->data->primaries = CHROMA_P3D65;
+            else {
+                state->data->msg = invalidValue(name, value, "keep:bt709:bt2020:p3d65");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "tone_map") {
+            if (value != "bt2390" && value != "clip") {
+                state->data->msg = invalidValue(name, value, "bt2390:clip");
+                return STATUS_ERROR;
+            }
+            state->data->toneMap = value == "bt2390";
+        }
+        else if (name == "source_peak") {
+            if (!parsePeak(name, value, 100, 10000, state->data->sourcePeak))
+                return STATUS_ERROR;
+        }
+        else if (name == "hlg_peak") {
+            if (!parsePeak(name, value, 100, 10000, state->data->hlgPeak))
+                return STATUS_ERROR;
+        }
+        else if (name == "sdr_peak") {
+            if (!parsePeak(name, value, 48, 1000, state->data->sdrPeak))
+                return STATUS_ERROR;
+        }
+        else if (name == "simd") {
+            if (!parse_cpu_level(value, state->data->cpuLevel)) {
+                state->data->msg = invalidValue(name, value, "auto:scalar:avx2:avx512");
+                return STATUS_ERROR;
+            }
+        }
+        else if (name == "thread_num") {
+            state->data->threadNum = std::atoi(value.c_str());
+            if (state->data->threadNum < 0 || state->data->threadNum > 255) {
+                state->data->msg = invalidValue(name, value, "0:255");
+                return STATUS_ERROR;
+            }
+        }
+        else {
+            state->data->msg = "Could not recognise option '" + name + "'.";
+            return STATUS_ERROR;
+        }
+    }
+    if (EOTF_UNKNOWN == state->data->eotf) {
+        state->data->msg = "Missing 'eotf' option.";
+        return STATUS_ERROR;
+    }
+
+    if (0 == state->data->threadNum)
+        state->data->threadNum = std::max(1, (int)std::thread::hardware_concurrency());
+    state->data->pool.start(state->data->threadNum);
+
+    state->data->msg = "SIMD: " + std::string(cpu_level_name(state->data->cpuLevel));
+    state->data->msg += "\nThreads: " + std::to_string(state->data->threadNum);
+    return STATUS_OK;
+}
+
+static Status img_transformer_transfer_close(ImgTransformerHandle handle) {
+    img_transformer_transfer_t* state = (img_transformer_transfer_t*)handle;
+    if (state && state->data) {
+        delete state->data;
+        state->data = nullptr;
+    }
+    return STATUS_OK;
+}
+
+static int input_bits(ImgTransformerBitdepth bitdepth) {
+    switch (bitdepth) {
+    case BIT_DEPTH_UINT10_LSB:
+        return 10;
+    case BIT_DEPTH_UINT12_LSB:
+        return 12;
+    case BIT_DEPTH_UINT14_LSB:
+        return 14;
+    case BIT_DEPTH_UINT16:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+/* SMPTE ST 2084, signal to cd/m2 and back */
+static const double pq_m1 = 2610.0 / 16384.0;
+static const double pq_m2 = 2523.0 / 4096.0 * 128.0;
+static const double pq_c1 = 3424.0 / 4096.0;
+static const double pq_c2 = 2413.0 / 4096.0 * 32.0;
+static const double pq_c3 = 2392.0 / 4096.0 * 32.0;
+
+static double pq_to_nits(double e) {
+    double p = std::pow(e, 1.0 / pq_m2);
+    return 10000.0 * std::pow(std::max(p - pq_c1, 0.0) / (pq_c2 - pq_c3 * p), 1.0 / pq_m1);
+}
+
+static double nits_to_pq(double nits) {
+    double y = std::pow(std::max(nits, 0.0) / 10000.0, pq_m1);
+    return std::pow((pq_c1 + pq_c2 * y) / (1.0 + pq_c3 * y), pq_m2);
+}
+
+/* ARIB STD-B67 */
+static const double hlg_a = 0.17883277;
+static const double hlg_b = 1.0 - 4.0 * hlg_a;
+static const double hlg_c = 0.5 - hlg_a * std::log(4.0 * hlg_a);
+
+/* HLG OOTF is applied to each channel with the system gamma of BT.2100 for the display peak */
+static double hlg_gamma(double peak) {
+    return 1.2 + 0.42 * std::log10(peak / 1000.0);
+}
+
+/* Display light of a normalized signal */
+static double decode(const img_transformer_transfer_data_t* data, ImgTransformerEotf eotf, double e) {
+    e = std::min(1.0, std::max(0.0, e));
+    switch (eotf) {
+    case EOTF_PQ:
+        return pq_to_nits(e);
+    case EOTF_HLG: {
+        double scene = e <= 0.5 ? e * e / 3.0 : (std::exp((e - hlg_c) / hlg_a) + hlg_b) / 12.0;
+        return data->hlgPeak * std::pow(scene, hlg_gamma(data->hlgPeak));
+    }
+    case EOTF_BT1886:
+        return data->sdrPeak * std::pow(e, 2.4);
+    default:
+        return data->sdrPeak * (e < 0.081 ? e / 4.5 : std::pow((e + 0.099) / 1.099, 1.0 / 0.45));
+    }
+}
+
+/* Normalized signal of display light */
+static double encode(const img_transformer_transfer_data_t* data, ImgTransformerEotf eotf, double nits) {
+    nits = std::max(nits, 0.0);
+    switch (eotf) {
+    case EOTF_PQ:
+        return nits_to_pq(nits);
+    case EOTF_HLG: {
+        double scene = std::pow(std::min(nits / data->hlgPeak, 1.0), 1.0 / hlg_gamma(data->hlgPeak));
+        return scene <= 1.0 / 12.0 ? std::sqrt(3.0 * scene) : hlg_a * std::log(12.0 * scene - hlg_b) + hlg_c;
+    }
+    case EOTF_BT1886:
+        return std::pow(std::min(nits / data->sdrPeak, 1.0), 1.0 / 2.4);
+    default: {
+        double l = std::min(nits / data->sdrPeak, 1.0);
+        return l < 0.018 ? 4.5 * l : 1.099 * std::pow(l, 0.45) - 0.099;
+    }
+    }
+}
+
+static double peak(const img_transformer_transfer_data_t* data, ImgTransformerEotf eotf, bool source) {
+    if (EOTF_PQ == eotf)
+        return source ? data->sourcePeak : 10000.0;
+    return EOTF_HLG == eotf ? data->hlgPeak : data->sdrPeak;
+}
+
+/* BT.2390 EETF: knee and Hermite spline roll-off in PQ domain */
+static double tone_map(double nits, double sourcePeak, double targetPeak) {
+    const double source = nits_to_pq(sourcePeak);
+    const double e1 = std::min(nits_to_pq(nits) / source, 1.0);
+    const double maxLum = nits_to_pq(targetPeak) / source;
+    const double ks = 1.5 * maxLum - 0.5;
+    if (e1 <= ks)
+        return nits;
+    const double t = (e1 - ks) / (1.0 - ks);
+    const double t2 = t * t;
+    const double t3 = t2 * t;
+    const double e2 = (2 * t3 - 3 * t2 + 1) * ks + (t3 - 2 * t2 + t) * (1 - ks) + (-2 * t3 + 3 * t2) * maxLum;
+    return pq_to_nits(e2 * source);
+}
+
+/* Output code of display light, before rounding */
+static double output_code(const img_transformer_transfer_data_t* data,
+                          ImgTransformerEotf sourceEotf,
+                          double nits,
+                          int bits,
+                          bool legal) {
+    const double sourcePeak = peak(data, sourceEotf, true);
+    const double targetPeak = peak(data, data->eotf, false);
+    if (data->toneMap && sourcePeak > targetPeak)
+        nits = tone_map(nits, sourcePeak, targetPeak);
+    nits = std::min(nits, targetPeak);
+    const double e = encode(data, data->eotf, nits);
+    return legal ? (219.0 * e + 16.0) * (1u << (bits - 8)) : e * ((1u << bits) - 1);
+}
+
+static double code_signal(uint32_t code, int bits, bool legal) {
+    return legal ? ((double)code / (1u << (bits - 8)) - 16.0) / 219.0 : (double)code / ((1u << bits) - 1);
+}
+
+/* Linear RGB to CIE XYZ of primaries with D65 white */
+static void rgb_to_xyz(ImgTransformerChroma chroma, double m[9]) {
+    static const double bt709[6] = {0.640, 0.330, 0.300, 0.600, 0.150, 0.060};
+    static const double bt2020[6] = {0.708, 0.292, 0.170, 0.797, 0.131, 0.046};
+    static const double p3[6] = {0.680, 0.320, 0.265, 0.690, 0.150, 0.060};
+    const double* xy = CHROMA_REC709 == chroma ? bt709 : (CHROMA_REC2020 == chroma ? bt2020 : p3);
+    const double white[3] = {0.3127 / 0.3290, 1.0, (1.0 - 0.3127 - 0.3290) / 0.3290};
+    double p[9];
+    for (int c = 0; c < 3; c++) {
+        p[c] = xy[2 * c] / xy[2 * c + 1];
+        p[3 + c] = 1.0;
+        p[6 + c] = (1.0 - xy[2 * c] - xy[2 * c + 1]) / xy[2 * c + 1];
+    }
+    /* Scale primaries so that they add up to white, by Cramer's rule */
+    double det = p[0] * (p[4] * p[8] - p[5] * p[7]) - p[1] * (p[3] * p[8] - p[5] * p[6]) +
+                 p[2] * (p[3] * p[7] - p[4] * p[6]);
+    double s[3];
+    for (int c = 0; c < 3; c++) {
+        double q[9];
+        memcpy(q, p, sizeof(q));
+        for (int r = 0; r < 3; r++)
+            q[3 * r + c] = white[r];
+        s[c] = (q[0] * (q[4] * q[8] - q[5] * q[7]) - q[1] * (q[3] * q[8] - q[5] * q[6]) +
+                q[2] * (q[3] * q[7] - q[4] * q[6])) /
+               det;
+    }
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            m[3 * r + c] = p[3 * r + c] * s[c];
+}
+
+static void invert(const double m[9], double inv[9]) {
+    double det = m[0] * (m[4] * m[8] - m[5] * m[7]) - m[1] * (m[3] * m[8] - m[5] * m[6]) +
+                 m[2] * (m[3] * m[7] - m[4] * m[6]);
+    inv[0] = (m[4] * m[8] - m[5] * m[7]) / det;
+    inv[1] = (m[2] * m[7] - m[1] * m[8]) / det;
+    inv[2] = (m[1] * m[5] - m[2] * m[4]) / det;
+    inv[3] = (m[5] * m[6] - m[3] * m[8]) / det;
+    inv[4] = (m[0] * m[8] - m[2] * m[6]) / det;
+    inv[5] = (m[2] * m[3] - m[0] * m[5]) / det;
+    inv[6] = (m[3] * m[7] - m[4] * m[6]) / det;
+    inv[7] = (m[1] * m[6] - m[0] * m[7]) / det;
+    inv[8] = (m[0] * m[4] - m[1] * m[3]) / det;
+}
+
+/* Every step is folded into tables, so a frame is converted in one pass */
+static void prepare(img_transformer_transfer_data_t* data, const ImgTransformerMetadata& metadata, int bits) {
+    const bool legal = RANGE_LEGAL == metadata.range;
+    const uint32_t maxCode = (1u << bits) - 1;
+    data->matrix = CHROMA_UNKNOWN != data->primaries && metadata.chroma != data->primaries;
+    if (!data->matrix) {
+        data->lut.resize(TRANSFER_CODES);
+        for (uint32_t code = 0; code <= maxCode; code++) {
+            double nits = decode(data, metadata.eotf, code_signal(code, bits, legal));
+            double out = std::floor(output_code(data, metadata.eotf, nits, bits, legal) + 0.5);
+            data->lut[code] = (uint16_t)std::min((double)maxCode, std::max(0.0, out));
+        }
+        std::fill(data->lut.begin() + maxCode + 1, data->lut.end(), data->lut[maxCode]);
+    }
+    else {
+        transfer_tables_t& t = data->tables;
+        t.decode.resize(TRANSFER_CODES);
+        for (uint32_t code = 0; code <= maxCode; code++)
+            t.decode[code] = (float)(decode(data, metadata.eotf, code_signal(code, bits, legal)) / 10000.0);
+        std::fill(t.decode.begin() + maxCode + 1, t.decode.end(), t.decode[maxCode]);
+        const size_t entries = (size_t)TRANSFER_OCTAVES << TRANSFER_STEP_BITS;
+        t.encode.resize(entries + 2);
+        for (size_t i = 0; i <= entries; i++) {
+            double x = std::ldexp(1.0 + (double)(i & ((1u << TRANSFER_STEP_BITS) - 1)) / (1u << TRANSFER_STEP_BITS),
+                                  (int)(i >> TRANSFER_STEP_BITS) - TRANSFER_OCTAVES);
+            t.encode[i] = (float)output_code(data, metadata.eotf, x * 10000.0, bits, legal);
+        }
+        t.encode[entries + 1] = t.encode[entries];
+        double src[9], dst[9], toRgb[9];
+        rgb_to_xyz(metadata.chroma, src);
+        rgb_to_xyz(data->primaries, dst);
+        invert(dst, toRgb);
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                t.matrix[3 * r + c] = (float)(toRgb[3 * r] * src[c] + toRgb[3 * r + 1] * src[3 + c] +
+                                              toRgb[3 * r + 2] * src[6 + c]);
+        t.maxCode = maxCode;
+    }
+    data->tablesEotf = metadata.eotf;
+    data->tablesChroma = metadata.chroma;
+    data->tablesBitdepth = metadata.bitdepth;
+    data->tablesRange = metadata.range;
+}
+
+static bool check_input(img_transformer_transfer_data_t* data, const ImgTransformerMetadata& metadata) {
+    int bits = input_bits(metadata.bitdepth);
+    if (PLANAR != metadata.arrangement || COLOR_SPACE_RGB != metadata.colorspace || 0 == bits ||
+        SUBSAMPLING_S444 != metadata.subsampling) {
+        data->msg = "Input must be planar RGB with 10 to 16 bits per sample.";
+        return false;
+    }
+    if (EOTF_UNKNOWN == metadata.eotf) {
+        data->msg = "Input transfer function is unknown.";
+        return false;
+    }
+    if (CHROMA_UNKNOWN != data->primaries && CHROMA_REC709 != metadata.chroma && CHROMA_REC2020 != metadata.chroma &&
+        CHROMA_P3D65 != metadata.chroma) {
+        data->msg = "Input primaries must be BT.709, BT.2020 or P3 D65 to convert them.";
+        return false;
+    }
+    if (metadata.width <= 0 || metadata.height <= 0) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return false;
+    }
+    return true;
+}
+
+static void output_metadata(const img_transformer_transfer_data_t* data, ImgTransformerMetadata& metadata) {
+    metadata.eotf = data->eotf;
+    if (CHROMA_UNKNOWN != data->primaries)
+        metadata.chroma = data->primaries;
+}
+
+static Status img_transformer_transfer_process(ImgTransformerHandle handle, ImgTransformerFrame* frame) {
+    img_transformer_transfer_t* state = (img_transformer_transfer_t*)handle;
+    img_transformer_transfer_data_t* data = state->data;
+    ImgTransformerMetadata& metadata = frame->metadata;
+    data->msg.clear();
+
+    if (!check_input(data, metadata))
+        return STATUS_ERROR;
+    const int bits = input_bits(metadata.bitdepth);
+    const size_t width = (size_t)metadata.width;
+    const size_t height = (size_t)metadata.height;
+    const size_t planeSize = width * height;
+    if (frame->data.size < (int64_t)(3 * planeSize * sizeof(uint16_t))) {
+        data->msg = "Input frame is smaller than its dimensions.";
+        return STATUS_ERROR;
+    }
+    if (metadata.eotf != data->tablesEotf || metadata.chroma != data->tablesChroma ||
+        metadata.bitdepth != data->tablesBitdepth || metadata.range != data->tablesRange)
+        prepare(data, metadata, bits);
+
+    uint16_t* rgb[3];
+    for (int s = 0; s < 3; s++)
+        rgb[s] = (uint16_t*)frame->data.buffer + s * planeSize;
+
+    const CpuLevel level = data->cpuLevel;
+    const size_t bands = (height + band_rows - 1) / band_rows;
+    std::atomic<size_t> next(0);
+    data->pool.run([&](unsigned) {
+        for (size_t band = next++; band < bands; band = next++) {
+            size_t first = band * band_rows * width;
+            size_t count = (std::min(height, (band + 1) * band_rows) - band * band_rows) * width;
+            if (data->matrix) {
+                uint16_t* const rows[3] = {rgb[0] + first, rgb[1] + first, rgb[2] + first};
+                transfer_rows(level, data->tables, rows, count);
+            }
+            else {
+                for (int s = 0; s < 3; s++)
+                    transfer_lut(data->lut.data(), rgb[s] + first, count);
+            }
+        }
+    });
+
+    output_metadata(data, metadata);
+    return STATUS_OK;
+}
+
+/* Samples are converted in place, only transfer function and primaries change */
+static Status img_transformer_transfer_get_output_size(ImgTransformerHandle handle,
+                                                       const ImgTransformerMetadata* inMetadata,
+                                                       ImgTransformerMetadata* outMetadata, int64_t* outSize) {
+    img_transformer_transfer_t* state = (img_transformer_transfer_t*)handle;
+    state->data->msg.clear();
+    if (!check_input(state->data, *inMetadata))
+        return STATUS_ERROR;
+    *outMetadata = *inMetadata;
+    output_metadata(state->data, *outMetadata);
+    *outSize = (int64_t)(3 * (size_t)inMetadata->width * (size_t)inMetadata->height * sizeof(uint16_t));
+    return STATUS_OK;
+}
+
+static const char* img_transformer_transfer_get_message(ImgTransformerHandle handle) {
+    img_transformer_transfer_t* state = (img_transformer_transfer_t*)handle;
+    if (state && state->data)
+        return state->data->msg.empty() ? NULL : state->data->msg.c_str();
+    else
+        return NULL;
+}
+
+static ImgTransformerApi img_transformer_transfer_plugin_api = {"transfer",
+                                                                img_transformer_transfer_get_info,
+                                                                img_transformer_transfer_get_size,
+                                                                img_transformer_transfer_init,
+                                                                img_transformer_transfer_close,
+                                                                img_transformer_transfer_process,
+                                                                img_transformer_transfer_get_message,
+                                                                img_transformer_transfer_get_output_size,
+                                                                NULL,
+                                                                NULL};
+
+DLB_EXPORT
+ImgTransformerApi* imgTransformerGetApi() {
+    return &img_transformer_transfer_plugin_api;
+}
+
+DLB_EXPORT
+int imgTransformerGetApiVersion(void) {
+    return IMG_TRANSFORMER_API_VERSION;
+}
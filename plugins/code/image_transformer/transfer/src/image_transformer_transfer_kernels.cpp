@@ -0,0 +1,183 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image_transformer_transfer_kernels.h"
+
+#include <math.h>
+#include <string.h>
+
+/* Float representation of the lowest encoded value, 2^-TRANSFER_OCTAVES */
+static const int32_t encode_base = (127 - TRANSFER_OCTAVES) << 23;
+static const int fraction_bits = 23 - TRANSFER_STEP_BITS;
+static const int32_t fraction_mask = (1 << fraction_bits) - 1;
+static const float fraction_scale = 1.0f / (float)(1 << fraction_bits);
+
+void transfer_lut(const uint16_t* lut, uint16_t* samples, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        samples[i] = lut[samples[i]];
+}
+
+static inline uint16_t encode_scalar(const transfer_tables_t& t, float x) {
+    const float lowest = 1.0f / (float)(1ull << TRANSFER_OCTAVES);
+    x = x > lowest ? (x < 1.0f ? x : 1.0f) : lowest;
+    int32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits -= encode_base;
+    const float* e = t.encode.data() + (bits >> fraction_bits);
+    const float frac = (float)(bits & fraction_mask) * fraction_scale;
+    const float v = e[0] + (e[1] - e[0]) * frac;
+    long code = lrintf(v);
+    return (uint16_t)(code < 0 ? 0 : (code > (long)t.maxCode ? t.maxCode : code));
+}
+
+static void transfer_scalar(const transfer_tables_t& t, uint16_t* const rgb[3], size_t first, size_t count) {
+    const float* m = t.matrix;
+    for (size_t i = first; i < count; i++) {
+        const float r = t.decode[rgb[0][i]];
+        const float g = t.decode[rgb[1][i]];
+        const float b = t.decode[rgb[2][i]];
+        rgb[0][i] = encode_scalar(t, m[0] * r + m[1] * g + m[2] * b);
+        rgb[1][i] = encode_scalar(t, m[3] * r + m[4] * g + m[5] * b);
+        rgb[2][i] = encode_scalar(t, m[6] * r + m[7] * g + m[8] * b);
+    }
+}
+
+#if defined(DLB_X86)
+
+/* SIMD code multiplies and adds separately, in the scalar order, so results are bit-exact */
+
+DLB_TARGET_AVX2
+static inline __m256 decode_avx2(const float* table, const uint16_t* src) {
+    return _mm256_i32gather_ps(table, _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)src)), 4);
+}
+
+DLB_TARGET_AVX2
+static inline __m256 weigh_avx2(const float* w, __m256 r, __m256 g, __m256 b) {
+    __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(w[0]), r), _mm256_mul_ps(_mm256_set1_ps(w[1]), g));
+    return _mm256_add_ps(v, _mm256_mul_ps(_mm256_set1_ps(w[2]), b));
+}
+
+DLB_TARGET_AVX2
+static inline __m256i encode_avx2(const transfer_tables_t& t, __m256 x) {
+    const __m256 lowest = _mm256_set1_ps(1.0f / (float)(1ull << TRANSFER_OCTAVES));
+    x = _mm256_min_ps(_mm256_max_ps(x, lowest), _mm256_set1_ps(1.0f));
+    __m256i bits = _mm256_sub_epi32(_mm256_castps_si256(x), _mm256_set1_epi32(encode_base));
+    __m256i index = _mm256_srli_epi32(bits, fraction_bits);
+    __m256 frac = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(bits, _mm256_set1_epi32(fraction_mask))),
+                                _mm256_set1_ps(fraction_scale));
+    __m256 e0 = _mm256_i32gather_ps(t.encode.data(), index, 4);
+    __m256 e1 = _mm256_i32gather_ps(t.encode.data() + 1, index, 4);
+    __m256i code = _mm256_cvtps_epi32(_mm256_add_ps(e0, _mm256_mul_ps(_mm256_sub_ps(e1, e0), frac)));
+    return _mm256_min_epi32(_mm256_max_epi32(code, _mm256_setzero_si256()), _mm256_set1_epi32((int)t.maxCode));
+}
+
+DLB_TARGET_AVX2
+static inline void store_avx2(uint16_t* dst, __m256i lo, __m256i hi) {
+    _mm256_storeu_si256((__m256i*)dst, _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+DLB_TARGET_AVX2
+static size_t transfer_avx2(const transfer_tables_t& t, uint16_t* const rgb[3], size_t count) {
+    const float* m = t.matrix;
+    const float* decode = t.decode.data();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i out[3][2];
+        for (int h = 0; h < 2; h++) {
+            __m256 r = decode_avx2(decode, rgb[0] + i + 8 * h);
+            __m256 g = decode_avx2(decode, rgb[1] + i + 8 * h);
+            __m256 b = decode_avx2(decode, rgb[2] + i + 8 * h);
+            for (int c = 0; c < 3; c++)
+                out[c][h] = encode_avx2(t, weigh_avx2(m + 3 * c, r, g, b));
+        }
+        for (int c = 0; c < 3; c++)
+            store_avx2(rgb[c] + i, out[c][0], out[c][1]);
+    }
+    return i;
+}
+
+DLB_TARGET_AVX512
+static inline __m512 decode_avx512(const float* table, const uint16_t* src) {
+    return _mm512_i32gather_ps(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)src)), table, 4);
+}
+
+DLB_TARGET_AVX512
+static inline __m512 weigh_avx512(const float* w, __m512 r, __m512 g, __m512 b) {
+    __m512 v = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(w[0]), r), _mm512_mul_ps(_mm512_set1_ps(w[1]), g));
+    return _mm512_add_ps(v, _mm512_mul_ps(_mm512_set1_ps(w[2]), b));
+}
+
+DLB_TARGET_AVX512
+static inline __m512i encode_avx512(const transfer_tables_t& t, __m512 x) {
+    const __m512 lowest = _mm512_set1_ps(1.0f / (float)(1ull << TRANSFER_OCTAVES));
+    x = _mm512_min_ps(_mm512_max_ps(x, lowest), _mm512_set1_ps(1.0f));
+    __m512i bits = _mm512_sub_epi32(_mm512_castps_si512(x), _mm512_set1_epi32(encode_base));
+    __m512i index = _mm512_srli_epi32(bits, fraction_bits);
+    __m512 frac = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_and_si512(bits, _mm512_set1_epi32(fraction_mask))),
+                                _mm512_set1_ps(fraction_scale));
+    __m512 e0 = _mm512_i32gather_ps(index, t.encode.data(), 4);
+    __m512 e1 = _mm512_i32gather_ps(index, t.encode.data() + 1, 4);
+    __m512i code = _mm512_cvtps_epi32(_mm512_add_ps(e0, _mm512_mul_ps(_mm512_sub_ps(e1, e0), frac)));
+    return _mm512_min_epi32(_mm512_max_epi32(code, _mm512_setzero_si512()), _mm512_set1_epi32((int)t.maxCode));
+}
+
+DLB_TARGET_AVX512
+static size_t transfer_avx512(const transfer_tables_t& t, uint16_t* const rgb[3], size_t count) {
+    const float* m = t.matrix;
+    const float* decode = t.decode.data();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 r = decode_avx512(decode, rgb[0] + i);
+        __m512 g = decode_avx512(decode, rgb[1] + i);
+        __m512 b = decode_avx512(decode, rgb[2] + i);
+        for (int c = 0; c < 3; c++) {
+            __m512i code = encode_avx512(t, weigh_avx512(m + 3 * c, r, g, b));
+            _mm256_storeu_si256((__m256i*)(rgb[c] + i), _mm512_cvtepi32_epi16(code));
+        }
+    }
+    return i;
+}
+
+#endif
+
+void transfer_rows(CpuLevel level, const transfer_tables_t& tables, uint16_t* const rgb[3], size_t count) {
+    size_t done = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        done = transfer_avx512(tables, rgb, count);
+    else if (level >= CPU_LEVEL_AVX2)
+        done = transfer_avx2(tables, rgb, count);
+#else
+    (void)level;
+#endif
+    transfer_scalar(tables, rgb, done, count);
+}
@@ -0,0 +1,76 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_IMAGE_TRANSFORMER_TRANSFER_KERNELS_H__
+#define __DEE_PLUGINS_IMAGE_TRANSFORMER_TRANSFER_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "plugins_cpu.h"
+
+/* Encode table covers linear values from 2^-TRANSFER_OCTAVES to 1 with
+ * 2^TRANSFER_STEP_BITS entries per octave */
+#define TRANSFER_OCTAVES 40
+#define TRANSFER_STEP_BITS 8
+
+/* Input tables have an entry for every 16-bit sample, so samples above the
+ * bit depth of the frame are looked up without a range check */
+#define TRANSFER_CODES 65536
+
+/** @brief Tables of a conversion done in linear light
+ *  Linear light is normalized so that 1 is 10000 cd/m2. Entries of 'encode' are
+ *  unrounded output code values; entry i is the code of linear value whose float
+ *  representation is 2^-TRANSFER_OCTAVES plus i << (23 - TRANSFER_STEP_BITS),
+ *  values in between are interpolated.
+ */
+typedef struct {
+    std::vector<float> decode; /**< Linear value of every input code, TRANSFER_CODES entries */
+    std::vector<float> encode; /**< (TRANSFER_OCTAVES << TRANSFER_STEP_BITS) + 2 entries */
+    float matrix[9];           /**< Row-major linear RGB to RGB */
+    uint32_t maxCode;          /**< Largest output code value */
+} transfer_tables_t;
+
+/** @brief Replaces every sample by its entry in 'lut', which has TRANSFER_CODES entries */
+void transfer_lut(const uint16_t* lut, uint16_t* samples, size_t count);
+
+/** @brief Converts planar RGB pixels in place through linear light
+ *  Every path rounds the same way, so results do not depend on 'level'.
+ */
+void transfer_rows(CpuLevel level,
+                   const transfer_tables_t& tables,
+                   uint16_t* const rgb[3], /**< [in,out] R, G, B samples */
+                   size_t count            /**< [in] Number of pixels */
+);
+
+#endif // __DEE_PLUGINS_IMAGE_TRANSFORMER_TRANSFER_KERNELS_H__
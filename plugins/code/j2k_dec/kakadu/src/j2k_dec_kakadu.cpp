@@ -30,6 +30,8 @@
 * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include "j2k_dec_kakadu.h"
+#include "j2k_dec_kakadu_color.h"
+#include "j2k_dec_kakadu_pool.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -39,6 +41,9 @@
 #include <cstdio>
 #include <string>
 #include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
 
 #ifdef _WIN32 // suppress windows kdu warnings
     #pragma warning(push)
@@ -62,6 +67,8 @@
 using namespace kdu_supp;
 
 #define MAX_PLANES (3)
+#define YUV_STRIPE_HEIGHT (64)
+#define QUANT_STEP_10BIT (64) /* 10-bit quantization step expressed in 16-bit samples */
 
 static
 const
@@ -69,7 +76,21 @@ PropertyInfo j2k_dec_kakadu_info[] =
 {
     { "width", PROPERTY_TYPE_INTEGER, "Picture width", NULL, NULL, 1, 1, ACCESS_TYPE_WRITE_INIT },
     { "height", PROPERTY_TYPE_INTEGER, "Picture height", NULL, NULL, 1, 1, ACCESS_TYPE_WRITE_INIT },
-    { "thread_num", PROPERTY_TYPE_INTEGER, "Number of threads used for decoding. Value '0' disables multi-threading.", "8", "0:255", 0, 1, ACCESS_TYPE_USER }
+    { "thread_num", PROPERTY_TYPE_INTEGER, "Number of threads used for decoding. Value '0' disables multi-threading.", "8", "0:255", 0, 1, ACCESS_TYPE_USER },
+    { "stripe_height", PROPERTY_TYPE_INTEGER, "Number of rows decoded per stripe. Value '0' decodes the whole picture in a single stripe.", "0", "0:65535", 0, 1, ACCESS_TYPE_USER },
+    { "output_format", PROPERTY_TYPE_STRING, "Format of decoded picture. 'yuv420p10' converts to 10-bit planar Y'CbCr 4:2:0 while decoding.", "rgb48", "rgb48:yuv420p10", 0, 1, ACCESS_TYPE_USER },
+    { "yuv_matrix", PROPERTY_TYPE_STRING, "Matrix coefficients used by 'yuv420p10' output format.", "bt709", "bt709:bt2020", 0, 1, ACCESS_TYPE_USER },
+    { "yuv_range", PROPERTY_TYPE_STRING, "Range used by 'yuv420p10' output format.", "limited", "limited:full", 0, 1, ACCESS_TYPE_USER },
+    { "decode_mode", PROPERTY_TYPE_STRING, "Trade-off between accuracy and speed. 'balanced' and 'fastest' allow 16-bit fixed-point processing.", "precise", "precise:balanced:fastest", 0, 1, ACCESS_TYPE_USER },
+    { "verify_interval", PROPERTY_TYPE_INTEGER, "Every N-th frame is decoded again in 'precise' mode and compared with 'decode_mode' result (0 = disabled).", "0", "0:65535", 0, 1, ACCESS_TYPE_USER },
+    { "verify_max_error", PROPERTY_TYPE_INTEGER, "Maximum absolute error of verified frames, in 16-bit sample units.", NULL, NULL, 0, 1, ACCESS_TYPE_READ },
+    { "verify_mean_error", PROPERTY_TYPE_DECIMAL, "Mean absolute error of verified frames, in 16-bit sample units.", NULL, NULL, 0, 1, ACCESS_TYPE_READ },
+    { "verify_within_10bit", PROPERTY_TYPE_BOOLEAN, "Indicates that maximum error of verified frames is below 10-bit quantization step.", NULL, NULL, 0, 1, ACCESS_TYPE_READ },
+    { "shared_threads", PROPERTY_TYPE_BOOLEAN, "Decode on a thread pool shared by all decoder instances in the process instead of 'thread_num' private threads. Pool threads are not pinned to cores.", "false", "true:1:false:0", 0, 1, ACCESS_TYPE_USER },
+    { "shared_thread_num", PROPERTY_TYPE_INTEGER, "Size of shared thread pool (0 = number of logical CPUs). Only the instance that creates the pool applies it.", "0", "0:255", 0, 1, ACCESS_TYPE_USER },
+    { "shared_queue_depth", PROPERTY_TYPE_INTEGER, "Number of pictures of all instances currently waiting for or being decoded on the shared thread pool.", NULL, NULL, 0, 1, ACCESS_TYPE_READ },
+    { "shared_utilization", PROPERTY_TYPE_DECIMAL, "Percentage of time since init this instance spent decoding on the shared thread pool.", NULL, NULL, 0, 1, ACCESS_TYPE_READ },
+    { "shared_wait_ms", PROPERTY_TYPE_DECIMAL, "Total time this instance waited for the shared thread pool, in milliseconds.", NULL, NULL, 0, 1, ACCESS_TYPE_READ },
 };
 
 size_t
@@ -80,15 +101,42 @@ kakadu_get_info
     return sizeof(j2k_dec_kakadu_info) / sizeof(PropertyInfo);
 }
 
+class j2k_buffer;
+
 struct j2k_dec_kakadu_data_t
 {
     std::string         msg;
     size_t              width;
     size_t              height;
     int                 thread_num;
+    int                 stripe_height;
+    kakadu_stripe_callback stripe_callback;
+    void*               stripe_context;
+    bool                yuv_output;
+    bool                yuv_bt2020;
+    bool                yuv_full_range;
+    kakadu_yuv_matrix   yuv_matrix;
+    kdu_int16*          stripe_buffer;
     kdu_int16*          output_buffer;
     short*              reorder_buffer;
     kdu_thread_env      env;
+    bool                force_precise;
+    bool                want_fastest;
+    int                 verify_interval;
+    kdu_int16*          verify_buffer;
+    uint64_t            frame_count;
+    uint64_t            verify_frames;
+    uint64_t            verify_samples;
+    uint64_t            verify_sum_error;
+    int                 verify_max_error;
+    std::vector<uint8_t> header_cache;  /* Main header bytes of last validated frame */
+    j2k_buffer*         input;
+    kdu_codestream      codestream;     /* Created for cached main header, restarted for frames sharing it */
+    bool                shared_threads;
+    int                 shared_thread_num;
+    kakadu_thread_pool* shared_pool;
+    kakadu_clock::time_point init_time;
+    kakadu_decode_job   job;
 };
 
 /* This structure can contain only pointers and simple types */
@@ -167,9 +215,52 @@ init_data
     data->width = 0;
     data->height = 0;
     data->thread_num = 8;
+    data->stripe_height = 0;
+    data->stripe_callback = NULL;
+    data->stripe_context = NULL;
+    data->yuv_output = false;
+    data->yuv_bt2020 = false;
+    data->yuv_full_range = false;
+    data->stripe_buffer = NULL;
+    data->force_precise = true;
+    data->want_fastest = false;
+    data->verify_interval = 0;
+    data->verify_buffer = NULL;
+    data->frame_count = 0;
+    data->verify_frames = 0;
+    data->verify_samples = 0;
+    data->verify_sum_error = 0;
+    data->verify_max_error = 0;
+    data->header_cache.clear();
+    data->input = NULL;
+    data->shared_threads = false;
+    data->shared_thread_num = 0;
+    data->shared_pool = NULL;
     data->msg.clear();
 }
 
+/* Stripe height used for picture of given height. YUV 4:2:0 output needs an even number of rows per stripe. */
+static
+int
+get_stripe_height
+    (const j2k_dec_kakadu_data_t* data
+    ,size_t height
+    )
+{
+    if (data->yuv_output)
+        return data->stripe_height ? (data->stripe_height + 1) & ~1 : YUV_STRIPE_HEIGHT;
+    return data->stripe_height ? data->stripe_height : (int)height;
+}
+
+static
+int
+get_stripe_height
+    (const j2k_dec_kakadu_data_t* data
+    )
+{
+    return get_stripe_height(data, data->height);
+}
+
 Status
 kakadu_init
     (J2kDecHandle               handle          /**< [in/out] Decoder instance handle */
@@ -198,6 +289,74 @@ kakadu_init
             {
                 state->data->thread_num = std::stoi(value);
             }
+            else if ("stripe_height" == name)
+            {
+                state->data->stripe_height = std::stoi(value);
+            }
+            else if ("shared_threads" == name)
+            {
+                if ("true" == value || "1" == value)
+                    state->data->shared_threads = true;
+                else if ("false" == value || "0" == value)
+                    state->data->shared_threads = false;
+                else
+                    throw std::invalid_argument(value);
+            }
+            else if ("shared_thread_num" == name)
+            {
+                state->data->shared_thread_num = std::stoi(value);
+            }
+            else if ("decode_mode" == name)
+            {
+                if ("precise" == value)
+                {
+                    state->data->force_precise = true;
+                    state->data->want_fastest = false;
+                }
+                else if ("balanced" == value)
+                {
+                    state->data->force_precise = false;
+                    state->data->want_fastest = false;
+                }
+                else if ("fastest" == value)
+                {
+                    state->data->force_precise = false;
+                    state->data->want_fastest = true;
+                }
+                else
+                    throw std::invalid_argument(value);
+            }
+            else if ("verify_interval" == name)
+            {
+                state->data->verify_interval = std::stoi(value);
+            }
+            else if ("output_format" == name)
+            {
+                if ("rgb48" == value)
+                    state->data->yuv_output = false;
+                else if ("yuv420p10" == value)
+                    state->data->yuv_output = true;
+                else
+                    throw std::invalid_argument(value);
+            }
+            else if ("yuv_matrix" == name)
+            {
+                if ("bt709" == value)
+                    state->data->yuv_bt2020 = false;
+                else if ("bt2020" == value)
+                    state->data->yuv_bt2020 = true;
+                else
+                    throw std::invalid_argument(value);
+            }
+            else if ("yuv_range" == name)
+            {
+                if ("limited" == value)
+                    state->data->yuv_full_range = false;
+                else if ("full" == value)
+                    state->data->yuv_full_range = true;
+                else
+                    throw std::invalid_argument(value);
+            }
             else
             {
                 state->data->msg += "Unknown property: " + name;
@@ -215,9 +374,9 @@ kakadu_init
         return STATUS_ERROR;
     }
 
-    if (state->data->width <= 0)
+    if (state->data->height <= 0)
     {
-        state->data->msg = "Invalid 'width' value.";
+        state->data->msg = "Invalid 'height' value.";
         return STATUS_ERROR;
     }
 
@@ -227,18 +386,56 @@ kakadu_init
         return STATUS_ERROR;
     }
 
-    int buffer_size = (int)(state->data->width*state->data->height*MAX_PLANES);
-    state->data->output_buffer = new kdu_int16[buffer_size];
-    state->data->reorder_buffer = new short[buffer_size];
+    if (state->data->shared_thread_num < 0 || state->data->shared_thread_num > 255)
+    {
+        state->data->msg = "Invalid 'shared_thread_num' value: " + std::to_string(state->data->shared_thread_num);
+        return STATUS_ERROR;
+    }
+
+    if (state->data->verify_interval < 0)
+    {
+        state->data->msg = "Invalid 'verify_interval' value: " + std::to_string(state->data->verify_interval);
+        return STATUS_ERROR;
+    }
+
+    if (state->data->stripe_height < 0 || state->data->stripe_height > 65535)
+    {
+        state->data->msg = "Invalid 'stripe_height' value: " + std::to_string(state->data->stripe_height);
+        return STATUS_ERROR;
+    }
 
-    if (state->data->thread_num) {
+    if (state->data->yuv_output)
+    {
+        /* RGB is decoded into bounded stripe buffer and converted while the picture is pulled,
+         * so only the 4:2:0 picture is held at full size */
+        size_t chroma_size = ((state->data->width + 1)/2)*((state->data->height + 1)/2);
+        state->data->output_buffer = new kdu_int16[state->data->width*state->data->height + 2*chroma_size];
+        kakadu_yuv_matrix_init(&state->data->yuv_matrix, state->data->yuv_bt2020, state->data->yuv_full_range);
+        state->data->stripe_buffer = new kdu_int16[state->data->width*get_stripe_height(state->data)*MAX_PLANES];
+    }
+    else
+    {
+        int buffer_size = (int)(state->data->width*state->data->height*MAX_PLANES);
+        state->data->output_buffer = new kdu_int16[buffer_size];
+        state->data->reorder_buffer = new short[buffer_size];
+    }
+
+    state->data->input = new j2k_buffer;
+
+    if (state->data->shared_threads) {
+        state->data->shared_pool = kakadu_thread_pool::acquire(state->data->shared_thread_num);
+    }
+    else if (state->data->thread_num) {
         state->data->env.create(); 
         for (int nt=1; nt < state->data->thread_num; nt++)
             if (!state->data->env.add_thread())
                 state->data->thread_num = nt;
     }
+    state->data->init_time = kakadu_clock::now();
 
     state->data->msg = "Initialized Kakadu j2k decoder version " + std::string(kdu_core::kdu_get_core_version());
+    if (state->data->shared_pool)
+        state->data->msg += ", using shared thread pool of " + std::to_string(state->data->shared_pool->get_thread_num()) + " threads";
     return STATUS_OK;
 }
 
@@ -252,12 +449,21 @@ kakadu_close
 
     if (state->data)
     {
-        if (state->data->thread_num)
+        if (state->data->shared_pool)
+        {
+            kakadu_thread_pool::release(state->data->shared_pool);
+            state->data->shared_pool = NULL;
+        }
+        else if (state->data->thread_num)
             if (state->data->env.exists())
                 state->data->env.destroy();
 
+        if (state->data->codestream.exists()) state->data->codestream.destroy();
+        if (state->data->input) delete state->data->input;
         if (state->data->output_buffer) delete [] state->data->output_buffer;
         if (state->data->reorder_buffer) delete [] state->data->reorder_buffer;
+        if (state->data->stripe_buffer) delete [] state->data->stripe_buffer;
+        if (state->data->verify_buffer) delete [] state->data->verify_buffer;
         if(state->data) {
             delete state->data;
             state->data = nullptr;
@@ -276,9 +482,169 @@ prepare_output
     out->width = state->data->width;
     out->height = state->data->height;
     size_t plane_bytes = out->width*out->height*2;
+    size_t chroma_bytes = state->data->yuv_output ? ((out->width + 1)/2)*((out->height + 1)/2)*2 : plane_bytes;
     out->buffer[0] = state->data->output_buffer;
     out->buffer[1] = (char*)out->buffer[0] + plane_bytes;
-    out->buffer[2] = (char*)out->buffer[1] + plane_bytes;
+    out->buffer[2] = (char*)out->buffer[1] + chroma_bytes;
+}
+
+/* Converts RGB rows held in stripe buffer into 4:2:0 output, starting at even picture row */
+static
+void
+convert_stripe
+    (j2k_dec_kakadu_data_t* data
+    ,J2kDecOutput* out
+    ,int row
+    ,int rows
+    )
+{
+    size_t width = out->width;
+    size_t chroma_width = (width + 1)/2;
+    size_t plane_size = width*get_stripe_height(data);
+    const uint16_t* stripe = (const uint16_t*)data->stripe_buffer;
+    for (int r = 0; r < rows; r += 2)
+    {
+        const uint16_t* const src[3] = {stripe + r*width, stripe + plane_size + r*width, stripe + 2*plane_size + r*width};
+        size_t chroma_row = (size_t)(row + r)/2;
+        kakadu_rgb_to_yuv420(&data->yuv_matrix, cpu_level(), src, width, std::min(2, rows - r), (int)width
+                            ,(uint16_t*)out->buffer[0] + (row + r)*width, width
+                            ,(uint16_t*)out->buffer[1] + chroma_row*chroma_width
+                            ,(uint16_t*)out->buffer[2] + chroma_row*chroma_width);
+    }
+}
+
+/* Decodes picture prepared in instance's job on shared thread pool or on own threads */
+static
+void
+decode_job
+    (j2k_dec_kakadu_data_t* data
+    )
+{
+    if (data->shared_pool)
+        data->shared_pool->decode(&data->job);
+    else
+        kakadu_decode_local(&data->job, data->thread_num ? &data->env : NULL);
+}
+
+/* Decodes whole picture into 16-bit planar RGB buffer, used for verification */
+static
+void
+decode_rgb
+    (j2k_dec_kakadu_data_t* data
+    ,const J2kDecInput* in
+    ,bool force_precise
+    ,bool want_fastest
+    ,kdu_int16* buffer
+    )
+{
+    j2k_buffer input;
+    input.open(in->buffer, (kdu_long)in->size);
+    kdu_codestream codestream; codestream.create(&input);
+    codestream.apply_input_restrictions(0,MAX_PLANES,0,0,NULL);
+
+    kdu_dims dims;
+    codestream.get_dims(0,dims);
+
+    int bit_depth[] = {16, 16, 16};
+    bool is_signed[] = {false, false, false};
+    int stripe_heights[3] = {dims.size.y, dims.size.y, dims.size.y};
+    int plane_size = dims.size.x*dims.size.y;
+    int sample_offsets[3] = {0, plane_size, 2*plane_size};
+    int sample_gaps[3] = {1, 1, 1};
+
+    data->job.codestream = codestream;
+    data->job.force_precise = force_precise;
+    data->job.want_fastest = want_fastest;
+    data->job.pull = [&](kdu_stripe_decompressor& decompressor)
+    {
+        decompressor.pull_stripe(buffer, stripe_heights, sample_offsets, sample_gaps, NULL, bit_depth, is_signed);
+        return false;
+    };
+    decode_job(data);
+    codestream.destroy();
+}
+
+/* Compares picture decoded with selected 'decode_mode' against precise decoding */
+static
+void
+verify_frame
+    (j2k_dec_kakadu_data_t* data
+    ,const J2kDecInput* in
+    )
+{
+    size_t samples = data->width*data->height*MAX_PLANES;
+    if (NULL == data->verify_buffer)
+        data->verify_buffer = new kdu_int16[data->yuv_output ? 2*samples : samples];
+
+    const kdu_int16* tested = data->output_buffer;
+    kdu_int16* reference = data->verify_buffer;
+    if (data->yuv_output)
+    {
+        /* Output holds converted picture, so selected mode has to be decoded once more */
+        tested = data->verify_buffer + samples;
+        decode_rgb(data, in, data->force_precise, data->want_fastest, data->verify_buffer + samples);
+    }
+    decode_rgb(data, in, true, false, reference);
+
+    int max_error = 0;
+    uint64_t sum_error = 0;
+    const uint16_t* a = (const uint16_t*)tested;
+    const uint16_t* b = (const uint16_t*)reference;
+    for (size_t i = 0; i < samples; i++)
+    {
+        int error = std::abs((int)a[i] - (int)b[i]);
+        max_error = std::max(max_error, error);
+        sum_error += error;
+    }
+
+    data->verify_frames++;
+    data->verify_samples += samples;
+    data->verify_sum_error += sum_error;
+    data->verify_max_error = std::max(data->verify_max_error, max_error);
+    if (max_error >= QUANT_STEP_10BIT)
+    {
+        data->msg = "Decode mode error exceeds 10-bit quantization step, max abs error: " + std::to_string(max_error)
+                  + ", mean abs error: " + std::to_string((double)sum_error/samples);
+    }
+}
+
+static
+bool
+validate_header
+    (j2k_dec_kakadu_data_t* data
+    ,const kakadu_header_info& header
+    )
+{
+    if (header.components.size() != MAX_PLANES)
+    {
+        data->msg = "Picture must consist of 3 components.";
+        return false;
+    }
+    for (size_t c = 0; c < header.components.size(); c++)
+    {
+        if (header.components[c].x_subsampling != 1 || header.components[c].y_subsampling != 1)
+        {
+            data->msg = "Mismatching dimensions.";
+            return false;
+        }
+    }
+    if (header.width != data->width || header.height != data->height)
+    {
+        data->msg = "Picture size " + std::to_string(header.width) + "x" + std::to_string(header.height)
+                  + " does not match configured size " + std::to_string(data->width) + "x" + std::to_string(data->height) + ".";
+        return false;
+    }
+    return true;
+}
+
+Status
+kakadu_probe
+    (const J2kDecInput*     in
+    ,kakadu_header_info*    info
+    ,std::string*           error
+    )
+{
+    return kakadu_header_parse(in->buffer, in->size, info, error) ? STATUS_OK : STATUS_ERROR;
 }
 
 Status
@@ -291,60 +657,146 @@ kakadu_process
     j2k_dec_kakadu_t* state = (j2k_dec_kakadu_t*)handle;
     state->data->msg.clear();
 
-    j2k_buffer input;
-    input.open(in->buffer, (kdu_long)in->size);
-    kdu_codestream codestream; codestream.create(&input);
-    codestream.set_fussy();
-
-    int num_components = codestream.get_num_components();
-    if (num_components != 3)
+    /* Geometry is validated on main header only, so mismatching frames are rejected
+     * before codestream is created. Frames with main header identical to the last
+     * validated one skip validation and restart the existing codestream, which keeps
+     * its parameter and tile structures instead of building them again. */
+    size_t header_size;
+    if (!kakadu_header_scan(in->buffer, in->size, &header_size))
     {
-        state->data->msg = "Picture must consist of 3 components.";
+        state->data->msg = "Invalid J2K main header.";
         return STATUS_ERROR;
     }
+    const uint8_t* header_bytes = (const uint8_t*)in->buffer;
+    bool same_header = header_size == state->data->header_cache.size()
+                    && 0 == memcmp(header_bytes, state->data->header_cache.data(), header_size);
+    if (!same_header)
+    {
+        kakadu_header_info header;
+        if (!kakadu_header_parse(in->buffer, in->size, &header, &state->data->msg))
+            return STATUS_ERROR;
+        if (!validate_header(state->data, header))
+            return STATUS_ERROR;
+        state->data->header_cache.assign(header_bytes, header_bytes + header_size);
+    }
 
-    codestream.apply_input_restrictions(0,num_components,0,0,NULL);
-
-    kdu_dims dims0, dims1, dims2;
-    codestream.get_dims(0,dims0);
-    codestream.get_dims(1,dims1);
-    codestream.get_dims(2,dims2);
-
-    if (dims0 != dims1 || dims0 != dims2)
+    state->data->input->open(in->buffer, (kdu_long)in->size);
+    kdu_codestream& codestream = state->data->codestream;
+    if (same_header && codestream.exists())
     {
-        state->data->msg = "Mismatching dimensions.";
-        return STATUS_ERROR;
+        codestream.restart(state->data->input);
     }
+    else
+    {
+        if (codestream.exists())
+            codestream.destroy();
+        codestream.create(state->data->input);
+    }
+    codestream.set_fussy();
+    codestream.apply_input_restrictions(0,MAX_PLANES,0,0,NULL);
 
     int bit_depth[] = {16, 16, 16};
     bool is_signed[] = {false, false, false};
 
-    bool force_precise=true;
-    bool want_fastest=false;
-    kdu_stripe_decompressor decompressor;
-    if (state->data->thread_num)
-        decompressor.start(codestream, force_precise, want_fastest, &state->data->env);
-    else
-        decompressor.start(codestream, force_precise, want_fastest, NULL);
+    prepare_output(state, out);
 
-    int stripe_heights[3] = {dims0.size.y, dims1.size.y, dims2.size.y};
-    int sample_offsets[3] = {0, dims0.size.x*dims0.size.y, dims0.size.x*dims0.size.y + dims1.size.x*dims1.size.y};
+    /* Picture is pulled in horizontal stripes, so that stripe consumer can start
+     * working on the first rows while the remaining ones are still being decoded. */
+    j2k_dec_kakadu_data_t* data = state->data;
+    int width = (int)data->width;
+    int height = (int)data->height;
+    int stripe_height = get_stripe_height(data, height);
+    int plane_size = data->yuv_output ? width*stripe_height : width*height;
+    int sample_offsets[3] = {0, plane_size, 2*plane_size};
     int sample_gaps[3] = {1, 1, 1};
-    decompressor.pull_stripe(state->data->output_buffer,stripe_heights, sample_offsets, sample_gaps, NULL, bit_depth, is_signed);
-    decompressor.finish();
-    codestream.destroy();
-    prepare_output(state, out);
+    int row = 0;
+    data->job.codestream = codestream;
+    data->job.force_precise = data->force_precise;
+    data->job.want_fastest = data->want_fastest;
+    data->job.pull = [&](kdu_stripe_decompressor& decompressor)
+    {
+        int rows = std::min(stripe_height, height - row);
+        int stripe_heights[3] = {rows, rows, rows};
+        if (data->yuv_output)
+        {
+            decompressor.pull_stripe(data->stripe_buffer, stripe_heights, sample_offsets, sample_gaps, NULL, bit_depth, is_signed);
+            convert_stripe(data, out, row, rows);
+        }
+        else
+        {
+            decompressor.pull_stripe(data->output_buffer + (size_t)row*width, stripe_heights, sample_offsets, sample_gaps, NULL, bit_depth, is_signed);
+        }
+        if (data->stripe_callback)
+            data->stripe_callback(data->stripe_context, out, (size_t)row, (size_t)rows);
+        row += rows;
+        return row < height;
+    };
+    decode_job(data);
+
+    if (state->data->verify_interval && !state->data->force_precise
+        && 0 == state->data->frame_count % state->data->verify_interval)
+    {
+        verify_frame(state->data, in);
+    }
+    state->data->frame_count++;
+
+    return STATUS_OK;
+}
+
+Status
+kakadu_set_stripe_callback
+    (J2kDecHandle           handle      /**< [in/out] Decoder instance handle */
+    ,kakadu_stripe_callback callback    /**< [in] Function called after each decoded stripe, NULL to disable */
+    ,void*                  context     /**< [in] User context passed to callback */
+    )
+{
+    j2k_dec_kakadu_t* state = (j2k_dec_kakadu_t*)handle;
+    if (NULL == state || NULL == state->data)
+        return STATUS_ERROR;
 
+    state->data->stripe_callback = callback;
+    state->data->stripe_context = context;
     return STATUS_OK;
 }
 
 Status
 kakadu_get_property
-    (J2kDecHandle                /**< [in/out] Decoder instance handle */
-    , Property*                  /**< [in/out] Property to read */
+    (J2kDecHandle   handle      /**< [in/out] Decoder instance handle */
+    ,Property*      property    /**< [in/out] Property to read */
     )
 {
-    return STATUS_ERROR;
+    j2k_dec_kakadu_t* state = (j2k_dec_kakadu_t*)handle;
+    if (NULL == state || NULL == state->data || NULL == property->name)
+        return STATUS_ERROR;
+
+    std::string name(property->name);
+    std::string value;
+    if ("output_format" == name)
+        value = state->data->yuv_output ? "yuv420p10" : "rgb48";
+    else if ("shared_thread_num" == name)
+        value = std::to_string(state->data->shared_pool ? state->data->shared_pool->get_thread_num() : 0);
+    else if ("shared_queue_depth" == name)
+        value = std::to_string(state->data->shared_pool ? state->data->shared_pool->get_queue_depth() : 0);
+    else if ("shared_utilization" == name)
+    {
+        double elapsed = std::chrono::duration<double>(kakadu_clock::now() - state->data->init_time).count();
+        value = std::to_string(elapsed > 0 ? 100.0*state->data->job.busy_seconds/elapsed : 0.0);
+    }
+    else if ("shared_wait_ms" == name)
+        value = std::to_string(1000.0*state->data->job.wait_seconds);
+    else if ("verify_max_error" == name)
+        value = std::to_string(state->data->verify_max_error);
+    else if ("verify_mean_error" == name)
+        value = std::to_string(state->data->verify_samples ? (double)state->data->verify_sum_error/state->data->verify_samples : 0.0);
+    else if ("verify_within_10bit" == name)
+        value = (state->data->verify_frames && state->data->verify_max_error < QUANT_STEP_10BIT) ? "true" : "false";
+    else
+        return STATUS_ERROR;
+
+    if (value.size() >= property->maxValueSz)
+        return STATUS_ERROR;
+    strcpy(property->value, value.c_str());
+    return STATUS_OK;
 }
 
 const char*
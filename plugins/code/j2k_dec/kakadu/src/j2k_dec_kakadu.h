@@ -1,4 +1,17 @@
 #include "j2k_dec_api.h"
+#include "j2k_dec_kakadu_header.h"
+
+/** @brief Stripe completion callback
+ *  Called from kakadu_process after rows [first_row, first_row + num_rows) of all
+ *  planes pointed by 'out' have been decoded. Rows outside this range may not be valid yet.
+ *  With 'shared_threads' it is called on the pool driver thread while kakadu_process waits.
+ */
+typedef void (*kakadu_stripe_callback)
+    (void*                  context     /**< [in] User context passed to kakadu_set_stripe_callback */
+    ,const J2kDecOutput*    out         /**< [in] Decoded output, being filled */
+    ,size_t                 first_row   /**< [in] First completed row */
+    ,size_t                 num_rows    /**< [in] Number of completed rows */
+    );
 
 size_t
 kakadu_get_info
@@ -25,6 +38,25 @@ kakadu_process
     ,J2kDecOutput*          out     /**< [out] Decoded output */
     );
 
+/** @brief Reads picture parameters from codestream main header without decoding
+ *  Can be used to size buffers before decoder instance is initialized.
+ *  Internal to code linking dee_plugin_j2k_dec_kakadu_base statically. It is not part of
+ *  J2kDecApi, so the framework cannot call it on the plugin library.
+ */
+Status
+kakadu_probe
+    (const J2kDecInput*     in      /**< [in] Encoded input */
+    ,kakadu_header_info*    info    /**< [out] Main header parameters */
+    ,std::string*           error   /**< [out] Error description */
+    );
+
+Status
+kakadu_set_stripe_callback
+    (J2kDecHandle           handle      /**< [in/out] Decoder instance handle */
+    ,kakadu_stripe_callback callback    /**< [in] Function called after each decoded stripe, NULL to disable */
+    ,void*                  context     /**< [in] User context passed to callback */
+    );
+
 Status
 kakadu_get_property
     (J2kDecHandle                /**< [in/out] Decoder instance handle */
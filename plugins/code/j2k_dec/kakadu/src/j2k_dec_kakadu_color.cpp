@@ -0,0 +1,255 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2019, Dolby Laboratories
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+*   list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+*   this list of conditions and the following disclaimer in the documentation
+*   and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+*   contributors may be used to endorse or promote products derived from
+*   this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "j2k_dec_kakadu_color.h"
+
+#include <math.h>
+
+/* Coefficients are scaled by 2^COLOR_SHIFT. With 16-bit input and 10-bit output
+ * every intermediate sum stays within signed 32-bit range. */
+#define COLOR_SHIFT (20)
+#define COLOR_MAX (1023)
+
+static
+int32_t
+fixed
+    (double value)
+{
+    return (int32_t)floor(value * (1 << COLOR_SHIFT) + 0.5);
+}
+
+void
+kakadu_yuv_matrix_init
+    (kakadu_yuv_matrix* matrix
+    ,bool bt2020
+    ,bool full_range
+    )
+{
+    const double kr = bt2020 ? 0.2627 : 0.2126;
+    const double kb = bt2020 ? 0.0593 : 0.0722;
+    const double kg = 1.0 - kr - kb;
+
+    const double y_scale = (full_range ? 1023.0 : 876.0) / 65535.0;
+    const double c_scale = (full_range ? 1023.0 : 896.0) / 65535.0;
+    const double y_base = full_range ? 0.0 : 64.0;
+
+    matrix->y[0] = fixed(kr * y_scale);
+    matrix->y[1] = fixed(kg * y_scale);
+    matrix->y[2] = fixed(kb * y_scale);
+
+    const double cb_div = 2.0 * (1.0 - kb);
+    matrix->cb[0] = fixed(-kr / cb_div * c_scale);
+    matrix->cb[1] = fixed(-kg / cb_div * c_scale);
+    matrix->cb[2] = fixed((1.0 - kb) / cb_div * c_scale);
+
+    const double cr_div = 2.0 * (1.0 - kr);
+    matrix->cr[0] = fixed((1.0 - kr) / cr_div * c_scale);
+    matrix->cr[1] = fixed(-kg / cr_div * c_scale);
+    matrix->cr[2] = fixed(-kb / cr_div * c_scale);
+
+    matrix->y_offset = fixed(y_base) + (1 << (COLOR_SHIFT - 1));
+    matrix->c_offset = fixed(512.0) + (1 << (COLOR_SHIFT - 1));
+}
+
+static inline
+uint16_t
+apply
+    (const int32_t* coef
+    ,int32_t offset
+    ,int32_t r
+    ,int32_t g
+    ,int32_t b
+    )
+{
+    int32_t v = (coef[0]*r + coef[1]*g + coef[2]*b + offset) >> COLOR_SHIFT;
+    return (uint16_t)(v < 0 ? 0 : (v > COLOR_MAX ? COLOR_MAX : v));
+}
+
+static
+void
+rgb_to_yuv420_scalar
+    (const kakadu_yuv_matrix* m
+    ,const uint16_t* const r[2]
+    ,const uint16_t* const g[2]
+    ,const uint16_t* const b[2]
+    ,int x
+    ,int width
+    ,uint16_t* const y[2]
+    ,uint16_t* cb
+    ,uint16_t* cr
+    )
+{
+    for (; x < width; x += 2)
+    {
+        int x1 = (x + 1 < width) ? x + 1 : x;
+        for (int row = 0; row < 2; row++)
+        {
+            y[row][x] = apply(m->y, m->y_offset, r[row][x], g[row][x], b[row][x]);
+            if (x1 != x)
+                y[row][x1] = apply(m->y, m->y_offset, r[row][x1], g[row][x1], b[row][x1]);
+        }
+        int32_t ra = (r[0][x] + r[0][x1] + r[1][x] + r[1][x1] + 2) >> 2;
+        int32_t ga = (g[0][x] + g[0][x1] + g[1][x] + g[1][x1] + 2) >> 2;
+        int32_t ba = (b[0][x] + b[0][x1] + b[1][x] + b[1][x1] + 2) >> 2;
+        cb[x/2] = apply(m->cb, m->c_offset, ra, ga, ba);
+        cr[x/2] = apply(m->cr, m->c_offset, ra, ga, ba);
+    }
+}
+
+#if defined(DLB_X86)
+DLB_TARGET_AVX2
+static inline
+__m256i
+apply_avx2
+    (const __m256i coef[3]
+    ,__m256i offset
+    ,__m256i r
+    ,__m256i g
+    ,__m256i b
+    )
+{
+    __m256i v = _mm256_add_epi32(_mm256_mullo_epi32(coef[0], r), offset);
+    v = _mm256_add_epi32(v, _mm256_mullo_epi32(coef[1], g));
+    v = _mm256_add_epi32(v, _mm256_mullo_epi32(coef[2], b));
+    return _mm256_srai_epi32(v, COLOR_SHIFT);
+}
+
+/* Packs two vectors of 8 x int32 into 16 x uint16 clipped to [0, COLOR_MAX], in order */
+DLB_TARGET_AVX2
+static inline
+__m256i
+pack_clip_avx2
+    (__m256i lo
+    ,__m256i hi
+    )
+{
+    __m256i v = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+    return _mm256_min_epu16(v, _mm256_set1_epi16(COLOR_MAX));
+}
+
+/* Sums horizontally adjacent pairs of 16 x uint16 into 8 x int32 */
+DLB_TARGET_AVX2
+static inline
+__m256i
+pair_sum_avx2
+    (__m256i v
+    )
+{
+    const __m256i mask = _mm256_set1_epi32(0xFFFF);
+    return _mm256_add_epi32(_mm256_and_si256(v, mask), _mm256_srli_epi32(v, 16));
+}
+
+DLB_TARGET_AVX2
+static
+int
+rgb_to_yuv420_avx2
+    (const kakadu_yuv_matrix* m
+    ,const uint16_t* const r[2]
+    ,const uint16_t* const g[2]
+    ,const uint16_t* const b[2]
+    ,int width
+    ,uint16_t* const y[2]
+    ,uint16_t* cb
+    ,uint16_t* cr
+    )
+{
+    const __m256i cy[3] = {_mm256_set1_epi32(m->y[0]), _mm256_set1_epi32(m->y[1]), _mm256_set1_epi32(m->y[2])};
+    const __m256i ccb[3] = {_mm256_set1_epi32(m->cb[0]), _mm256_set1_epi32(m->cb[1]), _mm256_set1_epi32(m->cb[2])};
+    const __m256i ccr[3] = {_mm256_set1_epi32(m->cr[0]), _mm256_set1_epi32(m->cr[1]), _mm256_set1_epi32(m->cr[2])};
+    const __m256i yoff = _mm256_set1_epi32(m->y_offset);
+    const __m256i coff = _mm256_set1_epi32(m->c_offset);
+    const __m256i two = _mm256_set1_epi32(2);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i rsum = two, gsum = two, bsum = two;
+        for (int row = 0; row < 2; row++)
+        {
+            __m256i rv = _mm256_loadu_si256((const __m256i*)(r[row] + x));
+            __m256i gv = _mm256_loadu_si256((const __m256i*)(g[row] + x));
+            __m256i bv = _mm256_loadu_si256((const __m256i*)(b[row] + x));
+
+            __m256i lo = apply_avx2(cy, yoff,
+                                    _mm256_cvtepu16_epi32(_mm256_castsi256_si128(rv)),
+                                    _mm256_cvtepu16_epi32(_mm256_castsi256_si128(gv)),
+                                    _mm256_cvtepu16_epi32(_mm256_castsi256_si128(bv)));
+            __m256i hi = apply_avx2(cy, yoff,
+                                    _mm256_cvtepu16_epi32(_mm256_extracti128_si256(rv, 1)),
+                                    _mm256_cvtepu16_epi32(_mm256_extracti128_si256(gv, 1)),
+                                    _mm256_cvtepu16_epi32(_mm256_extracti128_si256(bv, 1)));
+            _mm256_storeu_si256((__m256i*)(y[row] + x), pack_clip_avx2(lo, hi));
+
+            rsum = _mm256_add_epi32(rsum, pair_sum_avx2(rv));
+            gsum = _mm256_add_epi32(gsum, pair_sum_avx2(gv));
+            bsum = _mm256_add_epi32(bsum, pair_sum_avx2(bv));
+        }
+        __m256i ra = _mm256_srli_epi32(rsum, 2);
+        __m256i ga = _mm256_srli_epi32(gsum, 2);
+        __m256i ba = _mm256_srli_epi32(bsum, 2);
+        __m256i cbv = pack_clip_avx2(apply_avx2(ccb, coff, ra, ga, ba), apply_avx2(ccr, coff, ra, ga, ba));
+        _mm_storeu_si128((__m128i*)(cb + x/2), _mm256_castsi256_si128(cbv));
+        _mm_storeu_si128((__m128i*)(cr + x/2), _mm256_extracti128_si256(cbv, 1));
+    }
+    return x;
+}
+#endif
+
+void
+kakadu_rgb_to_yuv420
+    (const kakadu_yuv_matrix* matrix
+    ,CpuLevel level
+    ,const uint16_t* const src[3]
+    ,size_t src_stride
+    ,int rows
+    ,int width
+    ,uint16_t* dst_y
+    ,size_t dst_y_stride
+    ,uint16_t* dst_cb
+    ,uint16_t* dst_cr
+    )
+{
+    size_t next = (rows > 1) ? src_stride : 0;
+    const uint16_t* const r[2] = {src[0], src[0] + next};
+    const uint16_t* const g[2] = {src[1], src[1] + next};
+    const uint16_t* const b[2] = {src[2], src[2] + next};
+    /* Single row is converted twice into the same destination */
+    uint16_t* const y[2] = {dst_y, dst_y + ((rows > 1) ? dst_y_stride : 0)};
+
+    int x = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX2)
+        x = rgb_to_yuv420_avx2(matrix, r, g, b, width, y, dst_cb, dst_cr);
+#else
+    (void)level;
+#endif
+    rgb_to_yuv420_scalar(matrix, r, g, b, x, width, y, dst_cb, dst_cr);
+}
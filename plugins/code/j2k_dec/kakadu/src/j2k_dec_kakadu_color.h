@@ -0,0 +1,44 @@
+#ifndef __DEE_PLUGINS_J2K_DEC_KAKADU_COLOR_H__
+#define __DEE_PLUGINS_J2K_DEC_KAKADU_COLOR_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "plugins_cpu.h"
+
+/** @brief Fixed-point R'G'B' (16 bits) to Y'CbCr (10 bits) conversion matrix */
+struct kakadu_yuv_matrix
+{
+    int32_t     y[3];       /**< Luma coefficients for R, G, B */
+    int32_t     cb[3];      /**< Cb coefficients for R, G, B */
+    int32_t     cr[3];      /**< Cr coefficients for R, G, B */
+    int32_t     y_offset;   /**< Luma offset, including rounding */
+    int32_t     c_offset;   /**< Chroma offset, including rounding */
+};
+
+void
+kakadu_yuv_matrix_init
+    (kakadu_yuv_matrix* matrix  /**< [out] Matrix to initialize */
+    ,bool bt2020                /**< [in] BT.2020 coefficients if true, BT.709 otherwise */
+    ,bool full_range            /**< [in] Full range output if true, limited range otherwise */
+    );
+
+/** @brief Converts one or two rows of planar RGB into 4:2:0 planar YUV
+ *  Chroma is the average of 2x2 neighbourhood. When 'rows' is 1, the single row is
+ *  treated as if it was repeated. Odd width is handled by repeating the last column.
+ */
+void
+kakadu_rgb_to_yuv420
+    (const kakadu_yuv_matrix* matrix
+    ,CpuLevel level             /**< [in] Highest instruction set that may be used */
+    ,const uint16_t* const src[3] /**< [in] First row of R, G and B planes */
+    ,size_t src_stride          /**< [in] Distance between rows, in samples */
+    ,int rows                   /**< [in] 1 or 2 */
+    ,int width
+    ,uint16_t* dst_y            /**< [out] First luma row */
+    ,size_t dst_y_stride        /**< [in] Distance between luma rows, in samples */
+    ,uint16_t* dst_cb           /**< [out] Cb row, (width + 1) / 2 samples */
+    ,uint16_t* dst_cr           /**< [out] Cr row, (width + 1) / 2 samples */
+    );
+
+#endif // __DEE_PLUGINS_J2K_DEC_KAKADU_COLOR_H__
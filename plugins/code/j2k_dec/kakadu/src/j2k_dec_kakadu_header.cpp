@@ -0,0 +1,184 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2019, Dolby Laboratories
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+*   list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+*   this list of conditions and the following disclaimer in the documentation
+*   and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+*   contributors may be used to endorse or promote products derived from
+*   this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "j2k_dec_kakadu_header.h"
+
+#define MARKER_SOC (0xFF4F)
+#define MARKER_SIZ (0xFF51)
+#define MARKER_COD (0xFF52)
+#define MARKER_SOT (0xFF90)
+#define MARKER_SOD (0xFF93)
+
+static inline
+unsigned
+read16
+    (const uint8_t* p)
+{
+    return ((unsigned)p[0] << 8) | p[1];
+}
+
+static inline
+uint32_t
+read32
+    (const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/* Markers 0xFF30 - 0xFF3F carry no marker segment */
+static inline
+bool
+has_segment
+    (unsigned marker)
+{
+    return (marker & 0xFFF0) != 0xFF30;
+}
+
+bool
+kakadu_header_scan
+    (const void* buffer
+    ,size_t size
+    ,size_t* header_size
+    )
+{
+    const uint8_t* data = (const uint8_t*)buffer;
+    if (size < 4 || read16(data) != MARKER_SOC || read16(data + 2) != MARKER_SIZ)
+        return false;
+
+    size_t pos = 2;
+    for (;;)
+    {
+        if (pos + 2 > size)
+            return false;
+        unsigned marker = read16(data + pos);
+        if ((marker & 0xFF00) != 0xFF00 || MARKER_SOD == marker)
+            return false;
+        if (MARKER_SOT == marker)
+            break;
+        pos += 2;
+        if (has_segment(marker))
+        {
+            if (pos + 2 > size)
+                return false;
+            unsigned length = read16(data + pos);
+            if (length < 2)
+                return false;
+            pos += length;
+        }
+    }
+
+    *header_size = pos;
+    return true;
+}
+
+bool
+kakadu_header_parse
+    (const void* buffer
+    ,size_t size
+    ,kakadu_header_info* info
+    ,std::string* error
+    )
+{
+    const uint8_t* data = (const uint8_t*)buffer;
+    if (!kakadu_header_scan(buffer, size, &info->header_size))
+    {
+        *error = "Invalid J2K main header.";
+        return false;
+    }
+
+    /* SIZ directly follows SOC, scan has verified that */
+    const uint8_t* siz = data + 4;
+    unsigned lsiz = read16(siz);
+    if (lsiz < 41 || 4 + lsiz > info->header_size)
+    {
+        *error = "Invalid SIZ marker segment.";
+        return false;
+    }
+    uint32_t xsiz = read32(siz + 4);
+    uint32_t ysiz = read32(siz + 8);
+    uint32_t xosiz = read32(siz + 12);
+    uint32_t yosiz = read32(siz + 16);
+    unsigned csiz = read16(siz + 36);
+    if (xosiz >= xsiz || yosiz >= ysiz || csiz == 0 || lsiz != 38 + 3*csiz)
+    {
+        *error = "Invalid SIZ marker segment.";
+        return false;
+    }
+    info->width = xsiz - xosiz;
+    info->height = ysiz - yosiz;
+    info->tile_width = read32(siz + 20);
+    info->tile_height = read32(siz + 24);
+    info->components.resize(csiz);
+    for (unsigned c = 0; c < csiz; c++)
+    {
+        const uint8_t* comp = siz + 38 + 3*c;
+        info->components[c].precision = (comp[0] & 0x7F) + 1;
+        info->components[c].is_signed = (comp[0] & 0x80) != 0;
+        info->components[c].x_subsampling = comp[1];
+        info->components[c].y_subsampling = comp[2];
+        if (0 == comp[1] || 0 == comp[2])
+        {
+            *error = "Invalid component subsampling.";
+            return false;
+        }
+    }
+
+    info->has_cod = false;
+    size_t pos = 4 + lsiz;
+    while (pos < info->header_size)
+    {
+        unsigned marker = read16(data + pos);
+        pos += 2;
+        if (!has_segment(marker))
+            continue;
+        unsigned length = read16(data + pos);
+        if (MARKER_COD == marker)
+        {
+            if (length < 12)
+            {
+                *error = "Invalid COD marker segment.";
+                return false;
+            }
+            const uint8_t* cod = data + pos;
+            info->has_cod = true;
+            info->progression = cod[3];
+            info->layers = (int)read16(cod + 4);
+            info->mct = cod[6] != 0;
+            info->levels = cod[7];
+            info->codeblock_width = 1 << ((cod[8] & 0x0F) + 2);
+            info->codeblock_height = 1 << ((cod[9] & 0x0F) + 2);
+            info->reversible = (1 == cod[11]);
+        }
+        pos += length;
+    }
+
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef __DEE_PLUGINS_J2K_DEC_KAKADU_HEADER_H__
+#define __DEE_PLUGINS_J2K_DEC_KAKADU_HEADER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/** @brief Component parameters from SIZ marker */
+struct kakadu_component_info
+{
+    int         precision;      /**< Bits per sample */
+    bool        is_signed;
+    int         x_subsampling;  /**< XRsiz */
+    int         y_subsampling;  /**< YRsiz */
+};
+
+/** @brief Codestream main header parameters (SIZ and COD markers) */
+struct kakadu_header_info
+{
+    size_t      header_size;    /**< Bytes from SOC up to first SOT marker */
+
+    size_t      width;          /**< Xsiz - XOsiz */
+    size_t      height;         /**< Ysiz - YOsiz */
+    size_t      tile_width;     /**< XTsiz */
+    size_t      tile_height;    /**< YTsiz */
+    std::vector<kakadu_component_info> components;
+
+    bool        has_cod;        /**< Following fields are valid only if COD marker was found */
+    int         progression;    /**< Progression order (0 = LRCP ... 4 = CPRL) */
+    int         layers;
+    bool        mct;            /**< Multiple component transform used */
+    int         levels;         /**< Number of decomposition levels */
+    int         codeblock_width;
+    int         codeblock_height;
+    bool        reversible;     /**< 5-3 reversible wavelet transform */
+};
+
+/** @brief Locates end of main header
+ *  Only marker lengths are read, so this is cheap enough to run on every frame.
+ *  @return false if buffer does not start with a valid main header
+ */
+bool
+kakadu_header_scan
+    (const void* buffer         /**< [in] J2K codestream */
+    ,size_t size                /**< [in] Codestream size */
+    ,size_t* header_size        /**< [out] Size of main header */
+    );
+
+/** @brief Parses SIZ and COD markers of main header
+ *  @return false if header is malformed, 'error' describes the problem
+ */
+bool
+kakadu_header_parse
+    (const void* buffer         /**< [in] J2K codestream */
+    ,size_t size                /**< [in] Codestream size */
+    ,kakadu_header_info* info   /**< [out] Parsed parameters */
+    ,std::string* error         /**< [out] Error description */
+    );
+
+#endif // __DEE_PLUGINS_J2K_DEC_KAKADU_HEADER_H__
@@ -0,0 +1,192 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2019, Dolby Laboratories
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+*   list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+*   this list of conditions and the following disclaimer in the documentation
+*   and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+*   contributors may be used to endorse or promote products derived from
+*   this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "j2k_dec_kakadu_pool.h"
+
+#include <algorithm>
+
+using namespace kdu_core;
+using namespace kdu_supp;
+
+void
+kakadu_decode_local
+    (kakadu_decode_job* job
+    ,kdu_thread_env* env
+    )
+{
+    job->decompressor.start(job->codestream, job->force_precise, job->want_fastest, env);
+    while (job->pull(job->decompressor))
+        ;
+    job->decompressor.finish();
+}
+
+std::mutex kakadu_thread_pool::s_mutex;
+kakadu_thread_pool* kakadu_thread_pool::s_instance = NULL;
+int kakadu_thread_pool::s_ref_count = 0;
+
+kakadu_thread_pool*
+kakadu_thread_pool::acquire
+    (int thread_num
+    )
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (NULL == s_instance)
+    {
+        if (0 == thread_num)
+            thread_num = (int)std::max(1u, std::thread::hardware_concurrency());
+        s_instance = new kakadu_thread_pool(thread_num);
+    }
+    s_ref_count++;
+    return s_instance;
+}
+
+void
+kakadu_thread_pool::release
+    (kakadu_thread_pool* pool
+    )
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (pool != s_instance || 0 == s_ref_count)
+        return;
+    if (0 == --s_ref_count)
+    {
+        delete s_instance;
+        s_instance = NULL;
+    }
+}
+
+kakadu_thread_pool::kakadu_thread_pool
+    (int thread_num
+    )
+    : m_ready(false)
+    , m_stop(false)
+    , m_thread_num(0)
+    , m_queue_depth(0)
+{
+    m_driver = std::thread(&kakadu_thread_pool::drive, this, thread_num);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_completed.wait(lock, [this] { return m_ready; });
+}
+
+kakadu_thread_pool::~kakadu_thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_submitted.notify_one();
+    m_driver.join();
+}
+
+void
+kakadu_thread_pool::decode
+    (kakadu_decode_job* job
+    )
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    job->done = false;
+    job->submit_time = kakadu_clock::now();
+    m_pending.push_back(job);
+    m_queue_depth++;
+    m_submitted.notify_one();
+    m_completed.wait(lock, [job] { return job->done; });
+}
+
+/* Driver thread: the only thread that touches the environment */
+void
+kakadu_thread_pool::drive
+    (int thread_num
+    )
+{
+    kdu_thread_env env;
+    env.create();
+    for (int nt = 1; nt < thread_num; nt++)
+        if (!env.add_thread())
+            break;
+
+    std::vector<kakadu_decode_job*> active;
+    std::vector<kakadu_decode_job*> starting;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_thread_num = env.get_num_threads();
+    m_ready = true;
+    m_completed.notify_all();
+
+    for (;;)
+    {
+        if (active.empty())
+            m_submitted.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+        if (active.empty() && m_pending.empty())
+            break;
+        starting.swap(m_pending);
+        lock.unlock();
+
+        for (size_t i = 0; i < starting.size(); i++)
+        {
+            kakadu_decode_job* job = starting[i];
+            job->start_time = kakadu_clock::now();
+            job->wait_seconds += std::chrono::duration<double>(job->start_time - job->submit_time).count();
+            env.attach_queue(&job->queue, NULL, "j2k_dec_kakadu");
+            job->decompressor.start(job->codestream, job->force_precise, job->want_fastest, &env, &job->queue);
+            active.push_back(job);
+        }
+        starting.clear();
+
+        /* One stripe of every active picture per round, so that all instances make progress
+         * while pool threads work on queued jobs of all of them */
+        std::vector<kakadu_decode_job*> completed;
+        for (size_t i = 0; i < active.size();)
+        {
+            kakadu_decode_job* job = active[i];
+            if (job->pull(job->decompressor))
+            {
+                i++;
+                continue;
+            }
+            job->decompressor.finish();
+            env.join(&job->queue);
+            job->busy_seconds += std::chrono::duration<double>(kakadu_clock::now() - job->start_time).count();
+            completed.push_back(job);
+            active.erase(active.begin() + i);
+        }
+
+        lock.lock();
+        for (size_t i = 0; i < completed.size(); i++)
+        {
+            completed[i]->done = true;
+            m_queue_depth--;
+        }
+        if (!completed.empty())
+            m_completed.notify_all();
+    }
+    lock.unlock();
+
+    env.destroy();
+}
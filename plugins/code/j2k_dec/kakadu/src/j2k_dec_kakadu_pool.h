@@ -0,0 +1,127 @@
+/*
+* BSD 3-Clause License
+*
+* Copyright (c) 2017-2019, Dolby Laboratories
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice, this
+*   list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+*   this list of conditions and the following disclaimer in the documentation
+*   and/or other materials provided with the distribution.
+*
+* * Neither the name of the copyright holder nor the names of its
+*   contributors may be used to endorse or promote products derived from
+*   this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef __DEE_PLUGINS_J2K_DEC_KAKADU_POOL_H__
+#define __DEE_PLUGINS_J2K_DEC_KAKADU_POOL_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32 // suppress windows kdu warnings
+    #pragma warning(push)
+    #pragma warning(disable: 4458) // declaration of '...' hides class member
+    #pragma warning(disable: 4100) // '...': unreferenced formal parameter
+#endif  //_WIN32
+#include "kdu_compressed.h"
+#include "kdu_stripe_decompressor.h"
+#ifdef _WIN32
+    #pragma warning(pop)
+#endif
+
+typedef std::chrono::steady_clock kakadu_clock;
+
+/** @brief Decoding of one picture, pulled stripe by stripe
+ *  Owned by decoder instance and reused for every picture it decodes.
+ */
+struct kakadu_decode_job
+{
+    kakadu_decode_job() : force_precise(true), want_fastest(false), done(false), wait_seconds(0), busy_seconds(0) {}
+
+    kdu_core::kdu_codestream            codestream;     /**< [in] Codestream to decode */
+    bool                                force_precise;  /**< [in] Passed to kdu_stripe_decompressor::start */
+    bool                                want_fastest;   /**< [in] Passed to kdu_stripe_decompressor::start */
+    /** [in] Pulls next stripe, returns false when the picture is complete */
+    std::function<bool(kdu_supp::kdu_stripe_decompressor&)> pull;
+
+    kdu_supp::kdu_stripe_decompressor   decompressor;
+    kdu_core::kdu_thread_queue          queue;          /**< Instance queue in shared thread environment */
+    bool                                done;
+    kakadu_clock::time_point            submit_time;
+    kakadu_clock::time_point            start_time;
+    double                              wait_seconds;   /**< Total time spent waiting for shared thread pool */
+    double                              busy_seconds;   /**< Total time spent decoding on shared thread pool */
+};
+
+/** @brief Decodes picture on calling thread, using environment owned by this thread or no threads if NULL */
+void
+kakadu_decode_local
+    (kakadu_decode_job* job
+    ,kdu_core::kdu_thread_env* env
+    );
+
+/** @brief Process-wide, reference-counted Kakadu thread pool shared by decoder instances
+ *  kdu_thread_env may only be driven by the thread that created it, so the environment is
+ *  created, used and destroyed by one driver thread. Instances hand their pictures to the
+ *  driver and wait for them. Every picture is decoded through the instance's own
+ *  kdu_thread_queue and the driver pulls one stripe of each active picture in turn, so
+ *  pictures of different instances are decoded concurrently by the pool threads.
+ *  Threads are not pinned to cores or NUMA nodes.
+ */
+class kakadu_thread_pool
+{
+    public:
+        /** @brief Returns the process pool, created with 'thread_num' threads (0 = logical CPUs) if it does not exist */
+        static kakadu_thread_pool* acquire(int thread_num);
+        static void release(kakadu_thread_pool* pool);
+
+        /** @brief Decodes picture on the pool, returns when it is complete */
+        void decode(kakadu_decode_job* job);
+
+        int get_thread_num() const { return m_thread_num; }
+        /** @brief Number of pictures waiting for or being decoded on the pool */
+        int get_queue_depth() const { return m_queue_depth.load(); }
+
+    private:
+        explicit kakadu_thread_pool(int thread_num);
+        ~kakadu_thread_pool();
+        void drive(int thread_num);
+
+        static std::mutex               s_mutex;
+        static kakadu_thread_pool*      s_instance;
+        static int                      s_ref_count;
+
+        std::thread                     m_driver;
+        std::mutex                      m_mutex;
+        std::condition_variable         m_submitted;
+        std::condition_variable         m_completed;
+        std::vector<kakadu_decode_job*> m_pending;
+        bool                            m_ready;
+        bool                            m_stop;
+        int                             m_thread_num;
+        std::atomic<int>                m_queue_depth;
+};
+
+#endif // __DEE_PLUGINS_J2K_DEC_KAKADU_POOL_H__
@@ -0,0 +1,129 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Compares deinterleave kernels of every supported instruction set level with
+ * the per-sample loop they replaced, on 16-bit frames of common sizes.
+ * Usage: tiff_dec_libtiff_kernels_bench [repetitions]
+ */
+
+#include "tiff_dec_libtiff_kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct frame_size_t {
+    const char* name;
+    size_t width;
+    size_t height;
+};
+
+static const frame_size_t frame_sizes[] = {
+    {"HD", 1920, 1080},
+    {"4K", 3840, 2160},
+    {"8K", 7680, 4320},
+};
+
+/* Loop used before the kernels, kept as the baseline */
+static void deinterleave_loop(const uint16_t* line, size_t width, int nsamples, uint16_t** plane) {
+    for (size_t i = 0; i < width; i++)
+        for (int s = 0; s < nsamples; s++)
+            *(plane[s]++) = line[(i * nsamples) + s];
+}
+
+/* Returns fastest of 'reps' runs in milliseconds, fastest run is least disturbed by other load */
+template <typename F> static double fastest_ms(int reps, F run) {
+    double best = 0;
+    for (int r = 0; r < reps; r++) {
+        bench_clock::time_point start = bench_clock::now();
+        run();
+        double ms = std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+        if (0 == r || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int reps = argc > 1 ? std::atoi(argv[1]) : 10;
+    if (reps < 1) {
+        fprintf(stderr, "Invalid repetition count: %s\n", argv[1]);
+        return 1;
+    }
+    int failures = 0;
+    printf("%-4s %-8s %-8s %10s %8s %8s\n", "size", "samples", "kernel", "ms/frame", "GB/s", "speedup");
+    for (const frame_size_t& size : frame_sizes) {
+        for (int nsamples = 3; nsamples <= 4; nsamples++) {
+            const size_t pixels = size.width * size.height;
+            const double bytes = (double)(2 * pixels * nsamples * sizeof(uint16_t));
+            std::vector<uint16_t> src(pixels * nsamples);
+            for (size_t i = 0; i < src.size(); i++)
+                src[i] = (uint16_t)(i * 2654435761u >> 16);
+            std::vector<uint16_t> expected(pixels * nsamples);
+            std::vector<uint16_t> planes(pixels * nsamples);
+
+            const double loopMs = fastest_ms(reps, [&]() {
+                uint16_t* plane[4];
+                for (int s = 0; s < nsamples; s++)
+                    plane[s] = expected.data() + s * pixels;
+                for (size_t y = 0; y < size.height; y++)
+                    deinterleave_loop(src.data() + y * size.width * nsamples, size.width, nsamples, plane);
+            });
+            printf("%-4s %-8d %-8s %10.3f %8.2f %8.2f\n", size.name, nsamples, "loop", loopMs, bytes / loopMs / 1e6,
+                   1.0);
+
+            for (int level = CPU_LEVEL_SCALAR; level <= cpu_level(); level++) {
+                memset(planes.data(), 0, planes.size() * sizeof(uint16_t));
+                const double ms = fastest_ms(reps, [&]() {
+                    for (size_t y = 0; y < size.height; y++) {
+                        uint16_t* const dst[4] = {planes.data() + y * size.width,
+                                                  planes.data() + pixels + y * size.width,
+                                                  planes.data() + 2 * pixels + y * size.width,
+                                                  planes.data() + 3 * pixels + y * size.width};
+                        deinterleave_u16((CpuLevel)level, src.data() + y * size.width * nsamples, size.width,
+                                         nsamples, dst);
+                    }
+                });
+                const bool same = planes == expected;
+                printf("%-4s %-8d %-8s %10.3f %8.2f %8.2f%s\n", size.name, nsamples, cpu_level_name((CpuLevel)level),
+                       ms, bytes / ms / 1e6, loopMs / ms, same ? "" : "  MISMATCH");
+                if (!same)
+                    failures++;
+            }
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -30,7 +30,11 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
+#include <cerrno>
+#include <climits>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
@@ -40,7 +44,11 @@
 #include <string>
 #include <vector>
 
+#include "plugins_threads.h"
 #include "tiff_dec_api.h"
+#include "tiff_dec_libtiff_buffer.h"
+#include "tiff_dec_libtiff_kernels.h"
+#include "tiff_dec_libtiff_queue.h"
 #include "tiffio.h"
 
 static const int temp_file_num = 0;
@@ -51,6 +59,26 @@ static const PropertyInfo tiff_dec_libtiff_info[] = {
      temp_file_num_str.c_str(), NULL, 0, 1, ACCESS_TYPE_READ},
     {"temp_file", PROPERTY_TYPE_INTEGER, "Path to temp file.", NULL, NULL, temp_file_num, temp_file_num,
      ACCESS_TYPE_WRITE_INIT},
+    {"simd", PROPERTY_TYPE_STRING, "Instruction set used by conversion kernels, limited to what the CPU supports.",
+     "auto", "auto:scalar:sse4.1:avx2:avx512", 0, 1, ACCESS_TYPE_USER},
+    {"thread_num", PROPERTY_TYPE_INTEGER,
+     "Number of threads decoding strips or tiles of a frame (0 = number of logical CPUs).", "0", "0:255", 0, 1,
+     ACCESS_TYPE_USER},
+    {"frame_thread_num", PROPERTY_TYPE_INTEGER,
+     "Number of frames decoded concurrently through submit/collect (0 = number of logical CPUs).", "0", "0:255", 0, 1,
+     ACCESS_TYPE_USER},
+    {"frame_queue_num", PROPERTY_TYPE_INTEGER,
+     "Maximum number of frames submitted and not collected yet (0 = twice 'frame_thread_num').", "0", "0:1024", 0,
+     1, ACCESS_TYPE_USER},
+    {"output_buffer_num", PROPERTY_TYPE_INTEGER,
+     "Number of rotating output buffers. Decoded frame stays valid until this many further frames are decoded.", "1",
+     "1:16", 0, 1, ACCESS_TYPE_USER},
+    {"plane_mask", PROPERTY_TYPE_INTEGER,
+     "Planes to decode: 1, 2 and 4 select color planes, 8 the alpha plane of 4-sample images. Planes not selected "
+     "are not decoded and their output pointers are NULL.",
+     "7", "1:15", 0, 1, ACCESS_TYPE_USER},
+    {"buffer_bytes", PROPERTY_TYPE_INTEGER, "Bytes allocated for output and intermediate buffers.", NULL, NULL, 0, 1,
+     ACCESS_TYPE_READ},
 };
 
 static size_t libtiff_get_info(const PropertyInfo** info) {
@@ -58,11 +86,47 @@ static size_t libtiff_get_info(const PropertyInfo** info) {
     return sizeof(tiff_dec_libtiff_info) / sizeof(PropertyInfo);
 }
 
+struct TiffStream {
+    char* data;
+    uint64_t size;
+    uint64_t pos;
+};
+
+/* Per-thread decoding state, libtiff handles cannot be shared between threads */
+typedef struct {
+    TiffStream stream;
+    TIFF* tiff;
+    std::vector<uint16_t> chunk;
+    std::vector<uint16_t> row;    /* Unpacked row of interleaved samples below 16 bits */
+    std::vector<uint16_t> chroma; /* CbCr pairs of one row of subsampled blocks */
+    std::string error;
+} tiff_dec_libtiff_worker_t;
+
+/* Threads decoding strips or tiles of one frame at a time */
+typedef struct {
+    plugins_worker_pool pool;
+    std::vector<tiff_dec_libtiff_worker_t> workers;
+} tiff_dec_libtiff_decoder_t;
+
+static void start_decoder(tiff_dec_libtiff_decoder_t& decoder, unsigned threadNum) {
+    decoder.pool.start(threadNum);
+    decoder.workers.resize(threadNum);
+    for (size_t i = 0; i < decoder.workers.size(); i++)
+        decoder.workers[i].tiff = NULL;
+}
+
 typedef struct {
     std::string msg;
-    uint16_t* outputBuffer;
-    uint16_t* lineBuffer;
+    tiff_frame_buffers outputBuffers;
     std::vector<std::string> tempFile;
+    CpuLevel cpuLevel;
+    int threadNum;
+    tiff_dec_libtiff_decoder_t decoder;
+    int frameThreadNum;
+    int frameQueueNum;
+    unsigned planeMask;
+    std::vector<std::unique_ptr<tiff_dec_libtiff_decoder_t> > frameDecoders;
+    tiff_frame_queue frameQueue;
 } tiff_dec_libtiff_data_t;
 
 /* This structure can contain only pointers and simple types */
@@ -74,11 +138,25 @@ static uint64_t libtiff_get_size() {
     return sizeof(tiff_dec_libtiff_t);
 }
 
+/* Parses decimal integer property value. Returns false instead of throwing, exceptions must not cross the API. */
+static bool parse_int(const std::string& value, int& result) {
+    char* end = NULL;
+    errno = 0;
+    long parsed = strtol(value.c_str(), &end, 10);
+    if (value.empty() || '\0' != *end || ERANGE == errno || parsed < INT_MIN || parsed > INT_MAX)
+        return false;
+    result = (int)parsed;
+    return true;
+}
+
 static void init_data(tiff_dec_libtiff_data_t* data) {
-    data->outputBuffer = NULL;
-    data->lineBuffer = NULL;
     data->msg.clear();
     data->tempFile.clear();
+    data->cpuLevel = cpu_level();
+    data->threadNum = 0;
+    data->frameThreadNum = 0;
+    data->frameQueueNum = 0;
+    data->planeMask = 7;
 }
 
 static Status libtiff_init(TiffDecHandle handle, const TiffDecInitParams* init_params) {
@@ -94,6 +172,49 @@ static Status libtiff_init(TiffDecHandle handle, const TiffDecInitParams* init_p
         if ("temp_file" == name) {
             state->data->tempFile.push_back(value);
         }
+        else if ("simd" == name) {
+            if (!parse_cpu_level(value, state->data->cpuLevel)) {
+                state->data->msg = "Invalid 'simd' value: " + value;
+                return STATUS_ERROR;
+            }
+        }
+        else if ("output_buffer_num" == name) {
+            int count = 0;
+            if (!parse_int(value, count) || count < 1 || count > 16) {
+                state->data->msg = "Invalid 'output_buffer_num' value: " + value;
+                return STATUS_ERROR;
+            }
+            state->data->outputBuffers.set_count(count);
+        }
+        else if ("frame_thread_num" == name) {
+            if (!parse_int(value, state->data->frameThreadNum) || state->data->frameThreadNum < 0
+                || state->data->frameThreadNum > 255) {
+                state->data->msg = "Invalid 'frame_thread_num' value: " + value;
+                return STATUS_ERROR;
+            }
+        }
+        else if ("frame_queue_num" == name) {
+            if (!parse_int(value, state->data->frameQueueNum) || state->data->frameQueueNum < 0
+                || state->data->frameQueueNum > 1024) {
+                state->data->msg = "Invalid 'frame_queue_num' value: " + value;
+                return STATUS_ERROR;
+            }
+        }
+        else if ("plane_mask" == name) {
+            int mask = 0;
+            if (!parse_int(value, mask) || mask < 1 || mask > 15) {
+                state->data->msg = "Invalid 'plane_mask' value: " + value;
+                return STATUS_ERROR;
+            }
+            state->data->planeMask = (unsigned)mask;
+        }
+        else if ("thread_num" == name) {
+            if (!parse_int(value, state->data->threadNum) || state->data->threadNum < 0
+                || state->data->threadNum > 255) {
+                state->data->msg = "Invalid 'thread_num' value: " + value;
+                return STATUS_ERROR;
+            }
+        }
         else {
             state->data->msg += "\nUnknown XML property: " + name;
             return STATUS_ERROR;
@@ -105,7 +226,17 @@ static Status libtiff_init(TiffDecHandle handle, const TiffDecInitParams* init_p
         return STATUS_ERROR;
     }
 
+    if (0 == state->data->threadNum)
+        state->data->threadNum = std::max(1, (int)std::thread::hardware_concurrency());
+    start_decoder(state->data->decoder, state->data->threadNum);
+    if (0 == state->data->frameThreadNum)
+        state->data->frameThreadNum = std::max(1, (int)std::thread::hardware_concurrency());
+    if (0 == state->data->frameQueueNum)
+        state->data->frameQueueNum = 2 * state->data->frameThreadNum;
+
     state->data->msg = "LIBTIFF version: " + std::string(TIFFLIB_VERSION_STR);
+    state->data->msg += "\nSIMD: " + std::string(cpu_level_name(state->data->cpuLevel));
+    state->data->msg += "\nThreads: " + std::to_string(state->data->threadNum);
 
     return STATUS_OK;
 }
@@ -114,14 +245,7 @@ static Status libtiff_close(TiffDecHandle handle) {
     tiff_dec_libtiff_t* state = (tiff_dec_libtiff_t*)handle;
 
     if (state->data) {
-        if (state->data->outputBuffer) {
-            delete[] state->data->outputBuffer;
-            state->data->outputBuffer = NULL;
-        }
-        if (state->data->lineBuffer) {
-            delete[] state->data->lineBuffer;
-            state->data->lineBuffer = NULL;
-        }
+        state->data->frameQueue.stop();
         delete state->data;
         state->data = NULL;
     }
@@ -129,12 +253,6 @@ static Status libtiff_close(TiffDecHandle handle) {
     return STATUS_OK;
 }
 
-struct TiffStream {
-    char* data;
-    uint64_t size;
-    uint64_t pos;
-};
-
 tsize_t tiff_Read(thandle_t st, tdata_t buffer, tsize_t size) {
     auto s = (TiffStream*)st;
     auto remainignBytes = s->size - s->pos;
@@ -171,33 +289,308 @@ toff_t tiff_Size(thandle_t st) {
     return (toff_t)s->size;
 };
 
-int tiff_Map(thandle_t, tdata_t*, toff_t*) {
-    return 0;
+/* Input is already in memory, so libtiff can read strips without copying them */
+int tiff_Map(thandle_t st, tdata_t* base, toff_t* size) {
+    auto s = (TiffStream*)st;
+    *base = (tdata_t)s->data;
+    *size = (toff_t)s->size;
+    return 1;
 };
 
 void tiff_Unmap(thandle_t, tdata_t, toff_t) {
     return;
 };
 
-static Status libtiff_process(TiffDecHandle handle, const TiffDecInput* in, TiffDecOutput* out) {
-    tiff_dec_libtiff_t* state = (tiff_dec_libtiff_t*)handle;
+static TIFF* open_stream(TiffStream* stream, const TiffDecInput* in) {
+    stream->data = (char*)in->buffer;
+    stream->pos = 0;
+    stream->size = in->size;
+    return TIFFClientOpen("Memory", "r", (thandle_t)stream, tiff_Read, tiff_Write, tiff_Seek, tiff_Close, tiff_Size,
+                          tiff_Map, tiff_Unmap);
+}
 
-    state->data->msg.clear();
+/* Strip or tile grid of a frame. Strips are handled as tiles spanning the full width. */
+typedef struct {
+    bool tiled;
+    bool separate;
+    uint32 width;
+    uint32 height;
+    uint16 nsamples;
+    int bps;
+    uint32 subsampling[2]; /* YCbCr chroma subsampling, 1,1 for other images */
+    uint32 chunkWidth;
+    uint32 chunkHeight;
+    uint32 across;   /* Chunks per row of chunks */
+    uint32 perPlane; /* Chunks per sample plane, all chunks when samples are interleaved */
+    uint32 count;
+    tmsize_t chunkSize;
+    size_t rowWords;       /* 16-bit samples in one unpacked row of an interleaved chunk */
+    uint32 planeWidth[4];
+    uint32 planeHeight[4];
+    const uint8_t* direct; /* Input buffer if strips can be used in place, otherwise NULL */
+    const uint64* offsets; /* Strip offsets in 'direct' */
+    uint16_t* plane[4];
+} tiff_layout_t;
+
+/* Area of one strip or tile within its plane */
+typedef struct {
+    uint32 sample; /* Plane of a separate chunk, 0 for interleaved samples */
+    uint32 x0;
+    uint32 y0;
+    uint32 cols;
+    uint32 rows;       /* Rows of data, for subsampled interleaved YCbCr these are rows of blocks */
+    uint64_t rowBytes; /* Bytes per row of data, rows start at byte boundary */
+} tiff_chunk_t;
+
+static bool is_subsampled(const tiff_layout_t& layout) {
+    return layout.subsampling[0] > 1 || layout.subsampling[1] > 1;
+}
 
-    TiffStream stream;
-    stream.data = (char*)in->buffer;
-    stream.pos = 0;
-    stream.size = in->size;
+static bool get_layout(TIFF* tiff,
+                       uint32 width,
+                       uint32 height,
+                       uint16 nsamples,
+                       int bps,
+                       const uint16 subsampling[2],
+                       tiff_layout_t* layout) {
+    uint16 planarConfig = PLANARCONFIG_CONTIG;
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planarConfig);
+
+    layout->tiled = TIFFIsTiled(tiff) != 0;
+    layout->separate = PLANARCONFIG_SEPARATE == planarConfig;
+    layout->width = width;
+    layout->height = height;
+    layout->nsamples = nsamples;
+    layout->bps = bps;
+    layout->subsampling[0] = subsampling[0];
+    layout->subsampling[1] = subsampling[1];
+    layout->direct = NULL;
+    layout->offsets = NULL;
+    for (int s = 0; s < 4; s++) {
+        bool chroma = (1 == s || 2 == s);
+        layout->planeWidth[s] = chroma ? (width + subsampling[0] - 1) / subsampling[0] : width;
+        layout->planeHeight[s] = chroma ? (height + subsampling[1] - 1) / subsampling[1] : height;
+    }
+    if (layout->tiled) {
+        if (is_subsampled(*layout))
+            return false;
+        layout->chunkWidth = 0;
+        layout->chunkHeight = 0;
+        TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &layout->chunkWidth);
+        TIFFGetField(tiff, TIFFTAG_TILELENGTH, &layout->chunkHeight);
+        layout->count = TIFFNumberOfTiles(tiff);
+        layout->chunkSize = TIFFTileSize(tiff);
+    }
+    else {
+        uint32 rowsPerStrip = height;
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+        layout->chunkWidth = width;
+        layout->chunkHeight = std::min(rowsPerStrip, height);
+        layout->count = TIFFNumberOfStrips(tiff);
+        layout->chunkSize = TIFFStripSize(tiff);
+    }
+    if (0 == layout->chunkWidth || 0 == layout->chunkHeight || layout->chunkSize <= 0)
+        return false;
+
+    /* Interleaved YCbCr is stored in blocks of subsampling[0] x subsampling[1] luma samples
+     * followed by Cb and Cr, strips must hold whole rows of blocks */
+    if (is_subsampled(*layout) && !layout->separate) {
+        if (layout->chunkHeight % subsampling[1] && layout->chunkHeight != height)
+            return false;
+        layout->rowWords = (size_t)layout->planeWidth[1] * (subsampling[0] * subsampling[1] + 2);
+    }
+    else {
+        layout->rowWords = (size_t)layout->chunkWidth * nsamples;
+    }
+
+    layout->across = (width + layout->chunkWidth - 1) / layout->chunkWidth;
+    uint32 down = (height + layout->chunkHeight - 1) / layout->chunkHeight;
+    layout->perPlane = layout->across * down;
+    return layout->count == layout->perPlane * (layout->separate ? nsamples : 1);
+}
+
+static void get_chunk(const tiff_layout_t& layout, uint32 index, tiff_chunk_t* chunk) {
+    uint32 pos = index % layout.perPlane;
+    chunk->sample = index / layout.perPlane;
+
+    /* Separate chroma strips are subsampled like their plane */
+    uint32 chunkWidth = layout.chunkWidth;
+    uint32 chunkHeight = layout.chunkHeight;
+    if (layout.separate && !layout.tiled) {
+        chunkWidth = layout.planeWidth[chunk->sample];
+        if (1 == chunk->sample || 2 == chunk->sample)
+            chunkHeight = (chunkHeight + layout.subsampling[1] - 1) / layout.subsampling[1];
+    }
+
+    chunk->x0 = (pos % layout.across) * chunkWidth;
+    chunk->y0 = (pos / layout.across) * chunkHeight;
+    chunk->cols = std::min(chunkWidth, layout.planeWidth[chunk->sample] - chunk->x0);
+    chunk->rows = std::min(chunkHeight, layout.planeHeight[chunk->sample] - chunk->y0);
+    if (layout.separate) {
+        chunk->rowBytes = ((uint64_t)chunkWidth * layout.bps + 7) / 8;
+    }
+    else {
+        if (is_subsampled(layout))
+            chunk->rows = (chunk->rows + layout.subsampling[1] - 1) / layout.subsampling[1];
+        chunk->rowBytes = ((uint64_t)layout.rowWords * layout.bps + 7) / 8;
+    }
+}
+
+/* Uncompressed strips need no decoding, samples are converted straight from the
+ * input buffer. Strips must be complete, 16-bit samples must be aligned and in
+ * host byte order. */
+static void check_direct(TIFF* tiff, const TiffDecInput* in, tiff_layout_t* layout) {
+    uint16 compression = COMPRESSION_NONE;
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_COMPRESSION, &compression);
+    bool words = 16 == layout->bps;
+    if (COMPRESSION_NONE != compression || layout->tiled || (words && TIFFIsByteSwapped(tiff)))
+        return;
+
+    uint64* offsets = NULL;
+    uint64* byteCounts = NULL;
+    if (!TIFFGetField(tiff, TIFFTAG_STRIPOFFSETS, &offsets) || !TIFFGetField(tiff, TIFFTAG_STRIPBYTECOUNTS, &byteCounts))
+        return;
+
+    for (uint32 i = 0; i < layout->count; i++) {
+        tiff_chunk_t chunk;
+        get_chunk(*layout, i, &chunk);
+        uint64_t bytes = chunk.rowBytes * chunk.rows;
+        if ((words && (offsets[i] & 1)) || byteCounts[i] < bytes || offsets[i] > in->size || in->size - offsets[i] < bytes)
+            return;
+    }
+    layout->direct = (const uint8_t*)in->buffer;
+    layout->offsets = offsets;
+}
+
+/* Splits rows of 2x1 or 2x2 YCbCr blocks into subsampled planes. Luma pairs and
+ * CbCr pairs are moved as units, chroma is split in a second pass. */
+static void convert_ycbcr_rows(const tiff_layout_t& layout,
+                               const tiff_chunk_t& chunk,
+                               const uint8_t* data,
+                               CpuLevel level,
+                               tiff_dec_libtiff_worker_t& worker) {
+    const uint32 sv = layout.subsampling[1];
+    const uint32 blocks = layout.planeWidth[1];
+    const uint32 fullBlocks = layout.width / 2;
+    const uint32 unit = 2 * sv + 2;
+    uint16_t* chroma = worker.chroma.data();
+
+    for (uint32 row = 0; row < chunk.rows; row++) {
+        const uint8_t* src = data + row * chunk.rowBytes;
+        const uint16_t* samples = (const uint16_t*)src;
+        if (16 != layout.bps) {
+            unpack_to_u16(level, src, layout.rowWords, layout.bps, worker.row.data());
+            samples = worker.row.data();
+        }
 
-    TIFF* inTiff = TIFFClientOpen("Memory", "r", (thandle_t)&stream, tiff_Read, tiff_Write, tiff_Seek, tiff_Close,
-                                  tiff_Size, tiff_Map, tiff_Unmap);
+        uint32 y = chunk.y0 + row * sv;
+        uint16_t* dst[3];
+        for (uint32 j = 0; j < sv; j++)
+            dst[j] = (layout.plane[0] && y + j < layout.height) ? layout.plane[0] + (uint64_t)(y + j) * layout.width
+                                                                 : NULL;
+        dst[sv] = chroma;
+        deinterleave_pairs_u16(level, samples, fullBlocks, sv + 1, dst);
+
+        /* Last block of odd width holds one valid column */
+        if (fullBlocks < blocks) {
+            const uint16_t* block = samples + (size_t)fullBlocks * unit;
+            for (uint32 j = 0; j < sv; j++)
+                if (dst[j])
+                    dst[j][2 * fullBlocks] = block[2 * j];
+            chroma[2 * fullBlocks] = block[2 * sv];
+            chroma[2 * fullBlocks + 1] = block[2 * sv + 1];
+        }
+
+        uint64_t offset = (uint64_t)(y / sv) * blocks;
+        uint16_t* cbcr[2] = {layout.plane[1] ? layout.plane[1] + offset : NULL,
+                             layout.plane[2] ? layout.plane[2] + offset : NULL};
+        deinterleave_u16(level, chroma, blocks, 2, cbcr);
+    }
+}
+
+/* Decodes one strip or tile and stores its samples in the output planes */
+static bool decode_chunk(const tiff_layout_t& layout,
+                         CpuLevel level,
+                         tiff_dec_libtiff_worker_t& worker,
+                         uint32 index) {
+    tiff_chunk_t chunk;
+    get_chunk(layout, index, &chunk);
+    if (layout.separate && !layout.plane[chunk.sample])
+        return true;
+
+    const uint8_t* data;
+    if (layout.direct) {
+        data = layout.direct + layout.offsets[index];
+    }
+    else {
+        /* Subsampled chroma strips are smaller than libtiff expects, so decoded size is limited */
+        tmsize_t limit = (tmsize_t)std::min((uint64_t)layout.chunkSize, chunk.rowBytes * chunk.rows);
+        tmsize_t size = layout.tiled ? TIFFReadEncodedTile(worker.tiff, index, worker.chunk.data(), limit)
+                                     : TIFFReadEncodedStrip(worker.tiff, index, worker.chunk.data(), limit);
+        if (size < 0) {
+            worker.error = std::string(layout.tiled ? "TIFFReadEncodedTile" : "TIFFReadEncodedStrip") +
+                           " failed for chunk " + std::to_string(index);
+            return false;
+        }
+        /* Short result means truncated chunk, the rest of the chunk buffer would hold stale samples */
+        if (size != limit) {
+            worker.error = "Chunk " + std::to_string(index) + " decoded to " + std::to_string((int64_t)size) +
+                           " bytes, expected " + std::to_string((int64_t)limit);
+            return false;
+        }
+        data = (const uint8_t*)worker.chunk.data();
+    }
+
+    if (is_subsampled(layout) && !layout.separate) {
+        convert_ycbcr_rows(layout, chunk, data, level, worker);
+        return true;
+    }
+
+    uint32 planeWidth = layout.planeWidth[chunk.sample];
+    for (uint32 row = 0; row < chunk.rows; row++) {
+        uint64_t offset = (uint64_t)(chunk.y0 + row) * planeWidth + chunk.x0;
+        const uint8_t* src = data + row * chunk.rowBytes;
+        if (layout.separate) {
+            if (16 == layout.bps)
+                memcpy(layout.plane[chunk.sample] + offset, src, chunk.cols * sizeof(uint16_t));
+            else
+                unpack_to_u16(level, src, chunk.cols, layout.bps, layout.plane[chunk.sample] + offset);
+        }
+        else {
+            const uint16_t* samples = (const uint16_t*)src;
+            if (16 != layout.bps) {
+                unpack_to_u16(level, src, (size_t)chunk.cols * layout.nsamples, layout.bps, worker.row.data());
+                samples = worker.row.data();
+            }
+            uint16_t* dst[4];
+            for (int s = 0; s < 4; s++)
+                dst[s] = layout.plane[s] ? layout.plane[s] + offset : NULL;
+            deinterleave_u16(level, samples, chunk.cols, layout.nsamples, dst);
+        }
+    }
+    return true;
+}
+
+static Status decode_frame(tiff_dec_libtiff_decoder_t& decoder,
+                           CpuLevel level,
+                           unsigned planeMask,
+                           tiff_frame_buffers& buffers,
+                           const TiffDecInput* in,
+                           TiffDecOutput* out,
+                           std::string& msg) {
+    std::vector<tiff_dec_libtiff_worker_t>& workers = decoder.workers;
+    TIFF* inTiff = open_stream(&workers[0].stream, in);
+    if (!inTiff) {
+        msg = "TIFFClientOpen failed";
+        return STATUS_ERROR;
+    }
 
     uint32 width = 0;
     uint32 height = 0;
     uint16 bitsPerSample = 0;
     uint16 nsamples = 0;
     uint16 photometric = 0;
-    uint16 subsampling[2] = {0, 0};
+    uint16 subsampling[2] = {1, 1};
 
     TIFFGetField(inTiff, TIFFTAG_IMAGEWIDTH, &width);
     TIFFGetField(inTiff, TIFFTAG_IMAGELENGTH, &height);
@@ -205,8 +598,14 @@ static Status libtiff_process(TiffDecHandle handle, const TiffDecInput* in, Tiff
     TIFFGetField(inTiff, TIFFTAG_SAMPLESPERPIXEL, &nsamples);
     TIFFGetField(inTiff, TIFFTAG_PHOTOMETRIC, &photometric);
 
-    if (bitsPerSample != 16) {
-        state->data->msg = "Unsupported bit-depth: " + std::to_string(bitsPerSample);
+    if (bitsPerSample != 8 && bitsPerSample != 10 && bitsPerSample != 12 && bitsPerSample != 16) {
+        msg = "Unsupported bit-depth: " + std::to_string(bitsPerSample);
+        TIFFClose(inTiff);
+        return STATUS_ERROR;
+    }
+
+    if (nsamples < 3 || nsamples > 4) {
+        msg = "Unsupported number of samples: " + std::to_string(nsamples);
         TIFFClose(inTiff);
         return STATUS_ERROR;
     }
@@ -216,53 +615,113 @@ static Status libtiff_process(TiffDecHandle handle, const TiffDecInput* in, Tiff
         format = TIFF_FORMAT_RGB48LE;
     }
     else if (PHOTOMETRIC_YCBCR == photometric) {
-        TIFFGetField(inTiff, TIFFTAG_YCBCRSUBSAMPLING, &subsampling[0], &subsampling[1]);
+        TIFFGetFieldDefaulted(inTiff, TIFFTAG_YCBCRSUBSAMPLING, &subsampling[0], &subsampling[1]);
         if (1 == subsampling[0] && 1 == subsampling[1]) {
             format = TIFF_FORMAT_YUV444P16LE;
         }
+        else if (2 == subsampling[0] && 1 == subsampling[1] && 3 == nsamples) {
+            format = TIFF_FORMAT_YUV422P16LE;
+        }
+        else if (2 == subsampling[0] && 2 == subsampling[1] && 3 == nsamples) {
+            format = TIFF_FORMAT_YUV420P16LE;
+        }
         else {
-            state->data->msg =
+            msg =
                 "Unsupported subsampling: " + std::to_string(subsampling[0]) + "," + std::to_string(subsampling[1]);
             TIFFClose(inTiff);
             return STATUS_ERROR;
         }
     }
     else {
-        state->data->msg = "Unsupported photometric interpretation: " + std::to_string(photometric);
+        msg = "Unsupported photometric interpretation: " + std::to_string(photometric);
         TIFFClose(inTiff);
         return STATUS_ERROR;
     }
+    /* Only selected planes get memory, other samples are skipped by the conversion kernels */
     const int maxPlaneNum = 4;
-    uint64_t buffer_size = width * height * maxPlaneNum;
-    if (!state->data->outputBuffer)
-        state->data->outputBuffer = new uint16_t[buffer_size];
-    if (!state->data->lineBuffer)
-        state->data->lineBuffer = new uint16_t[buffer_size];
-
-    uint64_t pixNum = width * height;
-    memset(state->data->outputBuffer, 0, buffer_size);
-    uint16* plane[maxPlaneNum];
+    uint16_t* plane[maxPlaneNum] = {NULL, NULL, NULL, NULL};
+    uint16_t* selected[maxPlaneNum] = {NULL, NULL, NULL, NULL};
+    unsigned planeNum = 0;
     for (int i = 0; i < maxPlaneNum; i++) {
-        plane[i] = &state->data->outputBuffer[i * pixNum];
+        if ((planeMask >> i & 1) && i < nsamples)
+            planeNum++;
+    }
+    if (0 == planeNum) {
+        msg = "'plane_mask' selects no plane of " + std::to_string(nsamples) + "-sample image";
+        TIFFClose(inTiff);
+        return STATUS_ERROR;
+    }
+    if (!buffers.acquire(width, height, planeNum, selected)) {
+        msg = "Cannot allocate output buffer for " + std::to_string(width) + "x" + std::to_string(height);
+        TIFFClose(inTiff);
+        return STATUS_ERROR;
+    }
+    for (int i = 0, j = 0; i < maxPlaneNum; i++) {
+        if ((planeMask >> i & 1) && i < nsamples)
+            plane[i] = selected[j++];
     }
 
     out->buffer[0] = (void*)plane[0];
     out->buffer[1] = (void*)plane[1];
     out->buffer[2] = (void*)plane[2];
+    /* Older callers have no 'alpha' member, it is written only when requested */
+    if (planeMask & 8)
+        out->alpha = (void*)plane[3];
 
-    uint16_t* line = state->data->lineBuffer;
-    for (uint32 row = 0; row < height; row++) {
-        if (!TIFFReadScanline(inTiff, line, row)) {
-            state->data->msg = "TIFFReadScanline failed";
+    tiff_layout_t layout;
+    if (!get_layout(inTiff, width, height, nsamples, bitsPerSample, subsampling, &layout)) {
+        msg = "Unsupported strip or tile layout";
+        TIFFClose(inTiff);
+        return STATUS_ERROR;
+    }
+    for (int i = 0; i < maxPlaneNum; i++)
+        layout.plane[i] = plane[i];
+    check_direct(inTiff, in, &layout);
+
+    /* Chunks are handed out dynamically, as compressed sizes differ. Worker 0 uses
+     * the handle opened above, other workers open their own on first chunk unless
+     * strips are read in place. */
+    std::atomic<uint32> next(0);
+    std::atomic<bool> failed(false);
+    decoder.pool.run([&](unsigned w) {
+        tiff_dec_libtiff_worker_t& worker = workers[w];
+        worker.error.clear();
+        if (0 == w)
+            worker.tiff = inTiff;
+        for (uint32 index = next++; index < layout.count && !failed; index = next++) {
+            if (!layout.direct) {
+                if (!worker.tiff) {
+                    worker.tiff = open_stream(&worker.stream, in);
+                    if (!worker.tiff) {
+                        worker.error = "TIFFClientOpen failed";
+                        failed = true;
+                        break;
+                    }
+                }
+                size_t chunkWords = (size_t)(layout.chunkSize + 1) / 2;
+                if (worker.chunk.size() < chunkWords)
+                    worker.chunk.resize(chunkWords);
+            }
+            if (16 != layout.bps && !layout.separate && worker.row.size() < layout.rowWords)
+                worker.row.resize(layout.rowWords);
+            if (is_subsampled(layout) && !layout.separate && worker.chroma.size() < 2 * layout.planeWidth[1])
+                worker.chroma.resize(2 * layout.planeWidth[1]);
+            if (!decode_chunk(layout, level, worker, index)) {
+                failed = true;
+                break;
+            }
+        }
+        if (worker.tiff && worker.tiff != inTiff)
+            TIFFClose(worker.tiff);
+        worker.tiff = NULL;
+    });
+
+    for (size_t w = 0; w < workers.size(); w++) {
+        if (!workers[w].error.empty()) {
+            msg = workers[w].error;
             TIFFClose(inTiff);
             return STATUS_ERROR;
         }
-
-        for (uint32 i = 0; i < width; i++) {
-            for (uint32 s = 0; s < nsamples; s++) {
-                *(plane[s]++) = line[(i*nsamples)+s];
-            }
-        }
     }
 
     out->width = width;
@@ -273,6 +732,57 @@ static Status libtiff_process(TiffDecHandle handle, const TiffDecInput* in, Tiff
     return STATUS_OK;
 }
 
+static Status libtiff_process(TiffDecHandle handle, const TiffDecInput* in, TiffDecOutput* out) {
+    tiff_dec_libtiff_t* state = (tiff_dec_libtiff_t*)handle;
+
+    state->data->msg.clear();
+    return decode_frame(state->data->decoder, state->data->cpuLevel, state->data->planeMask,
+                        state->data->outputBuffers, in, out, state->data->msg);
+}
+
+/* Frame threads are started on first submit, so synchronous users do not pay for them */
+static Status libtiff_submit(TiffDecHandle handle, const TiffDecInput* in) {
+    tiff_dec_libtiff_t* state = (tiff_dec_libtiff_t*)handle;
+    tiff_dec_libtiff_data_t* data = state->data;
+
+    data->msg.clear();
+    if (!data->frameQueue.running()) {
+        data->frameDecoders.clear();
+        for (int i = 0; i < data->frameThreadNum; i++) {
+            data->frameDecoders.push_back(std::unique_ptr<tiff_dec_libtiff_decoder_t>(new tiff_dec_libtiff_decoder_t));
+            start_decoder(*data->frameDecoders.back(), 1);
+        }
+        CpuLevel level = data->cpuLevel;
+        unsigned planeMask = data->planeMask;
+        data->frameQueue.start(data->frameThreadNum, data->frameQueueNum,
+                               [data, level, planeMask](unsigned thread, const TiffDecInput* frameIn,
+                                                        tiff_frame_buffers& buffers, TiffDecOutput* frameOut,
+                                                        std::string& error) {
+                                   return decode_frame(*data->frameDecoders[thread], level, planeMask, buffers,
+                                                       frameIn, frameOut, error);
+                               });
+    }
+    return data->frameQueue.submit(in, data->msg);
+}
+
+static Status libtiff_collect(TiffDecHandle handle, TiffDecOutput* out) {
+    tiff_dec_libtiff_t* state = (tiff_dec_libtiff_t*)handle;
+
+    state->data->msg.clear();
+    /* Callers built against older API have no 'alpha' member */
+    TiffDecOutput frame;
+    memset(&frame, 0, sizeof(frame));
+    Status status = state->data->frameQueue.collect(&frame, state->data->msg);
+    out->width = frame.width;
+    out->height = frame.height;
+    for (int i = 0; i < 3; i++)
+        out->buffer[i] = frame.buffer[i];
+    out->format = frame.format;
+    if (state->data->planeMask & 8)
+        out->alpha = frame.alpha;
+    return status;
+}
+
 static Status libtiff_set_property(TiffDecHandle, const Property*) {
     return STATUS_ERROR;
 }
@@ -288,6 +798,19 @@ static Status libtiff_get_property(TiffDecHandle handle, Property* property) {
             strcpy(property->value, std::to_string(temp_file_num).c_str());
             return STATUS_OK;
         }
+        else if ("simd" == name && state->data) {
+            strcpy(property->value, cpu_level_name(state->data->cpuLevel));
+            return STATUS_OK;
+        }
+        else if ("buffer_bytes" == name && state->data) {
+            size_t bytes = state->data->outputBuffers.bytes();
+            for (size_t i = 0; i < state->data->decoder.workers.size(); i++)
+                bytes += (state->data->decoder.workers[i].chunk.capacity() + state->data->decoder.workers[i].row.capacity()) *
+                         sizeof(uint16_t);
+            bytes += state->data->frameQueue.bytes();
+            strcpy(property->value, std::to_string(bytes).c_str());
+            return STATUS_OK;
+        }
     }
     return STATUS_ERROR;
 }
@@ -302,8 +825,9 @@ static const char* libtiff_get_message(TiffDecHandle handle) {
 }
 
 static TiffDecApi libtiff_plugin_api = {
-    "libtiff",       libtiff_get_info,     libtiff_get_size,     libtiff_init,       libtiff_close,
-    libtiff_process, libtiff_set_property, libtiff_get_property, libtiff_get_message};
+    "libtiff",       libtiff_get_info,     libtiff_get_size,     libtiff_init,        libtiff_close,
+    libtiff_process, libtiff_set_property, libtiff_get_property, libtiff_get_message, libtiff_submit,
+    libtiff_collect};
 
 DLB_EXPORT
 TiffDecApi* tiffDecGetApi() {
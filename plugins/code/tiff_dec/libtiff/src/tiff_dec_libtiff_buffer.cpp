@@ -0,0 +1,90 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tiff_dec_libtiff_buffer.h"
+
+#include <new>
+
+#define BUFFER_ALIGNMENT 64
+
+tiff_frame_buffers::tiff_frame_buffers() : current(0) {
+    set_count(1);
+}
+
+tiff_frame_buffers::~tiff_frame_buffers() {
+    release();
+}
+
+void tiff_frame_buffers::release() {
+    for (size_t i = 0; i < slots.size(); i++)
+        delete[] slots[i].raw;
+    slots.clear();
+}
+
+void tiff_frame_buffers::set_count(unsigned count) {
+    release();
+    slot empty = {NULL, NULL, 0};
+    slots.assign(count ? count : 1, empty);
+    current = 0;
+}
+
+bool tiff_frame_buffers::acquire(uint32_t width, uint32_t height, unsigned planes, uint16_t* plane[]) {
+    const size_t alignWords = BUFFER_ALIGNMENT / sizeof(uint16_t);
+    size_t planeWords = ((size_t)width * height + alignWords - 1) / alignWords * alignWords;
+    size_t needed = planeWords * planes * sizeof(uint16_t);
+
+    slot& buffer = slots[current];
+    current = (current + 1) % slots.size();
+    if (buffer.capacity < needed) {
+        delete[] buffer.raw;
+        buffer.raw = new (std::nothrow) uint8_t[needed + BUFFER_ALIGNMENT - 1];
+        if (!buffer.raw) {
+            buffer.data = NULL;
+            buffer.capacity = 0;
+            return false;
+        }
+        uintptr_t addr = ((uintptr_t)buffer.raw + BUFFER_ALIGNMENT - 1) & ~(uintptr_t)(BUFFER_ALIGNMENT - 1);
+        buffer.data = (uint16_t*)addr;
+        buffer.capacity = needed;
+    }
+
+    for (unsigned i = 0; i < planes; i++)
+        plane[i] = buffer.data + i * planeWords;
+    return true;
+}
+
+size_t tiff_frame_buffers::bytes() const {
+    size_t total = 0;
+    for (size_t i = 0; i < slots.size(); i++)
+        total += slots[i].capacity;
+    return total;
+}
@@ -0,0 +1,77 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_TIFF_DEC_LIBTIFF_BUFFER_H__
+#define __DEE_PLUGINS_TIFF_DEC_LIBTIFF_BUFFER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/** @brief Rotating set of planar output buffers
+ *  Buffers are reallocated only when a frame needs more memory than before, so
+ *  a sequence of equal or shrinking frames never allocates. Every plane starts
+ *  at a 64-byte boundary. Contents are not cleared.
+ */
+class tiff_frame_buffers {
+  public:
+    tiff_frame_buffers();
+    ~tiff_frame_buffers();
+
+    /** @brief Sets number of buffers in rotation, frees existing buffers */
+    void set_count(unsigned count);
+
+    /** @brief Returns planes of the next buffer in rotation
+     *  A buffer stays untouched until 'count' - 1 further frames were acquired.
+     *  @return false if memory could not be allocated
+     */
+    bool acquire(uint32_t width, uint32_t height, unsigned planes, uint16_t* plane[]);
+
+    /** @brief Bytes allocated by all buffers */
+    size_t bytes() const;
+
+  private:
+    struct slot {
+        uint8_t* raw;
+        uint16_t* data; /* 'raw' aligned to 64 bytes */
+        size_t capacity;
+    };
+
+    void release();
+    tiff_frame_buffers(const tiff_frame_buffers&);
+    tiff_frame_buffers& operator=(const tiff_frame_buffers&);
+
+    std::vector<slot> slots;
+    size_t current;
+};
+
+#endif // __DEE_PLUGINS_TIFF_DEC_LIBTIFF_BUFFER_H__
@@ -0,0 +1,495 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tiff_dec_libtiff_kernels.h"
+
+#include <string.h>
+
+static void deinterleave_scalar(const uint16_t* src, size_t first, size_t count, int nsamples, uint16_t* const dst[]) {
+    for (int s = 0; s < nsamples; s++) {
+        uint16_t* out = dst[s];
+        if (!out)
+            continue;
+        const uint16_t* in = src + s;
+        for (size_t i = first; i < count; i++)
+            out[i] = in[i * nsamples];
+    }
+}
+
+static void unpack_scalar(const uint8_t* src, size_t first, size_t count, int bps, uint16_t* dst) {
+    if (8 == bps) {
+        for (size_t i = first; i < count; i++)
+            dst[i] = (uint16_t)(src[i] * 0x101);
+        return;
+    }
+    /* 10 and 12-bit samples always end in the byte following their first byte */
+    for (size_t i = first; i < count; i++) {
+        size_t bit = i * bps;
+        const uint8_t* p = src + (bit >> 3);
+        unsigned word = ((unsigned)p[0] << 8) | p[1];
+        unsigned v = (word >> (16 - bps - (bit & 7))) & ((1u << bps) - 1);
+        dst[i] = (uint16_t)((v << (16 - bps)) | (v >> (2 * bps - 16)));
+    }
+}
+
+#if defined(DLB_X86)
+
+/* Byte shuffle mask moving 16-bit words 'from[i]' into position 'to + i', other words are zeroed */
+static __m128i word_mask(const int* from, int n, int to) {
+    int8_t bytes[16];
+    for (int i = 0; i < 16; i++)
+        bytes[i] = -1;
+    for (int i = 0; i < n; i++) {
+        bytes[2 * (to + i)] = (int8_t)(2 * from[i]);
+        bytes[2 * (to + i) + 1] = (int8_t)(2 * from[i] + 1);
+    }
+    return _mm_loadu_si128((const __m128i*)bytes);
+}
+
+/* For 8 pixels of 3 samples loaded as a, b, c, sample s of pixel i sits in word 3 * i + s.
+ * Each output gathers its words from a, b and c with one shuffle per input. */
+struct shuffle3_masks {
+    __m128i m[3][3];
+
+    shuffle3_masks() {
+        for (int s = 0; s < 3; s++) {
+            int pos = 0;
+            for (int v = 0; v < 3; v++) {
+                int from[8];
+                int n = 0;
+                for (int w = 0; w < 8; w++)
+                    if ((8 * v + w) % 3 == s)
+                        from[n++] = w;
+                m[s][v] = word_mask(from, n, pos);
+                pos += n;
+            }
+        }
+    }
+};
+
+DLB_TARGET_SSE41
+static size_t deinterleave3_sse41(const uint16_t* src, size_t count, uint16_t* const dst[]) {
+    static const shuffle3_masks masks;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i* p = (const __m128i*)(src + 3 * i);
+        __m128i v[3] = {_mm_loadu_si128(p), _mm_loadu_si128(p + 1), _mm_loadu_si128(p + 2)};
+        for (int s = 0; s < 3; s++) {
+            if (!dst[s])
+                continue;
+            __m128i r = _mm_or_si128(_mm_shuffle_epi8(v[0], masks.m[s][0]),
+                                     _mm_or_si128(_mm_shuffle_epi8(v[1], masks.m[s][1]),
+                                                  _mm_shuffle_epi8(v[2], masks.m[s][2])));
+            _mm_storeu_si128((__m128i*)(dst[s] + i), r);
+        }
+    }
+    return i;
+}
+
+/* 4 x 4 transpose of 16-bit words: a, b, c, d hold 2 pixels each */
+DLB_TARGET_SSE41
+static inline void transpose4_sse41(__m128i a, __m128i b, __m128i c, __m128i d, __m128i out[4]) {
+    __m128i t0 = _mm_unpacklo_epi16(a, b);
+    __m128i t1 = _mm_unpackhi_epi16(a, b);
+    __m128i t2 = _mm_unpacklo_epi16(c, d);
+    __m128i t3 = _mm_unpackhi_epi16(c, d);
+    __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+    __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+    __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+    __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+    out[0] = _mm_unpacklo_epi64(u0, u2);
+    out[1] = _mm_unpackhi_epi64(u0, u2);
+    out[2] = _mm_unpacklo_epi64(u1, u3);
+    out[3] = _mm_unpackhi_epi64(u1, u3);
+}
+
+DLB_TARGET_SSE41
+static size_t deinterleave4_sse41(const uint16_t* src, size_t count, uint16_t* const dst[]) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i* p = (const __m128i*)(src + 4 * i);
+        __m128i out[4];
+        transpose4_sse41(_mm_loadu_si128(p), _mm_loadu_si128(p + 1), _mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3),
+                         out);
+        for (int s = 0; s < 4; s++)
+            if (dst[s])
+                _mm_storeu_si128((__m128i*)(dst[s] + i), out[s]);
+    }
+    return i;
+}
+
+/* Even words to lower half, odd words to upper half */
+static const int8_t split2_bytes[16] = {0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15};
+
+DLB_TARGET_SSE41
+static size_t deinterleave2_sse41(const uint16_t* src, size_t count, uint16_t* const dst[]) {
+    const __m128i split = _mm_loadu_si128((const __m128i*)split2_bytes);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 2 * i)), split);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 2 * i + 8)), split);
+        if (dst[0])
+            _mm_storeu_si128((__m128i*)(dst[0] + i), _mm_unpacklo_epi64(a, b));
+        if (dst[1])
+            _mm_storeu_si128((__m128i*)(dst[1] + i), _mm_unpackhi_epi64(a, b));
+    }
+    return i;
+}
+
+/* AVX2 kernels run the SSE networks in both 128-bit lanes: lower lane handles
+ * pixels [i, i + 8), upper lane handles [i + 8, i + 16). */
+DLB_TARGET_AVX2
+static inline __m256i load_lanes(const uint16_t* lo, const uint16_t* hi) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)lo)),
+                                   _mm_loadu_si128((const __m128i*)hi), 1);
+}
+
+DLB_TARGET_AVX2
+static size_t deinterleave3_avx2(const uint16_t* src, size_t count, uint16_t* const dst[]) {
+    static const shuffle3_masks masks;
+    __m256i m[3][3];
+    for (int s = 0; s < 3; s++)
+        for (int v = 0; v < 3; v++)
+            m[s][v] = _mm256_broadcastsi128_si256(masks.m[s][v]);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint16_t* p = src + 3 * i;
+        __m256i v[3] = {load_lanes(p, p + 24), load_lanes(p + 8, p + 32), load_lanes(p + 16, p + 40)};
+        for (int s = 0; s < 3; s++) {
+            if (!dst[s])
+                continue;
+            __m256i r = _mm256_or_si256(_mm256_shuffle_epi8(v[0], m[s][0]),
+                                        _mm256_or_si256(_mm256_shuffle_epi8(v[1], m[s][1]),
+                                                        _mm256_shuffle_epi8(v[2], m[s][2])));
+            _mm256_storeu_si256((__m256i*)(dst[s] + i), r);
+        }
+    }
+    return i;
+}
+
+DLB_TARGET_AVX2
+static size_t deinterleave4_avx2(const uint16_t* src, size_t count, uint16_t* const dst[]) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint16_t* p = src + 4 * i;
+        __m256i a = load_lanes(p, p + 32);
+        __m256i b = load_lanes(p + 8, p + 40);
+        __m256i c = load_lanes(p + 16, p + 48);
+        __m256i d = load_lanes(p + 24, p + 56);
+        __m256i t0 = _mm256_unpacklo_epi16(a, b);
+        __m256i t1 = _mm256_unpackhi_epi16(a, b);
+        __m256i t2 = _mm256_unpacklo_epi16(c, d);
+        __m256i t3 = _mm256_unpackhi_epi16(c, d);
+        __m256i u0 = _mm256_unpacklo_epi16(t0, t1);
+        __m256i u1 = _mm256_unpackhi_epi16(t0, t1);
+        __m256i u2 = _mm256_unpacklo_epi16(t2, t3);
+        __m256i u3 = _mm256_unpackhi_epi16(t2, t3);
+        __m256i out[4] = {_mm256_unpacklo_epi64(u0, u2), _mm256_unpackhi_epi64(u0, u2), _mm256_unpacklo_epi64(u1, u3),
+                          _mm256_unpackhi_epi64(u1, u3)};
+        for (int s = 0; s < 4; s++)
+            if (dst[s])
+                _mm256_storeu_si256((__m256i*)(dst[s] + i), out[s]);
+    }
+    return i;
+}
+
+DLB_TARGET_AVX2
+static size_t deinterleave2_avx2(const uint16_t* src, size_t count, uint16_t* const dst[]) {
+    const __m256i split = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)split2_bytes));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        /* Quadwords of each vector become [even 0-3, even 4-7, odd 0-3, odd 4-7] */
+        __m256i a = _mm256_permute4x64_epi64(
+            _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + 2 * i)), split), 0xD8);
+        __m256i b = _mm256_permute4x64_epi64(
+            _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + 2 * i + 16)), split), 0xD8);
+        if (dst[0])
+            _mm256_storeu_si256((__m256i*)(dst[0] + i), _mm256_permute2x128_si256(a, b, 0x20));
+        if (dst[1])
+            _mm256_storeu_si256((__m256i*)(dst[1] + i), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    return i;
+}
+
+/* Pairs of 16-bit samples are moved as 32-bit units. Unit n * i + s of a block of
+ * 8 pixels comes from vector (n * i + s) / 8, lane (n * i + s) % 8. */
+struct pair_tables {
+    int32_t index[3][8];
+    int32_t select[3][3][8]; /* [sample][vector][lane], -1 where lane comes from vector */
+
+    explicit pair_tables(int nsamples) {
+        memset(this, 0, sizeof(*this));
+        for (int s = 0; s < nsamples; s++) {
+            for (int i = 0; i < 8; i++) {
+                int u = nsamples * i + s;
+                index[s][i] = u % 8;
+                select[s][u / 8][i] = -1;
+            }
+        }
+    }
+};
+
+DLB_TARGET_AVX2
+static size_t deinterleave_pairs_avx2(const uint16_t* src, size_t count, int nsamples, uint16_t* const dst[]) {
+    static const pair_tables tables2(2);
+    static const pair_tables tables3(3);
+    const pair_tables& tables = (2 == nsamples) ? tables2 : tables3;
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v[3];
+        for (int k = 0; k < nsamples; k++)
+            v[k] = _mm256_loadu_si256((const __m256i*)(src + 2 * (nsamples * i + 8 * k)));
+        for (int s = 0; s < nsamples; s++) {
+            if (!dst[s])
+                continue;
+            __m256i index = _mm256_loadu_si256((const __m256i*)tables.index[s]);
+            __m256i r = _mm256_permutevar8x32_epi32(v[0], index);
+            for (int k = 1; k < nsamples; k++)
+                r = _mm256_blendv_epi8(r, _mm256_permutevar8x32_epi32(v[k], index),
+                                       _mm256_loadu_si256((const __m256i*)tables.select[s][k]));
+            _mm256_storeu_si256((__m256i*)(dst[s] + 2 * i), r);
+        }
+    }
+    return i;
+}
+
+/* AVX-512 kernel handles 32 pixels using 'nsamples' input vectors. Word n * i + s of
+ * the input block is fetched with a two-source permute of the vector pair holding it. */
+struct permute_tables {
+    uint16_t index[4][3][32]; /* [sample][pair][lane] */
+    uint32_t select[4][3];    /* Lanes taken from each pair */
+
+    explicit permute_tables(int nsamples) {
+        memset(this, 0, sizeof(*this));
+        for (int s = 0; s < nsamples; s++) {
+            for (int i = 0; i < 32; i++) {
+                int w = nsamples * i + s;
+                int k = w / 32 < nsamples - 1 ? w / 32 : nsamples - 2;
+                index[s][k][i] = (uint16_t)(w - 32 * k);
+                select[s][k] |= 1u << i;
+            }
+        }
+    }
+};
+
+DLB_TARGET_AVX512
+static size_t deinterleave_avx512(const uint16_t* src, size_t count, int nsamples, uint16_t* const dst[]) {
+    static const permute_tables tables2(2);
+    static const permute_tables tables3(3);
+    static const permute_tables tables4(4);
+    const permute_tables& tables = (2 == nsamples) ? tables2 : (3 == nsamples) ? tables3 : tables4;
+    __m512i index[4][3];
+    for (int s = 0; s < nsamples; s++)
+        for (int k = 0; k < nsamples - 1; k++)
+            index[s][k] = _mm512_loadu_si512(tables.index[s][k]);
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m512i v[4];
+        for (int k = 0; k < nsamples; k++)
+            v[k] = _mm512_loadu_si512(src + nsamples * i + 32 * k);
+        for (int s = 0; s < nsamples; s++) {
+            if (!dst[s])
+                continue;
+            __m512i r = _mm512_permutex2var_epi16(v[0], index[s][0], v[1]);
+            for (int k = 1; k < nsamples - 1; k++)
+                r = _mm512_mask_blend_epi16((__mmask32)tables.select[s][k], r, _mm512_permutex2var_epi16(v[k], index[s][k], v[k + 1]));
+            _mm512_storeu_si512(dst[s] + i, r);
+        }
+    }
+    return i;
+}
+
+/* Unpacking of 8 samples of 10 or 12 bits ('bps' bytes): each 16-bit lane receives the
+ * big-endian word holding its sample, multiplying by 1 << (bit offset) moves the sample
+ * to the top of the lane. Bit replication then fills the low bits. */
+struct unpack_masks {
+    __m128i shuffle;
+    __m128i multiplier;
+
+    explicit unpack_masks(int bps) {
+        int8_t bytes[16];
+        int16_t mul[8];
+        for (int k = 0; k < 8; k++) {
+            int bit = k * bps;
+            bytes[2 * k] = (int8_t)((bit >> 3) + 1);
+            bytes[2 * k + 1] = (int8_t)(bit >> 3);
+            mul[k] = (int16_t)(1 << (bit & 7));
+        }
+        shuffle = _mm_loadu_si128((const __m128i*)bytes);
+        multiplier = _mm_loadu_si128((const __m128i*)mul);
+    }
+};
+
+static const unpack_masks& get_unpack_masks(int bps) {
+    static const unpack_masks masks10(10);
+    static const unpack_masks masks12(12);
+    return (10 == bps) ? masks10 : masks12;
+}
+
+DLB_TARGET_SSE41
+static size_t unpack_sse41(const uint8_t* src, size_t count, int bps, uint16_t* dst) {
+    size_t i = 0;
+    if (8 == bps) {
+        const __m128i mul = _mm_set1_epi16(0x101);
+        for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(src + i)));
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_mullo_epi16(v, mul));
+        }
+        return i;
+    }
+    const unpack_masks& masks = get_unpack_masks(bps);
+    const __m128i top = _mm_set1_epi16((short)(0xFFFF << (16 - bps)));
+    const size_t bytes = (count * bps + 7) / 8;
+    for (size_t offset = 0; offset + 16 <= bytes && i + 8 <= count; i += 8, offset += bps) {
+        __m128i w = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + offset)), masks.shuffle);
+        __m128i t = _mm_and_si128(_mm_mullo_epi16(w, masks.multiplier), top);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(t, _mm_srli_epi16(t, bps)));
+    }
+    return i;
+}
+
+DLB_TARGET_AVX2
+static size_t unpack_avx2(const uint8_t* src, size_t count, int bps, uint16_t* dst) {
+    size_t i = 0;
+    if (8 == bps) {
+        const __m256i mul = _mm256_set1_epi16(0x101);
+        for (; i + 16 <= count; i += 16) {
+            __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(src + i)));
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_mullo_epi16(v, mul));
+        }
+        return i;
+    }
+    const unpack_masks& masks = get_unpack_masks(bps);
+    const __m256i shuffle = _mm256_broadcastsi128_si256(masks.shuffle);
+    const __m256i multiplier = _mm256_broadcastsi128_si256(masks.multiplier);
+    const __m256i top = _mm256_set1_epi16((short)(0xFFFF << (16 - bps)));
+    const size_t bytes = (count * bps + 7) / 8;
+    for (size_t offset = 0; offset + bps + 16 <= bytes && i + 16 <= count; i += 16, offset += 2 * bps) {
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(src + offset))),
+                                            _mm_loadu_si128((const __m128i*)(src + offset + bps)), 1);
+        __m256i t = _mm256_and_si256(_mm256_mullo_epi16(_mm256_shuffle_epi8(v, shuffle), multiplier), top);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(t, _mm256_srli_epi16(t, bps)));
+    }
+    return i;
+}
+
+DLB_TARGET_AVX512
+static size_t unpack_avx512(const uint8_t* src, size_t count, int bps, uint16_t* dst) {
+    size_t i = 0;
+    if (8 == bps) {
+        const __m512i mul = _mm512_set1_epi16(0x101);
+        for (; i + 32 <= count; i += 32) {
+            __m512i v = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i*)(src + i)));
+            _mm512_storeu_si512(dst + i, _mm512_mullo_epi16(v, mul));
+        }
+        return i;
+    }
+    const unpack_masks& masks = get_unpack_masks(bps);
+    const __m512i shuffle = _mm512_broadcast_i32x4(masks.shuffle);
+    const __m512i multiplier = _mm512_broadcast_i32x4(masks.multiplier);
+    const __m512i top = _mm512_set1_epi16((short)(0xFFFF << (16 - bps)));
+    const size_t bytes = (count * bps + 7) / 8;
+    for (size_t offset = 0; offset + 3 * bps + 16 <= bytes && i + 32 <= count; i += 32, offset += 4 * bps) {
+        __m512i v = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)(src + offset)));
+        v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(src + offset + bps)), 1);
+        v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(src + offset + 2 * bps)), 2);
+        v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i*)(src + offset + 3 * bps)), 3);
+        __m512i t = _mm512_and_si512(_mm512_mullo_epi16(_mm512_shuffle_epi8(v, shuffle), multiplier), top);
+        _mm512_storeu_si512(dst + i, _mm512_or_si512(t, _mm512_srli_epi16(t, bps)));
+    }
+    return i;
+}
+
+#endif
+
+void unpack_to_u16(CpuLevel level, const uint8_t* src, size_t count, int bps, uint16_t* dst) {
+    size_t done = 0;
+#if defined(DLB_X86)
+    if (level >= CPU_LEVEL_AVX512)
+        done = unpack_avx512(src, count, bps, dst);
+    else if (level >= CPU_LEVEL_AVX2)
+        done = unpack_avx2(src, count, bps, dst);
+    else if (level >= CPU_LEVEL_SSE41)
+        done = unpack_sse41(src, count, bps, dst);
+#else
+    (void)level;
+#endif
+    unpack_scalar(src, done, count, bps, dst);
+}
+
+void deinterleave_u16(CpuLevel level, const uint16_t* src, size_t count, int nsamples, uint16_t* const dst[]) {
+    size_t done = 0;
+#if defined(DLB_X86)
+    if (2 == nsamples) {
+        if (level >= CPU_LEVEL_AVX512)
+            done = deinterleave_avx512(src, count, nsamples, dst);
+        else if (level >= CPU_LEVEL_AVX2)
+            done = deinterleave2_avx2(src, count, dst);
+        else if (level >= CPU_LEVEL_SSE41)
+            done = deinterleave2_sse41(src, count, dst);
+    }
+    else if (3 == nsamples || 4 == nsamples) {
+        if (level >= CPU_LEVEL_AVX512)
+            done = deinterleave_avx512(src, count, nsamples, dst);
+        else if (level >= CPU_LEVEL_AVX2)
+            done = (3 == nsamples) ? deinterleave3_avx2(src, count, dst) : deinterleave4_avx2(src, count, dst);
+        else if (level >= CPU_LEVEL_SSE41)
+            done = (3 == nsamples) ? deinterleave3_sse41(src, count, dst) : deinterleave4_sse41(src, count, dst);
+    }
+#else
+    (void)level;
+#endif
+    deinterleave_scalar(src, done, count, nsamples, dst);
+}
+
+void deinterleave_pairs_u16(CpuLevel level, const uint16_t* src, size_t count, int nsamples, uint16_t* const dst[]) {
+    size_t done = 0;
+#if defined(DLB_X86)
+    if ((2 == nsamples || 3 == nsamples) && level >= CPU_LEVEL_AVX2)
+        done = deinterleave_pairs_avx2(src, count, nsamples, dst);
+#else
+    (void)level;
+#endif
+    for (int s = 0; s < nsamples; s++) {
+        uint16_t* out = dst[s];
+        if (!out)
+            continue;
+        for (size_t i = done; i < count; i++) {
+            const uint16_t* in = src + 2 * (nsamples * i + s);
+            out[2 * i] = in[0];
+            out[2 * i + 1] = in[1];
+        }
+    }
+}
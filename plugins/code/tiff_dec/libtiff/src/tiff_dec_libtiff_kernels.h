@@ -0,0 +1,75 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_TIFF_DEC_LIBTIFF_KERNELS_H__
+#define __DEE_PLUGINS_TIFF_DEC_LIBTIFF_KERNELS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "plugins_cpu.h"
+
+/** @brief Splits interleaved 16-bit samples into planes
+ *  Uses the fastest kernel allowed by 'level'. 2, 3 and 4 samples per pixel have
+ *  SIMD kernels, other counts use scalar code.
+ */
+void deinterleave_u16(CpuLevel level,
+                      const uint16_t* src,   /**< [in] Interleaved samples */
+                      size_t count,          /**< [in] Number of pixels */
+                      int nsamples,          /**< [in] Samples per pixel */
+                      uint16_t* const dst[]  /**< [out] 'nsamples' plane pointers, NULL skips the sample */
+);
+
+/** @brief Splits interleaved pairs of 16-bit samples into planes
+ *  Used for subsampled YCbCr blocks, where horizontally adjacent luma samples are
+ *  stored together. 'count' pairs are written to each plane.
+ */
+void deinterleave_pairs_u16(CpuLevel level,
+                            const uint16_t* src,   /**< [in] Interleaved pairs */
+                            size_t count,          /**< [in] Number of pairs per plane */
+                            int nsamples,          /**< [in] Pairs per unit */
+                            uint16_t* const dst[]  /**< [out] 'nsamples' plane pointers, NULL skips the pair */
+);
+
+/** @brief Expands packed samples to 16 bits
+ *  Samples are read as a big-endian bit stream, as stored by TIFF. Results are MSB
+ *  aligned and low bits are filled by replicating the top bits, so full scale
+ *  input maps to 0xFFFF.
+ */
+void unpack_to_u16(CpuLevel level,
+                   const uint8_t* src, /**< [in] Packed samples, starting at byte boundary */
+                   size_t count,       /**< [in] Number of samples */
+                   int bps,            /**< [in] Bits per sample: 8, 10 or 12 */
+                   uint16_t* dst       /**< [out] 'count' 16-bit samples */
+);
+
+#endif // __DEE_PLUGINS_TIFF_DEC_LIBTIFF_KERNELS_H__
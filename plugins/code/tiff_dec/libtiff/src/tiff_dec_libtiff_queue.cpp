@@ -0,0 +1,151 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tiff_dec_libtiff_queue.h"
+
+#include <string.h>
+
+tiff_frame_queue::tiff_frame_queue() : head(0), pending(0), stopping(false) {}
+
+tiff_frame_queue::~tiff_frame_queue() {
+    stop();
+}
+
+void tiff_frame_queue::start(unsigned threadNum, unsigned depth, const decode_fn& fn) {
+    stop();
+    decode = fn;
+    for (unsigned i = 0; i < depth + 1; i++) {
+        frames.push_back(std::unique_ptr<frame>(new frame));
+        frames.back()->inputSize = 0;
+        frames.back()->bufferBytes = 0;
+        frames.back()->done = false;
+    }
+    for (unsigned i = 0; i < threadNum; i++)
+        threads.push_back(std::thread(&tiff_frame_queue::thread_loop, this, i));
+}
+
+void tiff_frame_queue::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    threads.clear();
+    frames.clear();
+    jobs.clear();
+    head = 0;
+    pending = 0;
+    stopping = false;
+}
+
+Status tiff_frame_queue::submit(const TiffDecInput* in, std::string& error) {
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending + 1 >= frames.size()) {
+            error = "Decoding queue is full, collect a frame first.";
+            return STATUS_ERROR;
+        }
+        index = (head + pending) % frames.size();
+    }
+
+    /* Frame is neither queued nor returned to caller, so it can be filled without lock */
+    frame& f = *frames[index];
+    if (f.input.size() < in->size)
+        f.input.resize((size_t)in->size);
+    memcpy(f.input.data(), in->buffer, (size_t)in->size);
+    f.inputSize = (size_t)in->size;
+    f.done = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(index);
+        pending++;
+    }
+    jobReady.notify_one();
+    return STATUS_OK;
+}
+
+Status tiff_frame_queue::collect(TiffDecOutput* out, std::string& error) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (0 == pending) {
+        error = "No frame was submitted.";
+        return STATUS_ERROR;
+    }
+    frame& f = *frames[head];
+    frameDone.wait(lock, [&f] { return f.done; });
+    head = (head + 1) % frames.size();
+    pending--;
+
+    *out = f.out;
+    error = f.error;
+    return f.status;
+}
+
+size_t tiff_frame_queue::bytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t total = 0;
+    for (size_t i = 0; i < frames.size(); i++)
+        total += frames[i]->input.capacity() + frames[i]->bufferBytes;
+    return total;
+}
+
+void tiff_frame_queue::thread_loop(unsigned thread) {
+    for (;;) {
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping)
+                return;
+            index = jobs.front();
+            jobs.pop_front();
+        }
+
+        frame& f = *frames[index];
+        TiffDecInput in;
+        in.buffer = f.input.data();
+        in.size = f.inputSize;
+        f.error.clear();
+        memset(&f.out, 0, sizeof(f.out));
+        f.status = decode(thread, &in, f.buffers, &f.out, f.error);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            f.bufferBytes = f.buffers.bytes();
+            f.done = true;
+        }
+        frameDone.notify_all();
+    }
+}
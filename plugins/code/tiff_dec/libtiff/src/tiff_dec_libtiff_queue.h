@@ -0,0 +1,102 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2019, Dolby Laboratories
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DEE_PLUGINS_TIFF_DEC_LIBTIFF_QUEUE_H__
+#define __DEE_PLUGINS_TIFF_DEC_LIBTIFF_QUEUE_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tiff_dec_api.h"
+#include "tiff_dec_libtiff_buffer.h"
+
+/** @brief Decodes submitted frames on worker threads and returns them in submission order
+ *  Each queued frame owns a copy of its input and its own output buffer. The frame
+ *  returned by collect() is kept until the next collect(), so the queue holds one
+ *  frame more than 'depth'.
+ */
+class tiff_frame_queue {
+  public:
+    /** @brief Decodes 'in' into 'buffers' on worker thread 'thread' */
+    typedef std::function<Status(unsigned thread,
+                                 const TiffDecInput* in,
+                                 tiff_frame_buffers& buffers,
+                                 TiffDecOutput* out,
+                                 std::string& error)>
+        decode_fn;
+
+    tiff_frame_queue();
+    ~tiff_frame_queue();
+
+    void start(unsigned threadNum, unsigned depth, const decode_fn& fn);
+    void stop();
+    bool running() const { return !threads.empty(); }
+
+    Status submit(const TiffDecInput* in, std::string& error);
+    Status collect(TiffDecOutput* out, std::string& error);
+
+    /** @brief Bytes held by input copies and decoded frames */
+    size_t bytes();
+
+  private:
+    struct frame {
+        std::vector<uint8_t> input;
+        size_t inputSize;
+        tiff_frame_buffers buffers;
+        size_t bufferBytes;
+        TiffDecOutput out;
+        Status status;
+        std::string error;
+        bool done;
+    };
+
+    void thread_loop(unsigned thread);
+
+    decode_fn decode;
+    std::vector<std::unique_ptr<frame> > frames;
+    size_t head;    /* Oldest frame not collected yet */
+    size_t pending; /* Frames submitted and not collected yet */
+    std::deque<size_t> jobs;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable frameDone;
+    bool stopping;
+};
+
+#endif // __DEE_PLUGINS_TIFF_DEC_LIBTIFF_QUEUE_H__